@@ -16,12 +16,27 @@ struct AudioMetaData
     QString composer;
     QString year;
     QString artworkPath;
+    QString sourcePath;     //エンコード元のwavファイル
+    double durationSeconds = 0.0;   //エンコード元の長さ 不明な場合は0
+    //ラウドネス解析の結果 空の場合はタグを書かない
+    QString replayGainTrackGain;
+    QString replayGainTrackPeak;
+    QString replayGainAlbumGain;
+    QString replayGainAlbumPeak;
+    QString iTunNORM;
+    //クリップを避けるため非可逆圧縮(AAC・MP3)の出力だけに掛けるゲイン(dB) 0の場合は掛けない
+    double lossyGainDb = 0.0;
 };
 
 struct ProjectMetaData
 {
-    std::string projectPath;
-    std::string artworkPath;
+    QString projectPath;
+    QString artworkPath;
+    QString outputFolderPath;
+    bool isAddTrackNo = false;
+    QString trackNoDelimiter = "_";
+    int numOfDigit = 0;
+    QString filenameDelimiter = "_";
     std::vector<AudioMetaData> audioMetaData;
 };
 
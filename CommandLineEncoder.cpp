@@ -0,0 +1,310 @@
+#include "CommandLineEncoder.h"
+#include "ProjectDefines.hpp"
+#include "ProjectFile.h"
+
+#include "Encoder/AACEncoder.h"
+#include "Encoder/MP3Encoder.h"
+#include "Encoder/FlacEncoder.h"
+#include "Encoder/MultiOutputEncoder.h"
+#include "Encoder/LibavEncoder.h"
+#include "Encoder/ArtworkPreprocessor.h"
+#include "Encoder/WaveFile.h"
+#include "Encoder/EncodeReport.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <QTimer>
+
+#include <csignal>
+
+namespace
+{
+    //シグナルハンドラーからはフラグを立てるだけにして、イベントループ側で中止する
+    volatile std::sig_atomic_t isInterrupted = 0;
+
+    void OnInterrupt(int)
+    {
+        isInterrupted = 1;
+        //2回目のCtrl+Cはジョブを待たずに終了させる
+        std::signal(SIGINT, SIG_DFL);
+    }
+
+    //中止した場合の終了コード(128 + SIGINT)
+    constexpr int interruptedExitCode = 130;
+}
+
+CommandLineEncoder::CommandLineEncoder(Options options, QObject* parent)
+    : QObject(parent)
+    , options(std::move(options))
+    , scheduler(new EncodeScheduler(this))
+    , numErrors(0)
+    , isCanceled(false)
+{
+}
+
+CommandLineEncoder::~CommandLineEncoder(){
+}
+
+bool CommandLineEncoder::IsCommandLineMode(int argc, char* argv[])
+{
+    for(int i=1; i<argc; ++i)
+    {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        if(arg == "--project" || arg.startsWith("--project=")){
+            return true;
+        }
+    }
+    return false;
+}
+
+int CommandLineEncoder::Run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Encode a project file without the GUI.");
+    parser.addHelpOption();
+    QCommandLineOption projectOption("project", "Project file (.encproj) to encode.", "file");
+    QCommandLineOption jobsOption("jobs", "Number of encoder processes run in parallel.", "N");
+    QCommandLineOption codecsOption("codecs", "Comma separated codecs to output (m4a,mp3,flac).", "list", "m4a,mp3,flac");
+    QCommandLineOption outputOption("output", "Output folder. Defaults to the folder saved in the project.", "dir");
+    QCommandLineOption ffmpegOption("ffmpeg", "Path to the ffmpeg executable.", "file");
+    QCommandLineOption fanOutOption("fan-out", "Encode all codecs of a track in one ffmpeg process.");
+    QCommandLineOption batchOption("batch", "Encode short tracks together in one ffmpeg process.");
+    QCommandLineOption forceOption("force", "Encode all outputs even if they are up to date.");
+    QCommandLineOption noVerifyOption("no-verify", "Do not decode and check the outputs after encoding.");
+    QCommandLineOption engineOption("engine", "Encoding engine: ffmpeg (one process per job) or libav (in-process).", "name");
+    parser.addOptions({projectOption, jobsOption, codecsOption, outputOption, ffmpegOption, fanOutOption, batchOption, forceOption, noVerifyOption, engineOption});
+
+    QTextStream err(stderr);
+    if(parser.parse(arguments) == false){
+        err << parser.errorText() << Qt::endl;
+        return 2;
+    }
+    if(parser.isSet("help")){
+        parser.showHelp(0);
+    }
+
+    QSettings settingfile(ProjectDefines::settingFilePath, QSettings::IniFormat);
+
+    Options options;
+    options.projectPath = parser.value(projectOption);
+    options.outputFolderPath = parser.value(outputOption);
+    options.ffmpegPath = parser.value(ffmpegOption);
+    options.codecs = parser.value(codecsOption).split(",", Qt::SkipEmptyParts);
+    options.fanOut = parser.isSet(fanOutOption) || settingfile.value(ProjectDefines::settingFanOutEncode, false).toBool();
+    options.batch = parser.isSet(batchOption) || settingfile.value(ProjectDefines::settingBatchEncode, false).toBool();
+    options.force = parser.isSet(forceOption) || settingfile.value(ProjectDefines::settingSkipUpToDate, true).toBool() == false;
+    options.artworkEmbedSize = settingfile.value(ProjectDefines::settingArtworkEmbedSize, 0).toInt();
+    options.numJobs = settingfile.value(ProjectDefines::settingMaxParallelJobs, 0).toInt();
+    options.inProcess = settingfile.value(ProjectDefines::settingInProcessEncode, false).toBool();
+    options.verify = parser.isSet(noVerifyOption) == false && settingfile.value(ProjectDefines::settingVerifyOutputs, true).toBool();
+    if(parser.isSet(engineOption))
+    {
+        const QString engine = parser.value(engineOption).toLower();
+        if(engine != "ffmpeg" && engine != "libav"){
+            err << "invalid --engine value: " << parser.value(engineOption) << Qt::endl;
+            return 2;
+        }
+        options.inProcess = (engine == "libav");
+    }
+    if(options.inProcess && LibavEncoder::IsAvailable() == false)
+    {
+        if(parser.isSet(engineOption)){
+            err << "this build does not include the libav engine." << Qt::endl;
+            return 2;
+        }
+        options.inProcess = false;
+    }
+    if(parser.isSet(jobsOption))
+    {
+        bool isOk = false;
+        options.numJobs = parser.value(jobsOption).toInt(&isOk);
+        if(isOk == false || options.numJobs <= 0){
+            err << "invalid --jobs value: " << parser.value(jobsOption) << Qt::endl;
+            return 2;
+        }
+    }
+
+    CommandLineEncoder encoder(std::move(options));
+    QObject::connect(&encoder, &CommandLineEncoder::finished, qApp, &QCoreApplication::exit, Qt::QueuedConnection);
+    if(encoder.Start() == false){
+        return 1;
+    }
+    return QCoreApplication::exec();
+}
+
+bool CommandLineEncoder::Start()
+{
+    if(ProjectFile::Load(options.projectPath, project) == false){
+        PrintLine(QString("can't load project file : %1").arg(options.projectPath), true);
+        return false;
+    }
+    if(project.audioMetaData.empty()){
+        PrintLine(QString("no tracks in project : %1").arg(options.projectPath), true);
+        return false;
+    }
+
+    const QString ffmpegPath = EncoderInterface::FindFFmpeg(options.ffmpegPath);
+    if(ffmpegPath.isEmpty() && options.inProcess == false){
+        PrintLine("ffmpeg not found. Specify it with --ffmpeg or add it to PATH.", true);
+        return false;
+    }
+
+    const QString outputFolder = options.outputFolderPath.isEmpty() ? project.outputFolderPath : options.outputFolderPath;
+    if(outputFolder.isEmpty() || QDir().mkpath(outputFolder) == false){
+        PrintLine(QString("can't create output folder : %1").arg(outputFolder), true);
+        return false;
+    }
+
+    for(const auto& codec : options.codecs)
+    {
+        std::shared_ptr<EncoderInterface> encoder;
+        const QString name = codec.trimmed().toLower();
+        if(name == "m4a" || name == "aac"){ encoder = std::make_shared<AACEncoder>(); }
+        else if(name == "flac"){ encoder = std::make_shared<FlacEncoder>(); }
+        else if(name == "mp3"){ encoder = std::make_shared<MP3Encoder>(); }
+        else{
+            PrintLine(QString("unknown codec : %1").arg(codec), true);
+            return false;
+        }
+        encoders.emplace_back(std::move(encoder));
+    }
+    if(encoders.empty()){
+        PrintLine("no codec specified.", true);
+        return false;
+    }
+
+    const int numTracks = static_cast<int>(project.audioMetaData.size());
+    for(const auto& encoder : encoders){
+        encoder->SetFFmpegPath(ffmpegPath);
+        encoder->SetOutputFolderPath(outputFolder);
+        encoder->SetIsAddTrackNo(project.isAddTrackNo);
+        encoder->SetNumOfDigit(project.numOfDigit);
+        encoder->SetTrackNumberDelimiter(project.trackNoDelimiter);
+        encoder->SetNumEncodingMusic(numTracks);
+    }
+    if(options.fanOut && encoders.size() > 1)
+    {
+        auto multiOutputEncoder = std::make_shared<MultiOutputEncoder>();
+        multiOutputEncoder->SetFFmpegPath(ffmpegPath);
+        multiOutputEncoder->SetOutputEncoders(encoders);
+        encoders = {multiOutputEncoder};
+    }
+    if(options.inProcess){
+        for(auto& encoder : encoders){
+            encoder = std::make_shared<LibavEncoder>(encoder);
+        }
+    }
+
+    for(const auto& encoder : encoders)
+    {
+        connect(encoder.get(), &EncoderInterface::encodeError, this, [this](const QString inputPath, const AudioMetaData&, int, QString message){
+            this->numErrors++;
+            PrintLine(QString("error : %1 (%2)").arg(inputPath, message), true);
+        });
+        scheduler->AddEncoder(encoder);
+    }
+
+    connect(scheduler, &EncodeScheduler::jobStarted, this, [this](const EncodeJob& job){
+        PrintLine(QString("start %1 encoding : %2").arg(job.encoder->GetCodecExtention(), job.metaData.title));
+    });
+    connect(scheduler, &EncodeScheduler::jobSkipped, this, [this](const EncodeJob& job){
+        PrintLine(QString("skip %1 encoding (up to date) : %2").arg(job.encoder->GetCodecExtention(), job.metaData.title));
+    });
+    connect(scheduler, &EncodeScheduler::jobTagUpdated, this, [this](const EncodeJob& job){
+        PrintLine(QString("update %1 tags only : %2").arg(job.encoder->GetCodecExtention(), job.metaData.title));
+    });
+    connect(scheduler, &EncodeScheduler::jobFailed, this, [this](const EncodeJob& job){
+        this->numErrors++;
+        PrintLine(QString("failed to start %1 encoding : %2").arg(job.encoder->GetCodecExtention(), job.metaData.title), true);
+    });
+    connect(scheduler, &EncodeScheduler::jobVerifyFailed, this, [this](const EncodeJob& job){
+        this->numErrors++;
+        PrintLine(QString("verification failed %1 : %2").arg(job.encoder->GetCodecExtention(), job.metaData.title), true);
+        for(const auto& message : job.verifyMessages){
+            PrintLine("  " + message, true);
+        }
+    });
+    connect(scheduler, &EncodeScheduler::jobFinished, this, [this](const EncodeJob& job){
+        PrintLine(QString("finish %1 encoding : %2 (%3/%4)").arg(job.encoder->GetCodecExtention(), job.metaData.title)
+                  .arg(scheduler->GetNumFinished()).arg(scheduler->GetNumTotal()));
+    });
+    connect(scheduler, &EncodeScheduler::allFinished, this, [this, outputFolder](){
+        if(EncodeReport::Write(outputFolder, this->scheduler->GetFinishedJobs())){
+            PrintLine(QString("report : %1").arg(QDir(outputFolder).filePath(EncodeReport::csvFileName)));
+        }
+        else{
+            PrintLine(QString("can't write encode report to %1").arg(outputFolder), true);
+        }
+        if(this->numErrors > 0){
+            PrintLine(QString("%1 job(s) failed.").arg(this->numErrors), true);
+        }
+        if(this->isCanceled){
+            PrintLine("Canceled.", true);
+        }
+        else if(this->numErrors == 0){
+            PrintLine("Complete.");
+        }
+        const auto progress = this->scheduler->GetOverallProgress();
+        if(progress.speed > 0.0){
+            PrintLine(QString("encoded %1 s of audio (x%2 realtime)").arg(progress.outTimeSeconds, 0, 'f', 1).arg(progress.speed, 0, 'f', 1));
+        }
+        emit this->finished(this->isCanceled ? interruptedExitCode : (this->numErrors > 0 ? 1 : 0));
+    });
+
+    //ジャケットは全ジョブで共通なので、ここで1回だけ埋め込み用のJPEGにしておく
+    const QString embedArtworkPath = ArtworkPreprocessor::Prepare(project.artworkPath, options.artworkEmbedSize);
+    for(auto& metaData : project.audioMetaData){
+        metaData.artworkPath = embedArtworkPath;
+        //長さはコーデックごとに読み直さないよう、ここで1回だけ求めておく
+        metaData.durationSeconds = WaveFile::GetDurationSeconds(metaData.sourcePath);
+    }
+
+    scheduler->SetMaxParallelJobs(options.numJobs);
+    scheduler->SetBatchEncode(options.batch);
+    scheduler->SetVerifyOutputs(options.verify);
+    if(options.force == false)
+    {
+        auto cache = std::make_shared<EncodeCache>();
+        cache->Open(outputFolder);
+        scheduler->SetCache(cache);
+    }
+    for(int i=0; i<numTracks; ++i)
+    {
+        const auto& metaData = project.audioMetaData[i];
+        if(QFile::exists(metaData.sourcePath) == false){
+            this->numErrors++;
+            PrintLine(QString("source file not found : %1").arg(metaData.sourcePath), true);
+            continue;
+        }
+        for(const auto& encoder : encoders){
+            scheduler->Enqueue({encoder, metaData.sourcePath, metaData, i});
+        }
+    }
+
+    std::signal(SIGINT, OnInterrupt);
+    auto* interruptTimer = new QTimer(this);
+    connect(interruptTimer, &QTimer::timeout, this, &CommandLineEncoder::CheckInterrupt);
+    interruptTimer->start(200);
+
+    //イベントループ開始後に投入する
+    QTimer::singleShot(0, scheduler, &EncodeScheduler::Start);
+    return true;
+}
+
+void CommandLineEncoder::CheckInterrupt()
+{
+    if(isInterrupted == 0 || this->isCanceled){ return; }
+    this->isCanceled = true;
+    PrintLine("interrupted : waiting for running jobs to finish (press Ctrl+C again to quit now)", true);
+    scheduler->Cancel();
+}
+
+void CommandLineEncoder::PrintLine(const QString& text, bool isError) const
+{
+    QTextStream stream(isError ? stderr : stdout);
+    stream << text << Qt::endl;
+}
@@ -0,0 +1,61 @@
+#ifndef COMMANDLINEENCODER_H
+#define COMMANDLINEENCODER_H
+
+#include <QObject>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+#include "AudioMetaData.hpp"
+#include "Encoder/EncoderInterface.h"
+#include "Encoder/EncodeScheduler.h"
+
+//GUIを使わずに.encprojをエンコードする
+//  EncodeUtility --project album.encproj --jobs N --codecs m4a,mp3,flac
+class CommandLineEncoder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        QString projectPath;
+        QString outputFolderPath;   //空の場合はプロジェクトの出力先
+        QString ffmpegPath;         //空の場合は自動で探す
+        QStringList codecs;         //空の場合は全コーデック
+        int numJobs = 0;            //0以下の場合はハードウェアスレッド数
+        int artworkEmbedSize = 0;   //0の場合は元のサイズ
+        bool fanOut = false;
+        bool batch = false;         //短い曲を1回のffmpegでまとめてエンコードする
+        bool force = false;         //変更の無い出力も再エンコードする
+        bool inProcess = false;     //ffmpegを起動せずlibavcodecでエンコードする
+        bool verify = true;         //エンコード後に出力をデコードして検査する
+    };
+
+    explicit CommandLineEncoder(Options options, QObject* parent = nullptr);
+    ~CommandLineEncoder() override;
+
+    //引数にプロジェクト指定が含まれていればGUIを起動せずに処理する
+    static bool IsCommandLineMode(int argc, char* argv[]);
+    //コマンドライン引数を解析してエンコードを実行し、終了コードを返す
+    static int Run(const QStringList& arguments);
+
+    //エンコードを開始する 完了時にfinished(終了コード)を発行
+    bool Start();
+
+signals:
+    void finished(int exitCode);
+
+private:
+    void PrintLine(const QString& text, bool isError = false) const;
+    //Ctrl+Cで待ち行列を破棄し、起動済みのジョブが終わったら終了する
+    void CheckInterrupt();
+
+    Options options;
+    ProjectMetaData project;
+    EncodeScheduler* scheduler;
+    std::vector<std::shared_ptr<EncoderInterface>> encoders;
+    int numErrors;
+    bool isCanceled;
+};
+
+#endif // COMMANDLINEENCODER_H
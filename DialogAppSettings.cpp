@@ -18,7 +18,10 @@
 
 #include "DialogAppSettings.h"
 #include "ui_DialogAppSettings.h"
+#include "ProjectDefines.hpp"
+#include "Encoder/LibavEncoder.h"
 #include <QSettings>
+#include <QThread>
 #include <QDebug>
 
 DialogAppSettings::DialogAppSettings(QWidget *parent) :
@@ -47,6 +50,76 @@ DialogAppSettings::DialogAppSettings(QWidget *parent) :
     else{
         this->ui->mp3_args->setText(settings.value("mp3Option").toString());
     }
+    if(settings.value(ProjectDefines::settingMaxParallelJobs).isValid() == false){
+        //初期値はハードウェアスレッド数
+        this->ui->max_parallel_jobs->setValue(QThread::idealThreadCount());
+        settings.setValue(ProjectDefines::settingMaxParallelJobs, this->ui->max_parallel_jobs->value());
+    }
+    else{
+        this->ui->max_parallel_jobs->setValue(settings.value(ProjectDefines::settingMaxParallelJobs).toInt());
+    }
+    if(settings.value(ProjectDefines::settingFanOutEncode).isValid() == false){
+        settings.setValue(ProjectDefines::settingFanOutEncode, this->ui->check_fanOutEncode->isChecked());
+    }
+    else{
+        this->ui->check_fanOutEncode->setChecked(settings.value(ProjectDefines::settingFanOutEncode).toBool());
+    }
+    if(settings.value(ProjectDefines::settingBatchEncode).isValid() == false){
+        settings.setValue(ProjectDefines::settingBatchEncode, this->ui->check_batchEncode->isChecked());
+    }
+    else{
+        this->ui->check_batchEncode->setChecked(settings.value(ProjectDefines::settingBatchEncode).toBool());
+    }
+    if(settings.value(ProjectDefines::settingSkipUpToDate).isValid() == false){
+        settings.setValue(ProjectDefines::settingSkipUpToDate, this->ui->check_skipUpToDate->isChecked());
+    }
+    else{
+        this->ui->check_skipUpToDate->setChecked(settings.value(ProjectDefines::settingSkipUpToDate).toBool());
+    }
+    if(settings.value(ProjectDefines::settingWriteLoudnessTags).isValid() == false){
+        settings.setValue(ProjectDefines::settingWriteLoudnessTags, this->ui->check_writeLoudnessTags->isChecked());
+    }
+    else{
+        this->ui->check_writeLoudnessTags->setChecked(settings.value(ProjectDefines::settingWriteLoudnessTags).toBool());
+    }
+    if(settings.value(ProjectDefines::settingClipScan).isValid() == false){
+        settings.setValue(ProjectDefines::settingClipScan, this->ui->check_clipScan->isChecked());
+    }
+    else{
+        this->ui->check_clipScan->setChecked(settings.value(ProjectDefines::settingClipScan).toBool());
+    }
+    if(settings.value(ProjectDefines::settingLossyPreGain).isValid() == false){
+        settings.setValue(ProjectDefines::settingLossyPreGain, this->ui->check_lossyPreGain->isChecked());
+    }
+    else{
+        this->ui->check_lossyPreGain->setChecked(settings.value(ProjectDefines::settingLossyPreGain).toBool());
+    }
+    if(settings.value(ProjectDefines::settingVerifyOutputs).isValid() == false){
+        settings.setValue(ProjectDefines::settingVerifyOutputs, this->ui->check_verifyOutputs->isChecked());
+    }
+    else{
+        this->ui->check_verifyOutputs->setChecked(settings.value(ProjectDefines::settingVerifyOutputs).toBool());
+    }
+    if(settings.value(ProjectDefines::settingInProcessEncode).isValid() == false){
+        settings.setValue(ProjectDefines::settingInProcessEncode, this->ui->check_inProcessEncode->isChecked());
+    }
+    else{
+        this->ui->check_inProcessEncode->setChecked(settings.value(ProjectDefines::settingInProcessEncode).toBool());
+    }
+    //libavcodecをリンクしていないビルドでは選択できない
+    this->ui->check_inProcessEncode->setEnabled(LibavEncoder::IsAvailable());
+    if(settings.value(ProjectDefines::settingWavHardLink).isValid() == false){
+        settings.setValue(ProjectDefines::settingWavHardLink, this->ui->check_wavHardLink->isChecked());
+    }
+    else{
+        this->ui->check_wavHardLink->setChecked(settings.value(ProjectDefines::settingWavHardLink).toBool());
+    }
+    if(settings.value(ProjectDefines::settingArtworkEmbedSize).isValid() == false){
+        settings.setValue(ProjectDefines::settingArtworkEmbedSize, this->ui->artwork_embed_size->value());
+    }
+    else{
+        this->ui->artwork_embed_size->setValue(settings.value(ProjectDefines::settingArtworkEmbedSize).toInt());
+    }
     if(settings.value("lastOpened").isValid() == false){
         settings.setValue("lastOpened", "");
     }
@@ -64,6 +137,17 @@ DialogAppSettings::~DialogAppSettings()
     settings.setValue("ffmpegPath", QVariant(this->ui->ffmpeg_path->text()));
     settings.setValue("m4aOption", QVariant(this->ui->m4a_args->text()));
     settings.setValue("mp3Option", QVariant(this->ui->mp3_args->text()));
+    settings.setValue(ProjectDefines::settingMaxParallelJobs, this->ui->max_parallel_jobs->value());
+    settings.setValue(ProjectDefines::settingFanOutEncode, this->ui->check_fanOutEncode->isChecked());
+    settings.setValue(ProjectDefines::settingBatchEncode, this->ui->check_batchEncode->isChecked());
+    settings.setValue(ProjectDefines::settingSkipUpToDate, this->ui->check_skipUpToDate->isChecked());
+    settings.setValue(ProjectDefines::settingWriteLoudnessTags, this->ui->check_writeLoudnessTags->isChecked());
+    settings.setValue(ProjectDefines::settingClipScan, this->ui->check_clipScan->isChecked());
+    settings.setValue(ProjectDefines::settingLossyPreGain, this->ui->check_lossyPreGain->isChecked());
+    settings.setValue(ProjectDefines::settingVerifyOutputs, this->ui->check_verifyOutputs->isChecked());
+    settings.setValue(ProjectDefines::settingInProcessEncode, this->ui->check_inProcessEncode->isChecked());
+    settings.setValue(ProjectDefines::settingWavHardLink, this->ui->check_wavHardLink->isChecked());
+    settings.setValue(ProjectDefines::settingArtworkEmbedSize, this->ui->artwork_embed_size->value());
     settings.setValue("lastOpened", this->lastOpenedDir);
     settings.sync();
 
@@ -103,6 +187,61 @@ QString DialogAppSettings::GetMP3EncodeSetting() const
     return param;
 }
 
+int DialogAppSettings::GetMaxParallelJobs() const
+{
+    return this->ui->max_parallel_jobs->value();
+}
+
+bool DialogAppSettings::IsFanOutEncode() const
+{
+    return this->ui->check_fanOutEncode->isChecked();
+}
+
+bool DialogAppSettings::IsBatchEncode() const
+{
+    return this->ui->check_batchEncode->isChecked();
+}
+
+bool DialogAppSettings::IsSkipUpToDate() const
+{
+    return this->ui->check_skipUpToDate->isChecked();
+}
+
+bool DialogAppSettings::IsWriteLoudnessTags() const
+{
+    return this->ui->check_writeLoudnessTags->isChecked();
+}
+
+bool DialogAppSettings::IsClipScan() const
+{
+    return this->ui->check_clipScan->isChecked();
+}
+
+bool DialogAppSettings::IsLossyPreGain() const
+{
+    return this->ui->check_lossyPreGain->isChecked();
+}
+
+bool DialogAppSettings::IsVerifyOutputs() const
+{
+    return this->ui->check_verifyOutputs->isChecked();
+}
+
+bool DialogAppSettings::IsInProcessEncode() const
+{
+    return this->ui->check_inProcessEncode->isChecked() && LibavEncoder::IsAvailable();
+}
+
+bool DialogAppSettings::IsWavHardLink() const
+{
+    return this->ui->check_wavHardLink->isChecked();
+}
+
+int DialogAppSettings::GetArtworkEmbedSize() const
+{
+    return this->ui->artwork_embed_size->value();
+}
+
 bool DialogAppSettings::IsAddTrackNoForTitle() const
 {
     return this->ui->check_addTrackNo->isChecked();
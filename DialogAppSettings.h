@@ -39,6 +39,17 @@ public:
     QString GetFFmpegPath() const;
     QString GetAACEncodeSetting() const;
     QString GetMP3EncodeSetting() const;
+    int GetMaxParallelJobs() const;
+    bool IsFanOutEncode() const;
+    bool IsBatchEncode() const;
+    bool IsSkipUpToDate() const;
+    bool IsWriteLoudnessTags() const;
+    bool IsClipScan() const;
+    bool IsLossyPreGain() const;
+    bool IsVerifyOutputs() const;
+    bool IsInProcessEncode() const;
+    bool IsWavHardLink() const;
+    int GetArtworkEmbedSize() const;
 
     bool IsAddTrackNoForTitle() const;
     QString DelimiterForTrackNo() const;
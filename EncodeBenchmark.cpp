@@ -0,0 +1,447 @@
+#include "EncodeBenchmark.h"
+#include "ProjectDefines.hpp"
+
+#include "Encoder/AACEncoder.h"
+#include "Encoder/MP3Encoder.h"
+#include "Encoder/FlacEncoder.h"
+#include "Encoder/LibavEncoder.h"
+#include "Encoder/EncodeScheduler.h"
+#include "Encoder/WaveFile.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace
+{
+    //コーパスの内容を変えたら上げる 結果の比較時に別物だと分かるようにする
+    constexpr int corpusVersion = 1;
+
+    std::shared_ptr<EncoderInterface> CreateEncoder(const QString& codec)
+    {
+        if(codec == "m4a" || codec == "aac"){ return std::make_shared<AACEncoder>(); }
+        if(codec == "flac"){ return std::make_shared<FlacEncoder>(); }
+        if(codec == "mp3"){ return std::make_shared<MP3Encoder>(); }
+        return nullptr;
+    }
+
+    //音楽に近い負荷になるよう、複数の正弦波と小さなノイズを混ぜる
+    //乱数は固定シードの線形合同法なので、何度生成しても同じバイト列になる
+    class SignalGenerator
+    {
+    public:
+        SignalGenerator(int sampleRate, int numChannels)
+            : sampleRate(sampleRate), numChannels(numChannels), sampleIndex(0), seed(0x12345678u)
+        {}
+
+        void Generate(QByteArray& buffer, qint64 numFrames, int bitsPerSample)
+        {
+            const int bytesPerSample = bitsPerSample / 8;
+            buffer.resize(numFrames * this->numChannels * bytesPerSample);
+            char* out = buffer.data();
+            const double maxValue = double((1 << (bitsPerSample - 1)) - 1);
+            for(qint64 frame=0; frame<numFrames; ++frame, ++this->sampleIndex)
+            {
+                const double t = double(this->sampleIndex) / this->sampleRate;
+                //ゆっくり動くスイープと和音
+                const double sweep = 220.0 + 110.0 * std::sin(2.0 * std::numbers::pi * 0.05 * t);
+                for(int ch=0; ch<this->numChannels; ++ch)
+                {
+                    double value = 0.30 * std::sin(2.0 * std::numbers::pi * sweep * t + ch)
+                                 + 0.15 * std::sin(2.0 * std::numbers::pi * 440.0 * t)
+                                 + 0.10 * std::sin(2.0 * std::numbers::pi * 1320.0 * t + 0.5 * ch)
+                                 + 0.03 * this->NextNoise();
+                    const auto sample = qint32(std::lround(std::clamp(value, -1.0, 1.0) * maxValue));
+                    for(int b=0; b<bytesPerSample; ++b){
+                        *out++ = char((sample >> (8 * b)) & 0xFF);
+                    }
+                }
+            }
+        }
+
+    private:
+        double NextNoise()
+        {
+            this->seed = this->seed * 1664525u + 1013904223u;
+            return double(this->seed >> 8) / double(1u << 23) - 1.0;
+        }
+
+        int sampleRate;
+        int numChannels;
+        qint64 sampleIndex;
+        quint32 seed;
+    };
+
+    double Median(std::vector<double> values)
+    {
+        if(values.empty()){ return 0.0; }
+        std::sort(values.begin(), values.end());
+        const size_t half = values.size() / 2;
+        return (values.size() % 2) ? values[half] : (values[half - 1] + values[half]) / 2.0;
+    }
+}
+
+bool EncodeBenchmark::IsBenchmarkMode(int argc, char* argv[])
+{
+    for(int i=1; i<argc; ++i)
+    {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        if(arg == "--benchmark" || arg.startsWith("--benchmark=")){
+            return true;
+        }
+    }
+    return false;
+}
+
+int EncodeBenchmark::Run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure encoding throughput with a generated WAV corpus.");
+    parser.addHelpOption();
+    QCommandLineOption benchmarkOption("benchmark", "Result JSON file. \"-\" writes to stdout.", "file");
+    QCommandLineOption corpusOption("corpus", "Folder for the generated WAV files and outputs.", "dir");
+    QCommandLineOption jobsListOption("jobs-list", "Comma separated concurrency levels to measure.", "list");
+    QCommandLineOption codecsOption("codecs", "Comma separated codecs to measure (m4a,mp3,flac).", "list", "m4a,mp3,flac");
+    QCommandLineOption repeatOption("repeat", "Number of runs per condition. The median is reported.", "N", "1");
+    QCommandLineOption ffmpegOption("ffmpeg", "Path to the ffmpeg executable.", "file");
+    QCommandLineOption engineOption("engine", "Encoding engine: ffmpeg or libav.", "name", "ffmpeg");
+    parser.addOptions({benchmarkOption, corpusOption, jobsListOption, codecsOption, repeatOption, ffmpegOption, engineOption});
+
+    QTextStream err(stderr);
+    if(parser.parse(arguments) == false){
+        err << parser.errorText() << Qt::endl;
+        return 2;
+    }
+    if(parser.isSet("help")){
+        parser.showHelp(0);
+    }
+
+    Options options;
+    options.resultPath = parser.value(benchmarkOption);
+    if(options.resultPath == "-"){
+        options.resultPath.clear();
+    }
+    options.corpusFolderPath = parser.isSet(corpusOption) ? parser.value(corpusOption) : QDir::temp().filePath("EncodeUtilityBenchmark");
+    options.ffmpegPath = parser.value(ffmpegOption);
+    for(const auto& codec : parser.value(codecsOption).split(",", Qt::SkipEmptyParts))
+    {
+        const QString name = codec.trimmed().toLower();
+        if(CreateEncoder(name) == nullptr){
+            err << "unknown codec : " << codec << Qt::endl;
+            return 2;
+        }
+        options.codecs << name;
+    }
+
+    //既定は1から論理コア数まで倍々に増やす
+    const int idealThreads = std::max(QThread::idealThreadCount(), 1);
+    if(parser.isSet(jobsListOption))
+    {
+        for(const auto& value : parser.value(jobsListOption).split(",", Qt::SkipEmptyParts))
+        {
+            bool isOk = false;
+            const int numJobs = value.toInt(&isOk);
+            if(isOk == false || numJobs <= 0){
+                err << "invalid --jobs-list value: " << value << Qt::endl;
+                return 2;
+            }
+            options.jobsList.push_back(numJobs);
+        }
+    }
+    else
+    {
+        for(int numJobs=1; numJobs<idealThreads; numJobs*=2){
+            options.jobsList.push_back(numJobs);
+        }
+        options.jobsList.push_back(idealThreads);
+    }
+    std::sort(options.jobsList.begin(), options.jobsList.end());
+    options.jobsList.erase(std::unique(options.jobsList.begin(), options.jobsList.end()), options.jobsList.end());
+
+    bool isOk = false;
+    options.numRepeats = parser.value(repeatOption).toInt(&isOk);
+    if(isOk == false || options.numRepeats <= 0){
+        err << "invalid --repeat value: " << parser.value(repeatOption) << Qt::endl;
+        return 2;
+    }
+
+    const QString engine = parser.value(engineOption).toLower();
+    if(engine != "ffmpeg" && engine != "libav"){
+        err << "invalid --engine value: " << parser.value(engineOption) << Qt::endl;
+        return 2;
+    }
+    options.inProcess = (engine == "libav");
+    if(options.inProcess && LibavEncoder::IsAvailable() == false){
+        err << "this build does not include the libav engine." << Qt::endl;
+        return 2;
+    }
+    if(options.codecs.isEmpty() || options.jobsList.empty()){
+        err << "nothing to measure." << Qt::endl;
+        return 2;
+    }
+
+    EncodeBenchmark benchmark(std::move(options));
+    const QJsonObject result = benchmark.Execute();
+    if(result.isEmpty()){
+        return 1;
+    }
+
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+    if(benchmark.options.resultPath.isEmpty()){
+        QTextStream(stdout) << json;
+        return 0;
+    }
+    QFile file(benchmark.options.resultPath);
+    if(file.open(QFile::WriteOnly | QFile::Truncate) == false || file.write(json) != json.size()){
+        err << "can't write result file : " << benchmark.options.resultPath << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
+
+EncodeBenchmark::EncodeBenchmark(Options options)
+    : options(std::move(options))
+{
+}
+
+const std::vector<EncodeBenchmark::CorpusEntry>& EncodeBenchmark::GetCorpus()
+{
+    //長さ・サンプルレート・ビット深度の組み合わせ 同時実行数を上げても余らない程度の曲数にする
+    static const std::vector<CorpusEntry> corpus = {
+        {"44k16_030s",      44100, 16, 2,  30.0},
+        {"44k16_120s",      44100, 16, 2, 120.0},
+        {"44k16_300s",      44100, 16, 2, 300.0},
+        {"44k16_mono_090s", 44100, 16, 1,  90.0},
+        {"48k24_060s",      48000, 24, 2,  60.0},
+        {"48k24_180s",      48000, 24, 2, 180.0},
+        {"96k24_060s",      96000, 24, 2,  60.0},
+        {"96k24_120s",      96000, 24, 2, 120.0},
+    };
+    return corpus;
+}
+
+QJsonObject EncodeBenchmark::Execute()
+{
+    QTextStream err(stderr);
+    this->ffmpegPath = EncoderInterface::FindFFmpeg(this->options.ffmpegPath);
+    if(this->ffmpegPath.isEmpty() && this->options.inProcess == false){
+        err << "ffmpeg not found. Specify it with --ffmpeg or add it to PATH." << Qt::endl;
+        return {};
+    }
+
+    QStringList inputPaths;
+    double totalSeconds = 0.0;
+    if(this->GenerateCorpus(inputPaths, totalSeconds) == false){
+        return {};
+    }
+
+    QJsonArray results;
+    for(const auto& codec : this->options.codecs)
+    {
+        double baseWallSeconds = 0.0;
+        int baseJobs = 0;
+        for(const int numJobs : this->options.jobsList)
+        {
+            std::vector<double> wallSeconds;
+            int numFailed = 0;
+            for(int repeat=0; repeat<this->options.numRepeats; ++repeat)
+            {
+                err << QString("%1 jobs=%2 run %3/%4 ...").arg(codec).arg(numJobs).arg(repeat + 1).arg(this->options.numRepeats) << Qt::flush;
+                const auto measurement = this->Measure(codec, numJobs, inputPaths, repeat);
+                err << QString(" %1 s").arg(measurement.wallSeconds, 0, 'f', 2) << Qt::endl;
+                wallSeconds.push_back(measurement.wallSeconds);
+                numFailed += measurement.numFailed;
+            }
+
+            //スケーリング効率は最小の同時実行数を基準に、理想的な短縮に対してどれだけ縮んだか
+            const double wall = Median(wallSeconds);
+            if(baseJobs == 0){
+                baseWallSeconds = wall;
+                baseJobs = numJobs;
+            }
+            const double speedup = (wall > 0.0) ? baseWallSeconds / wall : 0.0;
+            QJsonObject result;
+            result["codec"] = codec;
+            result["jobs"] = numJobs;
+            result["wallSeconds"] = wall;
+            QJsonArray runs;
+            for(const double value : wallSeconds){ runs.append(value); }
+            result["wallSecondsRuns"] = runs;
+            result["realtimeFactor"] = (wall > 0.0) ? totalSeconds / wall : 0.0;
+            result["speedup"] = speedup;
+            result["scalingEfficiency"] = speedup * baseJobs / numJobs;
+            result["failedJobs"] = numFailed;
+            results.append(result);
+        }
+    }
+
+    QJsonArray corpus;
+    for(const auto& entry : GetCorpus())
+    {
+        corpus.append(QJsonObject{
+            {"name", entry.name},
+            {"sampleRate", entry.sampleRate},
+            {"bitsPerSample", entry.bitsPerSample},
+            {"channels", entry.numChannels},
+            {"seconds", entry.seconds},
+        });
+    }
+
+    QJsonObject root;
+    root["environment"] = this->GetEnvironment();
+    root["corpusVersion"] = corpusVersion;
+    root["corpus"] = corpus;
+    root["corpusSeconds"] = totalSeconds;
+    root["repeats"] = this->options.numRepeats;
+    root["results"] = results;
+    return root;
+}
+
+bool EncodeBenchmark::GenerateCorpus(QStringList& inputPaths, double& totalSeconds)
+{
+    QTextStream err(stderr);
+    const QDir corpusDir(QDir(this->options.corpusFolderPath).filePath(QString("corpus-v%1").arg(corpusVersion)));
+    if(QDir().mkpath(corpusDir.path()) == false){
+        err << "can't create corpus folder : " << corpusDir.path() << Qt::endl;
+        return false;
+    }
+
+    inputPaths.clear();
+    totalSeconds = 0.0;
+    for(const auto& entry : GetCorpus())
+    {
+        const QString filePath = corpusDir.filePath(entry.name + ".wav");
+        const qint64 numFrames = qint64(entry.seconds * entry.sampleRate);
+
+        WaveFile::Info info;
+        info.formatTag = 1;
+        info.numChannels = entry.numChannels;
+        info.sampleRate = entry.sampleRate;
+        info.bitsPerSample = entry.bitsPerSample;
+        info.blockAlign = entry.numChannels * entry.bitsPerSample / 8;
+        info.dataSize = numFrames * info.blockAlign;
+
+        inputPaths << filePath;
+        totalSeconds += info.GetDurationSeconds();
+
+        //内容は決まっているので、サイズが合っていれば前回生成したものを使う
+        if(QFileInfo(filePath).size() == 44 + info.dataSize){ continue; }
+
+        err << "generating " << filePath << Qt::endl;
+        QFile file(filePath + ".part");
+        if(file.open(QFile::WriteOnly | QFile::Truncate) == false){
+            err << "can't write corpus file : " << filePath << Qt::endl;
+            return false;
+        }
+        bool isSucceeded = file.write(WaveFile::MakeHeader(info)) == 44;
+        SignalGenerator generator(entry.sampleRate, entry.numChannels);
+        QByteArray buffer;
+        for(qint64 frame=0; frame<numFrames && isSucceeded; frame+=entry.sampleRate)
+        {
+            generator.Generate(buffer, std::min<qint64>(entry.sampleRate, numFrames - frame), entry.bitsPerSample);
+            isSucceeded = file.write(buffer) == buffer.size();
+        }
+        file.close();
+        QFile::remove(filePath);
+        if(isSucceeded == false || file.rename(filePath) == false){
+            file.remove();
+            err << "can't write corpus file : " << filePath << Qt::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+EncodeBenchmark::Measurement EncodeBenchmark::Measure(const QString& codec, int numJobs, const QStringList& inputPaths, int repeat)
+{
+    const QString outputFolder = QDir(this->options.corpusFolderPath).filePath(QString("out/%1-j%2-r%3").arg(codec).arg(numJobs).arg(repeat));
+    QDir(outputFolder).removeRecursively();
+    QDir().mkpath(outputFolder);
+
+    std::shared_ptr<EncoderInterface> encoder = CreateEncoder(codec);
+    encoder->SetFFmpegPath(this->ffmpegPath);
+    encoder->SetOutputFolderPath(outputFolder);
+    encoder->SetNumEncodingMusic(static_cast<int>(inputPaths.size()));
+    if(this->options.inProcess){
+        encoder = std::make_shared<LibavEncoder>(encoder);
+    }
+
+    //キャッシュは設定しない(全ジョブを毎回エンコードする)
+    //計測用の同時実行数で測った時間は、普段のエンコードの見積もりに使わない
+    EncodeScheduler scheduler;
+    scheduler.SetMaxParallelJobs(numJobs);
+    scheduler.SetLearnCost(false);
+    scheduler.AddEncoder(encoder);
+
+    Measurement measurement;
+    QObject::connect(&scheduler, &EncodeScheduler::jobFailed, [&measurement](const EncodeJob&){
+        measurement.numFailed++;
+    });
+    QObject::connect(encoder.get(), &EncoderInterface::encodeError, [&measurement](const QString, const AudioMetaData&, int, QString){
+        measurement.numFailed++;
+    });
+
+    for(int i=0; i<inputPaths.size(); ++i)
+    {
+        AudioMetaData metaData;
+        metaData.title = QFileInfo(inputPaths[i]).completeBaseName();
+        metaData.track_no = QString::number(i + 1);
+        metaData.albumTitle = "EncodeUtility Benchmark";
+        metaData.sourcePath = inputPaths[i];
+        metaData.durationSeconds = WaveFile::GetDurationSeconds(inputPaths[i]);
+        scheduler.Enqueue({encoder, inputPaths[i], metaData, i});
+    }
+
+    QEventLoop loop;
+    QObject::connect(&scheduler, &EncodeScheduler::allFinished, &loop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    timer.start();
+    QTimer::singleShot(0, &scheduler, &EncodeScheduler::Start);
+    loop.exec();
+    measurement.wallSeconds = timer.nsecsElapsed() / 1e9;
+
+    QDir(outputFolder).removeRecursively();
+    return measurement;
+}
+
+QJsonObject EncodeBenchmark::GetEnvironment() const
+{
+    QJsonObject environment;
+    environment["applicationVersion"] = ProjectDefines::applicationVersion;
+    environment["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    environment["host"] = QSysInfo::machineHostName();
+    environment["os"] = QSysInfo::prettyProductName();
+    environment["kernel"] = QSysInfo::kernelType() + " " + QSysInfo::kernelVersion();
+    environment["cpuArchitecture"] = QSysInfo::currentCpuArchitecture();
+    environment["logicalCores"] = QThread::idealThreadCount();
+    environment["qtVersion"] = qVersion();
+    environment["engine"] = this->options.inProcess ? "libav" : "ffmpeg";
+    environment["ffmpegPath"] = this->ffmpegPath;
+
+    //ビルドの違いを比較できるよう、ffmpegのバージョン行も残す
+    if(this->ffmpegPath.isEmpty() == false)
+    {
+        QProcess process;
+        process.start(this->ffmpegPath, {"-version"});
+        if(process.waitForFinished(10000)){
+            environment["ffmpegVersion"] = QString::fromLocal8Bit(process.readAllStandardOutput()).section('\n', 0, 0).trimmed();
+        }
+    }
+    return environment;
+}
@@ -0,0 +1,64 @@
+#ifndef ENCODEBENCHMARK_H
+#define ENCODEBENCHMARK_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+//決まった内容のwavを生成し、実際のエンコード処理で同時実行数ごとの処理速度を測る
+//  EncodeUtility --benchmark result.json --corpus <dir> --jobs-list 1,2,4 --codecs m4a,mp3,flac
+//同じ引数・同じffmpegなら同じ入力になるので、結果のJSONをコミット間・マシン間で比較できる
+class EncodeBenchmark
+{
+public:
+    struct Options
+    {
+        QString resultPath;         //結果のJSON 空の場合は標準出力
+        QString corpusFolderPath;   //生成したwavと出力を置くフォルダ
+        QString ffmpegPath;         //空の場合は自動で探す
+        QStringList codecs;
+        std::vector<int> jobsList;  //測定する同時実行数
+        int numRepeats = 1;         //同じ条件を繰り返す回数 結果は中央値
+        bool inProcess = false;
+    };
+
+    //生成するwav1種類分
+    struct CorpusEntry
+    {
+        QString name;
+        int sampleRate = 44100;
+        int bitsPerSample = 16;
+        int numChannels = 2;
+        double seconds = 0.0;
+    };
+
+    //引数に--benchmarkが含まれていればベンチマークとして起動する
+    static bool IsBenchmarkMode(int argc, char* argv[]);
+    //コマンドライン引数を解析してベンチマークを実行し、終了コードを返す
+    static int Run(const QStringList& arguments);
+
+    explicit EncodeBenchmark(Options options);
+
+    //コーパスの生成と全条件の測定を行う 失敗した場合は空のオブジェクト
+    QJsonObject Execute();
+
+    static const std::vector<CorpusEntry>& GetCorpus();
+
+private:
+    struct Measurement
+    {
+        double wallSeconds = 0.0;
+        int numFailed = 0;
+    };
+
+    //既に同じ内容のファイルがあれば作り直さない
+    bool GenerateCorpus(QStringList& inputPaths, double& totalSeconds);
+    Measurement Measure(const QString& codec, int numJobs, const QStringList& inputPaths, int repeat);
+    QJsonObject GetEnvironment() const;
+
+    Options options;
+    QString ffmpegPath;
+};
+
+#endif // ENCODEBENCHMARK_H
@@ -0,0 +1,202 @@
+#include "EncodeLog.h"
+
+#include <QComboBox>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QSignalBlocker>
+
+#include <algorithm>
+
+namespace
+{
+    //\rで上書きされた行は最後の内容だけを残す
+    QString LastSegment(QString text)
+    {
+        while(text.endsWith('\r')){ text.chop(1); }
+        return text.mid(text.lastIndexOf('\r') + 1);
+    }
+}
+
+EncodeLog::EncodeLog(QPlainTextEdit* view, QComboBox* channelSelector, QObject* parent)
+    : QObject(parent)
+    , view(view)
+    , channelSelector(channelSelector)
+    , maxLines(defaultMaxLines)
+    , selectedChannel(-1)
+{
+    this->view->setMaximumBlockCount(maxLines);
+    this->flushTimer.setSingleShot(true);
+    this->flushTimer.setInterval(flushIntervalMs);
+    connect(&this->flushTimer, &QTimer::timeout, this, &EncodeLog::Flush);
+    connect(this->channelSelector, &QComboBox::currentIndexChanged, this, [this](int index){
+        this->ShowChannel(this->channelSelector->itemData(index).toInt());
+    });
+    this->Clear();
+}
+
+EncodeLog::~EncodeLog()
+{
+    this->Flush();
+    this->CloseFile();
+}
+
+void EncodeLog::SetMaxLines(int num)
+{
+    this->maxLines = std::max(num, 1);
+    this->view->setMaximumBlockCount(this->maxLines);
+    while(static_cast<int>(this->lines.size()) > this->maxLines){
+        this->lines.pop_front();
+    }
+}
+
+bool EncodeLog::OpenFile(const QString& filePath)
+{
+    this->CloseFile();
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    this->file.setFileName(filePath);
+    return this->file.open(QFile::WriteOnly | QFile::Append | QFile::Text);
+}
+
+void EncodeLog::CloseFile()
+{
+    if(this->file.isOpen()){
+        this->file.close();
+    }
+}
+
+int EncodeLog::AddChannel(const QString& title)
+{
+    const int channel = static_cast<int>(this->channels.size());
+    this->channels.push_back({title, QString()});
+    this->channelSelector->addItem(title, channel);
+    return channel;
+}
+
+void EncodeLog::FinishChannel(int channel)
+{
+    if(channel < 0 || channel >= static_cast<int>(this->channels.size())){ return; }
+    auto& partialLine = this->channels[channel].partialLine;
+    if(partialLine.isEmpty() == false){
+        this->PushLine(channel, LastSegment(partialLine));
+        partialLine.clear();
+    }
+}
+
+void EncodeLog::Append(int channel, const QString& text)
+{
+    if(channel < 0 || channel >= static_cast<int>(this->channels.size())){
+        channel = generalChannel;
+    }
+
+    //行末まで届いていない断片はチャンネルごとに保持して次の出力とつなげる
+    auto& partialLine = this->channels[channel].partialLine;
+    partialLine += text;
+    partialLine.replace("\r\n", "\n");
+    const auto parts = partialLine.split('\n');
+    for(int i=0; i+1<parts.size(); ++i){
+        this->PushLine(channel, LastSegment(parts[i]));
+    }
+    //進捗表示の\rが続いても保持する文字列が伸び続けないようにする
+    const QString& last = parts.last();
+    partialLine = LastSegment(last) + (last.endsWith('\r') ? "\r" : "");
+}
+
+void EncodeLog::Clear()
+{
+    this->flushTimer.stop();
+    this->lines.clear();
+    this->pendingLines.clear();
+    this->channels.clear();
+    this->channels.push_back({tr("General"), QString()});
+    this->view->clear();
+
+    QSignalBlocker blocker(this->channelSelector);
+    this->channelSelector->clear();
+    this->channelSelector->addItem(tr("All"), -1);
+    this->channelSelector->addItem(this->channels[generalChannel].title, generalChannel);
+    this->selectedChannel = -1;
+}
+
+void EncodeLog::Flush()
+{
+    this->flushTimer.stop();
+    if(this->file.isOpen()){
+        this->file.flush();
+    }
+    if(this->pendingLines.empty()){ return; }
+
+    QStringList texts;
+    for(const auto& line : this->pendingLines)
+    {
+        if(this->IsVisible(line.channel) == false){ continue; }
+        texts << FormatLine(line, this->selectedChannel < 0);
+    }
+    this->pendingLines.clear();
+    if(texts.isEmpty()){ return; }
+
+    //末尾を表示している場合だけ追従する
+    auto* scrollBar = this->view->verticalScrollBar();
+    const bool isAtBottom = scrollBar->value() == scrollBar->maximum();
+    this->view->appendPlainText(texts.join('\n'));
+    if(isAtBottom){
+        scrollBar->setValue(scrollBar->maximum());
+    }
+}
+
+void EncodeLog::PushLine(int channel, QString text)
+{
+    if(text.trimmed().isEmpty()){ return; }
+
+    Line line{channel, std::move(text)};
+    if(this->file.isOpen())
+    {
+        const QString prefix = QDateTime::currentDateTime().toString("[hh:mm:ss.zzz] ");
+        this->file.write((prefix + FormatLine(line, true) + '\n').toUtf8());
+    }
+
+    this->lines.push_back(line);
+    while(static_cast<int>(this->lines.size()) > this->maxLines){
+        this->lines.pop_front();
+    }
+    this->pendingLines.push_back(std::move(line));
+    if(static_cast<int>(this->pendingLines.size()) > this->maxLines){
+        this->pendingLines.erase(this->pendingLines.begin(), this->pendingLines.end() - this->maxLines);
+    }
+
+    if(this->flushTimer.isActive() == false){
+        this->flushTimer.start();
+    }
+}
+
+void EncodeLog::ShowChannel(int channel)
+{
+    this->Flush();
+    this->selectedChannel = channel;
+
+    QStringList texts;
+    for(const auto& line : this->lines)
+    {
+        if(this->IsVisible(line.channel)){
+            texts << FormatLine(line, this->selectedChannel < 0);
+        }
+    }
+    this->view->setPlainText(texts.join('\n'));
+    this->view->verticalScrollBar()->setValue(this->view->verticalScrollBar()->maximum());
+}
+
+bool EncodeLog::IsVisible(int channel) const
+{
+    return this->selectedChannel < 0 || this->selectedChannel == channel;
+}
+
+QString EncodeLog::FormatLine(const Line& line, bool withChannel) const
+{
+    //全チャンネル表示とファイルでは、どのジョブの出力か分かるようにする
+    if(withChannel == false || line.channel == generalChannel){
+        return line.text;
+    }
+    return "[" + this->channels[line.channel].title + "] " + line.text;
+}
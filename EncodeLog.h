@@ -0,0 +1,76 @@
+#ifndef ENCODELOG_H
+#define ENCODELOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QString>
+#include <QTimer>
+#include <deque>
+#include <vector>
+
+class QComboBox;
+class QPlainTextEdit;
+
+//エンコーダー出力のログ
+//行は上限付きのリングバッファに溜め、画面への反映は一定間隔でまとめて行う
+//ジョブごとにチャンネルを分け、表示するチャンネルをコンボボックスで選べる 全文はファイルに書き出す
+class EncodeLog : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int generalChannel = 0;
+    static constexpr int defaultMaxLines = 10000;
+    static constexpr int flushIntervalMs = 33;  //約30fps
+
+    EncodeLog(QPlainTextEdit* view, QComboBox* channelSelector, QObject* parent = nullptr);
+    ~EncodeLog() override;
+
+    void SetMaxLines(int num);
+
+    //ログファイルを開く 以降の行は全てファイルにも書き出す
+    bool OpenFile(const QString& filePath);
+    void CloseFile();
+    QString GetFilePath() const { return file.fileName(); }
+
+    //ジョブ用のチャンネルを追加してIDを返す
+    int AddChannel(const QString& title);
+    //行末までそろっていない出力を確定させる
+    void FinishChannel(int channel);
+
+    void Append(const QString& text){ Append(generalChannel, text); }
+    //textは改行を含む任意の断片 \rで上書きされる進捗行は最後の内容だけを残す
+    void Append(int channel, const QString& text);
+
+    //表示・リングバッファ・チャンネルを全て消す(ファイルはそのまま)
+    void Clear();
+    void Flush();
+
+private:
+    struct Line
+    {
+        int channel;
+        QString text;
+    };
+    struct Channel
+    {
+        QString title;
+        QString partialLine;
+    };
+
+    void PushLine(int channel, QString text);
+    void ShowChannel(int channel);
+    bool IsVisible(int channel) const;
+    QString FormatLine(const Line& line, bool withChannel) const;
+
+    QPlainTextEdit* view;
+    QComboBox* channelSelector;
+    QTimer flushTimer;
+    QFile file;
+    int maxLines;
+    int selectedChannel;    //-1の場合は全チャンネル
+    std::vector<Channel> channels;
+    std::deque<Line> lines;
+    std::vector<Line> pendingLines; //まだ画面・ファイルに反映していない行
+};
+
+#endif // ENCODELOG_H
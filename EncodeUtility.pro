@@ -4,14 +4,14 @@
 #
 #-------------------------------------------------
 
-QT       += core gui network
+QT       += core gui network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = EncodeUtility
 TEMPLATE = app
 CONFIG += c++2a
-QMAKE_CXXFLAGS += /std:c++20
+msvc: QMAKE_CXXFLAGS += /std:c++20
 
 TRANSLATIONS = language/lang.ja
 RC_FILE = resource.rc
@@ -28,38 +28,118 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 # Custom build step
-pre_build.commands = $$PWD/build_dependencies.bat
+win32 {
+    pre_build.commands = $$PWD/build_dependencies.bat
 
-QMAKE_EXTRA_TARGETS += pre_build
-PRE_TARGETDEPS += pre_build
+    QMAKE_EXTRA_TARGETS += pre_build
+    PRE_TARGETDEPS += pre_build
+}
 
 # Link QuaZip library
-CONFIG(debug, debug|release){
-    LIBS += -L$$PWD/lib -lquazip1-qt6d -lzlibstatic
+win32 {
+    CONFIG(debug, debug|release){
+        LIBS += -L$$PWD/lib -lquazip1-qt6d -lzlibstatic
+    } else {
+        LIBS += -L$$PWD/lib -lquazip1-qt6 -lzlibstatic
+    }
 } else {
-    LIBS += -L$$PWD/lib -lquazip1-qt6 -lzlibstatic
+    # Linux/macOSではシステムのQuaZip・zlibを使う
+    LIBS += -lquazip1-qt6 -lz
 }
 INCLUDEPATH += quazip
 INCLUDEPATH += zlib
 
+# プロセス内エンコード(qmake CONFIG+=libav で有効)
+libav {
+    DEFINES += ENCODEUTILITY_USE_LIBAV
+    win32 {
+        LIBS += -L$$PWD/lib -lavformat -lavcodec -lavutil -lswresample
+    } else {
+        CONFIG += link_pkgconfig
+        PKGCONFIG += libavformat libavcodec libavutil libswresample
+    }
+}
+
 SOURCES += \
     Encoder/AACEncoder.cpp \
+    Encoder/ArtworkPreprocessor.cpp \
+    Encoder/ClipScanner.cpp \
+    Encoder/EncodeCache.cpp \
+    Encoder/EncodeCostModel.cpp \
+    Encoder/EncodeReport.cpp \
+    Encoder/EncodeScheduler.cpp \
+    Encoder/EncoderInterface.cpp \
+    Encoder/EncoderProbe.cpp \
+    Encoder/FastFileCopy.cpp \
     Encoder/FlacEncoder.cpp \
+    Encoder/LibavEncoder.cpp \
+    Encoder/LoudnessAnalyzer.cpp \
     Encoder/MP3Encoder.cpp \
+    Encoder/MultiOutputEncoder.cpp \
+    Encoder/OutputVerifier.cpp \
+    Encoder/PcmReader.cpp \
+    Encoder/ResourceUsage.cpp \
+    Encoder/TruePeakFilter.cpp \
+    Encoder/WaveFile.cpp \
+    Encoder/WaveformPeaks.cpp \
+    Tag/FlacTagWriter.cpp \
+    Tag/ID3v2Writer.cpp \
+    Tag/MP4TagWriter.cpp \
+    Tag/TagWriter.cpp \
+    Undo/RemoveRowsCommand.cpp \
     Undo/SetTextCommand.cpp \
+    CommandLineEncoder.cpp \
+    EncodeBenchmark.cpp \
+    EncodeLog.cpp \
+    FfmpegDownloader.cpp \
+    MetadataTable.cpp \
+    ProjectFile.cpp \
+    SourceWatcher.cpp \
+    TrackAnalysis.cpp \
+    TrackIngest.cpp \
+    WaveformDelegate.cpp \
     main.cpp \
     MainWindow.cpp \
     DialogAppSettings.cpp
 
 HEADERS += \
     Encoder/AACEncoder.h \
+    Encoder/ArtworkPreprocessor.h \
+    Encoder/ClipScanner.h \
     AudioMetaData.hpp \
+    CommandLineEncoder.h \
+    EncodeLog.h \
+    FfmpegDownloader.h \
+    Encoder/EncodeCache.h \
+    Encoder/EncodeCostModel.h \
+    Encoder/EncodeReport.h \
     Encoder/EncoderInterface.h \
+    Encoder/EncoderProbe.h \
+    Encoder/EncodeScheduler.h \
+    Encoder/FastFileCopy.h \
     Encoder/FlacEncoder.h \
+    Encoder/LibavEncoder.h \
+    Encoder/LoudnessAnalyzer.h \
     Encoder/MP3Encoder.h \
+    Encoder/MultiOutputEncoder.h \
+    Encoder/OutputVerifier.h \
+    Encoder/PcmReader.h \
+    Encoder/ResourceUsage.h \
+    Encoder/SimdFloat.h \
+    Encoder/TruePeakFilter.h \
+    Encoder/WaveFile.h \
+    Encoder/WaveformPeaks.h \
     MainWindow.h \
+    MetadataTable.h \
     DialogAppSettings.h \
     ProjectDefines.hpp \
+    ProjectFile.h \
+    SourceWatcher.h \
+    TrackAnalysis.h \
+    TrackIngest.h \
+    WaveformDelegate.h \
+    Tag/TagWriter.h \
+    Undo/RemoveRowsCommand.h \
     Undo/SetTextCommand.h
 
 FORMS += \
@@ -18,55 +18,24 @@ AACEncoder::AACEncoder()
 AACEncoder::~AACEncoder(){
 }
 
-bool AACEncoder::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+QStringList AACEncoder::GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const
 {
-    QProcess* process = new QProcess(this);
-    process->setProgram(qApp->applicationDirPath()+"/ffmpeg.exe");
-    connect(process, &QProcess::readyReadStandardOutput, this, [this, process](){
-        QByteArray arr = process->readAllStandardOutput();
-        emit this->readStdOut("[aac] " + QString(arr));
-    });
-    connect(process, &QProcess::readyReadStandardError, this, [this, process](){
-        QByteArray arr = process->readAllStandardError();
-        emit this->readStdOut("[aac] " + QString(arr));
-    });
-    connect(process, &QProcess::readChannelFinished, this, [this, inputPath, metaData](){
-        emit this->encodeFinish(inputPath, metaData);
-    });
-
-    QString outputFile = GetOutputPath(metaData.title, ".m4a", processNumber);
-
     // AACエンコードオプション (AACのビットレートを指定)
     QStringList option;
-    option << "-y" << "-i" << inputPath;
     // アートワークオプションの追加
-    auto artworkPath = metaData.artworkPath.replace("\\", "/");
-    if(QFile::exists(artworkPath)){
-        option << "-i" << artworkPath
-                      << "-map" << "0" << "-map" << "1"
-                      << "-c:v" << "mjpeg" << "-disposition:v:0" << "attached_pic";
+    if(artworkInput >= 0){
+        option << "-map" << QString::number(audioInput) << "-map" << QString::number(artworkInput)
+               << "-c:v" << GetArtworkCodec(metaData) << "-disposition:v:0" << "attached_pic";
     }
-    option << "-c:a" << "aac" << "-b:a" << "320k" << "-cutoff" << "20000";
+    else{
+        //まとめてエンコードする場合は入力が複数あるので、常にこの曲の音源だけを明示して出力する
+        option << "-map" << QString::number(audioInput);
+    }
+    AppendLossyGainOption(option, metaData);
+    option << "-c:a" << GetAudioEncoderName() << "-b:a" << "320k" << "-cutoff" << "20000";
 
     // メタデータオプションの追加
-    AppendCommonMetaDataOption(option, metaData);
-
-    // 入力と出力ファイルオプションの追加
-    option << outputFile.replace("\\", "/");
-    process->setArguments(option);
-
-
-#ifdef QT_DEBUG
-    qDebug() << option;
-    emit this->readStdOut(process->program() + " ");
-    emit this->readStdOut(process->arguments().join(" ") + "\n");
-#endif
-
-    process->start();
-    if (!process->waitForStarted(-1)) {
-        qWarning() << process->errorString();
-        return false;
-    }
+    AppendCommonMetaDataOption(option, metaData, metaData.lossyGainDb);
 
-    return true;
+    return option;
 }
@@ -10,10 +10,12 @@ public:
     AACEncoder();
     ~AACEncoder() override;
 
-    bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) override;
+    QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const override;
 
     QString GetEncoderFileName() const override { return "qaac"; }
     QString GetCodecExtention() const override { return "m4a"; }
+    QString GetCodecName() const override { return "aac"; }
+    QString GetAudioEncoderName() const override { return "aac"; }
 
 private:
 
@@ -0,0 +1,76 @@
+#include "ArtworkPreprocessor.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QPainter>
+#include <QSaveFile>
+
+namespace ArtworkPreprocessor
+{
+
+bool IsJpeg(const QString& path)
+{
+    const auto suffix = QFileInfo(path).suffix().toLower();
+    return suffix == "jpg" || suffix == "jpeg";
+}
+
+QString Prepare(const QString& artworkPath, int maxSize)
+{
+    if(artworkPath.isEmpty() || QFile::exists(artworkPath) == false){
+        return artworkPath;
+    }
+
+    QImageReader reader(artworkPath);
+    const QSize size = reader.size();
+    const bool needScale = maxSize > 0 && size.isValid() && std::max(size.width(), size.height()) > maxSize;
+
+    //JPEGでサイズもそのままならコピーで埋め込めるので変換しない
+    if(IsJpeg(artworkPath) && needScale == false){
+        return artworkPath;
+    }
+
+    //同じ画像・同じサイズ指定なら前回の変換結果を使う
+    QFile file(artworkPath);
+    if(file.open(QFile::ReadOnly) == false){
+        return artworkPath;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    hash.addData(QByteArray::number(maxSize));
+    const QString cachePath = QDir::temp().absoluteFilePath("encodeutility-artwork-" + QString::fromLatin1(hash.result().toHex()) + ".jpg");
+    if(QFile::exists(cachePath)){
+        return cachePath;
+    }
+
+    //縮小はデコード時に行い、元サイズの画像を展開しない
+    if(needScale){
+        reader.setScaledSize(size.scaled(maxSize, maxSize, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if(image.isNull()){
+        return artworkPath;
+    }
+
+    //JPEGはアルファを持てないので白背景に合成する
+    if(image.hasAlphaChannel())
+    {
+        QImage opaque(image.size(), QImage::Format_RGB888);
+        opaque.fill(Qt::white);
+        QPainter painter(&opaque);
+        painter.drawImage(0, 0, image);
+        painter.end();
+        image = std::move(opaque);
+    }
+
+    QSaveFile output(cachePath);
+    if(output.open(QFile::WriteOnly) == false || image.save(&output, "JPEG", 95) == false || output.commit() == false){
+        return artworkPath;
+    }
+    return cachePath;
+}
+
+}
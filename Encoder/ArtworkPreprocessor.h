@@ -0,0 +1,17 @@
+#ifndef ARTWORKPREPROCESSOR_H
+#define ARTWORKPREPROCESSOR_H
+
+#include <QString>
+
+//エンコード開始前にジャケット画像を1回だけ埋め込み用のJPEGに変換する
+//各エンコーダーはこのJPEGを再エンコードせずにそのまま(-c:v copy)埋め込む
+namespace ArtworkPreprocessor
+{
+    //maxSizeが0より大きい場合、長辺がmaxSizeに収まるよう縮小する
+    //変換済みのJPEGのパスを返す 読み込めない画像の場合は元のパスを返す
+    QString Prepare(const QString& artworkPath, int maxSize);
+
+    bool IsJpeg(const QString& path);
+}
+
+#endif // ARTWORKPREPROCESSOR_H
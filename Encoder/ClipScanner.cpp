@@ -0,0 +1,143 @@
+#include "ClipScanner.h"
+
+#include "PcmReader.h"
+#include "SimdFloat.h"
+#include "TruePeakFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    //サンプル間ピークはこの長さごとに、区間内のサンプルピークがinterSampleScanLevel以上の所だけ補間する
+    constexpr qint64 interSampleBlockFrames = 1024;
+    //-6dBFS 現実の音源でサンプル間ピークがこれより6dB以上高くなることはまず無い
+    constexpr float interSampleScanLevel = 0.5f;
+
+    double ToDb(double value){
+        return value > 0.0 ? 20.0 * std::log10(value) : -std::numeric_limits<double>::infinity();
+    }
+
+    //1チャンネル分の状態 クリップの連続はブロックをまたいで数える
+    struct ChannelState
+    {
+        TruePeakFilter truePeak;
+        int runLength = 0;
+    };
+
+    //maskの下位numLanesビットを古い順に見て、クリップしたサンプルと連続した箇所を数える
+    void CountClipped(int mask, int numLanes, int& runLength, ClipScanner::Result& result)
+    {
+        for(int lane=0; lane<numLanes; ++lane)
+        {
+            if(mask & (1 << lane)){
+                ++runLength;
+                ++result.clippedSamples;
+                continue;
+            }
+            if(runLength >= ClipScanner::minClippedRun){ ++result.clippedRuns; }
+            runLength = 0;
+        }
+    }
+
+    //区間のサンプルピークを返す クリップの判定はclipLevel以上
+    float ScanBlock(const float* samples, qint64 frames, float clipLevel, int& runLength, ClipScanner::Result& result)
+    {
+        const Float4 threshold = Float4::Set1(clipLevel);
+        Float4 peak = Float4::Zero();
+        qint64 i = 0;
+        for(; i+4<=frames; i+=4)
+        {
+            const Float4 x = Abs(Float4::Load(samples + i));
+            peak = Max(peak, x);
+            //ほとんどの区間はクリップしていないので、比較結果だけを見て進める
+            const int mask = x.MaskAtLeast(threshold);
+            if(mask == 0 && runLength == 0){ continue; }
+            CountClipped(mask, 4, runLength, result);
+        }
+        float tailPeak = 0.0f;
+        for(; i<frames; ++i)
+        {
+            const float x = std::fabs(samples[i]);
+            tailPeak = std::max(tailPeak, x);
+            CountClipped(x >= clipLevel ? 1 : 0, 1, runLength, result);
+        }
+        return std::max(peak.MaxElement(), tailPeak);
+    }
+}
+
+namespace ClipScanner
+{
+
+double Result::GetSamplePeakDb() const
+{
+    return ToDb(this->samplePeak);
+}
+
+double Result::GetInterSamplePeakDb() const
+{
+    return ToDb(this->interSamplePeak);
+}
+
+bool Result::IsAtRisk() const
+{
+    return this->isValid && (this->clippedRuns > 0 || this->GetInterSamplePeakDb() > lossyPeakLimitDb);
+}
+
+double Result::GetLossyGainDb() const
+{
+    if(this->IsAtRisk() == false){ return 0.0; }
+    return std::min(0.0, lossyPeakLimitDb - this->GetInterSamplePeakDb());
+}
+
+Result Scan(const QString& filePath, const std::atomic_bool* isCanceled)
+{
+    Result result;
+    PcmReader reader;
+    if(reader.Open(filePath) == false){ return result; }
+
+    //整数の場合は正側の最大値(16bitなら32767/32768)に届いたらクリップとする
+    const auto& info = reader.GetInfo();
+    const float clipLevel = (info.formatTag == WaveFile::formatFloat) ? 1.0f : float(1.0 - std::ldexp(1.0, 1 - info.bitsPerSample));
+
+    const int numChannels = reader.GetNumChannels();
+    std::vector<ChannelState> states(numChannels);
+    std::vector<std::vector<float>> channels;
+    while(true)
+    {
+        if(isCanceled != nullptr && isCanceled->load()){ return Result(); }
+        const qint64 frames = reader.Read(channels);
+        if(frames <= 0){ break; }
+
+        for(int ch=0; ch<numChannels; ++ch)
+        {
+            auto& state = states[ch];
+            const float* samples = channels[ch].data();
+            for(qint64 begin=0; begin<frames; begin+=interSampleBlockFrames)
+            {
+                const qint64 length = std::min(interSampleBlockFrames, frames - begin);
+                const float peak = ScanBlock(samples + begin, length, clipLevel, state.runLength, result);
+                result.samplePeak = std::max(result.samplePeak, double(peak));
+                if(peak >= interSampleScanLevel){
+                    state.truePeak.Process(samples + begin, length);
+                }
+                else{
+                    state.truePeak.Skip(samples + begin, length);
+                }
+            }
+        }
+    }
+
+    for(auto& state : states)
+    {
+        CountClipped(0, 1, state.runLength, result);
+        result.interSamplePeak = std::max(result.interSamplePeak, double(state.truePeak.GetPeak()));
+    }
+    result.interSamplePeak = std::max(result.interSamplePeak, result.samplePeak);
+    result.isValid = true;
+    return result;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef CLIPSCANNER_H
+#define CLIPSCANNER_H
+
+#include <QString>
+#include <atomic>
+
+//エンコード前に元のwavのクリップを調べる
+//サンプルピークとクリップした箇所は全サンプルを、サンプル間ピークは大きな音がある区間だけを4倍オーバーサンプリングして求める
+namespace ClipScanner
+{
+    //この回数以上フルスケールが続いたらクリップした箇所として数える
+    static constexpr int minClippedRun = 3;
+    //非可逆圧縮はデコード後にピークが上がるので、サンプル間ピークがこれを超える曲は危ないとする(dBTP)
+    static constexpr double lossyPeakLimitDb = -1.0;
+
+    struct Result
+    {
+        bool isValid = false;
+        double samplePeak = 0.0;        //リニア
+        double interSamplePeak = 0.0;   //リニア 見積もり
+        qint64 clippedSamples = 0;
+        qint64 clippedRuns = 0;
+
+        double GetSamplePeakDb() const;
+        double GetInterSamplePeakDb() const;
+        //AAC・MP3でクリップする恐れがある
+        bool IsAtRisk() const;
+        //非可逆圧縮の出力に掛ければlossyPeakLimitDbに収まるゲイン(dB) 0以下
+        double GetLossyGainDb() const;
+    };
+
+    //読めない・対応していない形式の場合はisValidがfalse isCanceledがtrueになったら途中で止める
+    Result Scan(const QString& filePath, const std::atomic_bool* isCanceled = nullptr);
+}
+
+#endif // CLIPSCANNER_H
@@ -0,0 +1,288 @@
+#include "EncodeCache.h"
+#include "EncoderInterface.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+namespace
+{
+    constexpr int manifestVersion = 1;
+
+    QString ToHex(const QCryptographicHash& hash){
+        return QString::fromLatin1(hash.result().toHex());
+    }
+}
+
+EncodeCache::EncodeCache()
+    : isDirty(false)
+{
+}
+
+EncodeCache::~EncodeCache()
+{
+    this->Flush();
+}
+
+bool EncodeCache::Open(const QString& outputFolderPath)
+{
+    QMutexLocker locker(&mutex);
+    this->outputFolderPath = outputFolderPath;
+    this->files = QJsonObject();
+    this->outputs = QJsonObject();
+    this->isDirty = false;
+    this->saveTimer.start();
+
+    QFile file(QDir(outputFolderPath).absoluteFilePath(manifestFileName));
+    if(file.open(QFile::ReadOnly) == false){
+        return false;
+    }
+
+    const auto root = QJsonDocument::fromJson(file.readAll()).object();
+    //形式が変わっていたら全て作り直す
+    if(root.value("version").toInt() != manifestVersion){
+        return false;
+    }
+    this->files = root.value("files").toObject();
+    this->outputs = root.value("outputs").toObject();
+    return true;
+}
+
+bool EncodeCache::Save() const
+{
+    QMutexLocker locker(&mutex);
+    if(outputFolderPath.isEmpty()){ return false; }
+
+    QJsonObject root;
+    root.insert("version", manifestVersion);
+    root.insert("files", files);
+    root.insert("outputs", outputs);
+
+    //書き込み途中で終了してもマニフェストが壊れないようにする
+    QSaveFile file(QDir(outputFolderPath).absoluteFilePath(manifestFileName));
+    if(file.open(QFile::WriteOnly) == false){ return false; }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+bool EncodeCache::Flush()
+{
+    {
+        QMutexLocker locker(&mutex);
+        if(isDirty == false){ return true; }
+        isDirty = false;
+        saveTimer.start();
+    }
+    if(Save()){ return true; }
+
+    QMutexLocker locker(&mutex);
+    isDirty = true;
+    return false;
+}
+
+QFuture<QString> EncodeCache::PrepareFiles(const QStringList& filePaths)
+{
+    QStringList paths = filePaths;
+    paths.removeDuplicates();
+    return QtConcurrent::mapped(paths, [this](const QString& path){
+        return this->HashFile(path);
+    });
+}
+
+EncodeCache::Key EncodeCache::MakeKey(const EncoderInterface& encoder, const QString& inputPath, const AudioMetaData& metaData, int processNumber)
+{
+    const auto arguments = encoder.BuildArguments(inputPath, metaData, processNumber);
+
+    Key key;
+    key.source    = HashFile(inputPath);
+    key.metaData  = HashMetaData(metaData, arguments);
+    key.artwork   = metaData.artworkPath.isEmpty() ? QString() : HashFile(metaData.artworkPath);
+    key.options   = HashOptions(arguments);
+    key.arguments = HashArguments(arguments);
+    key.outputs   = encoder.GetOutputFilePaths(metaData, processNumber);
+    return key;
+}
+
+bool EncodeCache::IsUpToDate(const Key& key) const
+{
+    if(key.source.isEmpty() || key.outputs.isEmpty()){ return false; }
+
+    QMutexLocker locker(&mutex);
+    const auto entry = outputs.value(RelativePath(key.outputs.first())).toObject();
+    if(entry.isEmpty()){ return false; }
+
+    if(entry.value("source").toString()    != key.source   ||
+       entry.value("metadata").toString()  != key.metaData ||
+       entry.value("artwork").toString()   != key.artwork  ||
+       entry.value("options").toString()   != key.options  ||
+       entry.value("arguments").toString() != key.arguments)
+    {
+        return false;
+    }
+
+    return IsOutputsUnchanged(entry, key);
+}
+
+bool EncodeCache::IsTagOnlyChange(const Key& key) const
+{
+    if(key.source.isEmpty() || key.outputs.isEmpty()){ return false; }
+
+    QMutexLocker locker(&mutex);
+    const auto entry = outputs.value(RelativePath(key.outputs.first())).toObject();
+    if(entry.isEmpty()){ return false; }
+
+    if(entry.value("source").toString()  != key.source ||
+       entry.value("options").toString() != key.options)
+    {
+        return false;
+    }
+    if(entry.value("metadata").toString()  == key.metaData &&
+       entry.value("artwork").toString()   == key.artwork  &&
+       entry.value("arguments").toString() == key.arguments)
+    {
+        return false;
+    }
+    return IsOutputsUnchanged(entry, key);
+}
+
+void EncodeCache::Store(const Key& key)
+{
+    if(key.outputs.isEmpty()){ return; }
+    bool isSaveTime = false;
+    {
+        QMutexLocker locker(&mutex);
+        QJsonArray outputFiles;
+        for(const auto& path : key.outputs)
+        {
+            QFileInfo info(path);
+            QJsonObject output;
+            output.insert("path", RelativePath(path));
+            output.insert("size", info.size());
+            output.insert("mtime", info.lastModified().toMSecsSinceEpoch());
+            outputFiles.append(output);
+        }
+
+        QJsonObject entry;
+        entry.insert("source", key.source);
+        entry.insert("metadata", key.metaData);
+        entry.insert("artwork", key.artwork);
+        entry.insert("options", key.options);
+        entry.insert("arguments", key.arguments);
+        entry.insert("outputs", outputFiles);
+        outputs.insert(RelativePath(key.outputs.first()), entry);
+        //毎回書き出すと曲数の2乗の時間が掛かるので、間隔を空ける
+        isDirty = true;
+        isSaveTime = (saveTimer.isValid() == false || saveTimer.elapsed() >= saveIntervalMs);
+    }
+    if(isSaveTime){
+        Flush();
+    }
+}
+
+QString EncodeCache::HashMetaData(const AudioMetaData& metaData, const QStringList& arguments)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for(const auto* value : {&metaData.title, &metaData.track_no, &metaData.artist, &metaData.albumTitle,
+                             &metaData.albumArtist, &metaData.genre, &metaData.group, &metaData.composer, &metaData.year})
+    {
+        hash.addData(value->toUtf8());
+        hash.addData(QByteArrayView("\0", 1));
+    }
+    for(int i=0; i+1<arguments.size(); ++i)
+    {
+        if(arguments[i] == "-metadata"){
+            hash.addData(arguments[i+1].toUtf8());
+            hash.addData(QByteArrayView("\0", 1));
+        }
+    }
+    return ToHex(hash);
+}
+
+QString EncodeCache::HashArguments(const QStringList& arguments)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for(const auto& arg : arguments)
+    {
+        hash.addData(arg.toUtf8());
+        hash.addData(QByteArrayView("\0", 1));
+    }
+    return ToHex(hash);
+}
+
+QString EncodeCache::HashOptions(const QStringList& arguments)
+{
+    QStringList options;
+    for(int i=0; i<arguments.size(); ++i)
+    {
+        //入力のパス(元wav・アートワークの一時ファイル)は中身をsource・artworkで別に見ているので含めない
+        if(arguments[i] == "-metadata" || arguments[i] == "-i"){
+            ++i;
+            continue;
+        }
+        options << arguments[i];
+    }
+    return HashArguments(options);
+}
+
+QString EncodeCache::HashFile(const QString& filePath)
+{
+    QFileInfo info(filePath);
+    if(info.exists() == false){ return QString(); }
+
+    const QString path = info.absoluteFilePath();
+    const qint64 size  = info.size();
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&mutex);
+        const auto entry = files.value(path).toObject();
+        if(entry.value("size").toInteger() == size && entry.value("mtime").toInteger() == mtime){
+            const auto sha256 = entry.value("sha256").toString();
+            if(sha256.isEmpty() == false){ return sha256; }
+        }
+    }
+
+    QFile file(path);
+    if(file.open(QFile::ReadOnly) == false){ return QString(); }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if(hash.addData(&file) == false){ return QString(); }
+    const auto sha256 = ToHex(hash);
+
+    QMutexLocker locker(&mutex);
+    QJsonObject entry;
+    entry.insert("size", size);
+    entry.insert("mtime", mtime);
+    entry.insert("sha256", sha256);
+    files.insert(path, entry);
+    return sha256;
+}
+
+QString EncodeCache::RelativePath(const QString& path) const
+{
+    return QDir(outputFolderPath).relativeFilePath(path);
+}
+
+bool EncodeCache::IsOutputsUnchanged(const QJsonObject& entry, const Key& key) const
+{
+    //出力ファイルが消されたり、外部で書き換えられていないか
+    const auto outputFiles = entry.value("outputs").toArray();
+    if(outputFiles.size() != key.outputs.size()){ return false; }
+    for(const auto& value : outputFiles)
+    {
+        const auto output = value.toObject();
+        QFileInfo info(QDir(outputFolderPath).absoluteFilePath(output.value("path").toString()));
+        if(info.exists() == false ||
+           info.size() != output.value("size").toInteger() ||
+           info.lastModified().toMSecsSinceEpoch() != output.value("mtime").toInteger())
+        {
+            return false;
+        }
+    }
+    return true;
+}
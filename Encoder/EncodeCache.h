@@ -0,0 +1,79 @@
+#ifndef ENCODECACHE_H
+#define ENCODECACHE_H
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QMutex>
+
+#include "AudioMetaData.hpp"
+
+class EncoderInterface;
+
+//出力フォルダに置くマニフェストで、前回と同じ入力・設定の出力を再エンコードしないようにする
+//キーは元wavの内容・メタデータ・アートワーク・ffmpegの引数のハッシュ
+class EncodeCache
+{
+public:
+    static constexpr char manifestFileName[] = ".encodeutility-cache.json";
+    //Storeの後、前回の保存からこれだけ経っていればマニフェストを書き出す(ミリ秒)
+    static constexpr qint64 saveIntervalMs = 5000;
+
+    //出力ごとのキー
+    struct Key
+    {
+        QString source;     //元wavの内容
+        QString metaData;   //AudioMetaDataの各項目
+        QString artwork;    //アートワークの内容
+        QString options;    //メタデータと入力のパスを除いたffmpegの引数
+        QString arguments;  //ffmpegの引数全体
+        QStringList outputs;
+    };
+
+    EncodeCache();
+    ~EncodeCache();
+
+    //出力フォルダのマニフェストを読み込む
+    bool Open(const QString& outputFolderPath);
+    bool Save() const;
+    //Storeで変更があった場合だけ保存する
+    bool Flush();
+    bool IsOpened() const { return outputFolderPath.isEmpty() == false; }
+
+    //元ファイルのハッシュをスレッドプールで事前計算する(サイズと更新日時が変わっていなければ再計算しない)
+    //終わるまで待たないので、完了はQFutureWatcherで受け取る
+    QFuture<QString> PrepareFiles(const QStringList& filePaths);
+
+    Key MakeKey(const EncoderInterface& encoder, const QString& inputPath, const AudioMetaData& metaData, int processNumber);
+
+    //前回と同じキーで出力済み、かつ出力ファイルがその時のままならtrue
+    bool IsUpToDate(const Key& key) const;
+    //元wavとエンコード設定は同じで、メタデータかアートワークだけが変わった場合はtrue
+    //このときはタグの書き換えだけで済む
+    bool IsTagOnlyChange(const Key& key) const;
+    //エンコード成功後に記録する 保存は一定間隔ごとかFlushで行う
+    void Store(const Key& key);
+
+    //AudioMetaDataの各項目と、引数中の-metadataの値(曲数など)のハッシュ
+    static QString HashMetaData(const AudioMetaData& metaData, const QStringList& arguments);
+    static QString HashArguments(const QStringList& arguments);
+    //-metadataの値と入力のパスを取り除いた引数のハッシュ
+    static QString HashOptions(const QStringList& arguments);
+
+private:
+    QString HashFile(const QString& filePath);
+    QString RelativePath(const QString& path) const;
+    //マニフェストに記録した出力ファイルが、その時のまま残っているか(mutexを取得済みで呼ぶ)
+    bool IsOutputsUnchanged(const QJsonObject& entry, const Key& key) const;
+
+    QString outputFolderPath;
+    QJsonObject files;      //パス → {size, mtime, sha256}
+    QJsonObject outputs;    //出力パス → キー
+    bool isDirty;           //Storeした内容をまだ保存していない
+    QElapsedTimer saveTimer;
+    mutable QMutex mutex;
+};
+
+#endif // ENCODECACHE_H
@@ -0,0 +1,74 @@
+#include "EncodeCostModel.h"
+#include "ProjectDefines.hpp"
+
+#include <QSettings>
+
+EncodeCostModel::EncodeCostModel()
+    : isModified(false)
+{
+}
+
+void EncodeCostModel::Load()
+{
+    this->factors.clear();
+    this->isModified = false;
+    if(ProjectDefines::settingFilePath.isEmpty()){ return; }
+
+    QSettings settingfile(ProjectDefines::settingFilePath, QSettings::IniFormat);
+    settingfile.beginGroup(ProjectDefines::settingEncodeCostFactors);
+    for(const auto& codecName : settingfile.childKeys())
+    {
+        bool isOk = false;
+        const double factor = settingfile.value(codecName).toDouble(&isOk);
+        if(isOk && factor > 0.0){
+            this->factors[codecName] = factor;
+        }
+    }
+    settingfile.endGroup();
+}
+
+void EncodeCostModel::Save()
+{
+    if(this->isModified == false || ProjectDefines::settingFilePath.isEmpty()){ return; }
+
+    QSettings settingfile(ProjectDefines::settingFilePath, QSettings::IniFormat);
+    settingfile.beginGroup(ProjectDefines::settingEncodeCostFactors);
+    for(const auto& [codecName, factor] : this->factors){
+        settingfile.setValue(codecName, factor);
+    }
+    settingfile.endGroup();
+    this->isModified = false;
+}
+
+double EncodeCostModel::GetFactor(const QString& codecName) const
+{
+    auto itr = this->factors.find(codecName);
+    if(itr != this->factors.end()){
+        return itr->second;
+    }
+    if(this->factors.empty()){ return 1.0; }
+    double sum = 0.0;
+    for(const auto& [name, factor] : this->factors){ sum += factor; }
+    return sum / this->factors.size();
+}
+
+double EncodeCostModel::Estimate(const QString& codecName, double durationSeconds) const
+{
+    return durationSeconds * this->GetFactor(codecName);
+}
+
+void EncodeCostModel::Learn(const QString& codecName, double durationSeconds, double wallSeconds)
+{
+    //短すぎる曲は起動時間が支配的で係数が大きく振れるので学習しない
+    if(durationSeconds < 1.0 || wallSeconds <= 0.0){ return; }
+
+    const double measured = wallSeconds / durationSeconds;
+    auto itr = this->factors.find(codecName);
+    if(itr == this->factors.end()){
+        this->factors[codecName] = measured;
+    }
+    else{
+        itr->second += (measured - itr->second) * learningRate;
+    }
+    this->isModified = true;
+}
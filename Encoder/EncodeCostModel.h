@@ -0,0 +1,31 @@
+#ifndef ENCODECOSTMODEL_H
+#define ENCODECOSTMODEL_H
+
+#include <QString>
+#include <map>
+
+//ジョブの処理時間の見積もり 元の長さ x コーデックごとの係数(音声1秒あたりのエンコード秒数)
+//係数は実際にエンコードした結果から学習し、設定ファイルに保存して次回以降も使う
+class EncodeCostModel
+{
+public:
+    //新しい測定値を反映する割合
+    static constexpr double learningRate = 0.3;
+
+    EncodeCostModel();
+
+    void Load();
+    void Save();
+
+    //まだ学習していないコーデックは学習済みの係数の平均(何も無ければ1)とする
+    double GetFactor(const QString& codecName) const;
+    double Estimate(const QString& codecName, double durationSeconds) const;
+
+    void Learn(const QString& codecName, double durationSeconds, double wallSeconds);
+
+private:
+    std::map<QString, double> factors;
+    bool isModified;
+};
+
+#endif // ENCODECOSTMODEL_H
@@ -0,0 +1,156 @@
+#include "EncodeReport.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace
+{
+    //区切り文字や改行を含む値だけを""で囲む
+    QString CsvField(QString value)
+    {
+        if(value.contains(',') || value.contains('"') || value.contains('\n') || value.contains('\r')){
+            value.replace("\"", "\"\"");
+            return "\"" + value + "\"";
+        }
+        return value;
+    }
+
+    QString Number(double value){
+        return QString::number(value, 'f', 3);
+    }
+
+    bool WriteFile(const QString& filePath, const QByteArray& data)
+    {
+        QSaveFile file(filePath);
+        if(file.open(QFile::WriteOnly) == false){ return false; }
+        file.write(data);
+        return file.commit();
+    }
+}
+
+namespace EncodeReport
+{
+
+bool Write(const QString& folderPath, const std::vector<EncodeJob>& finishedJobs)
+{
+    if(QDir().mkpath(folderPath) == false){ return false; }
+
+    //終わった順ではなく曲順・コーデック順に並べる
+    std::vector<const EncodeJob*> jobs;
+    jobs.reserve(finishedJobs.size());
+    for(const auto& job : finishedJobs){ jobs.push_back(&job); }
+    std::stable_sort(jobs.begin(), jobs.end(), [](const EncodeJob* a, const EncodeJob* b){
+        if(a->processNumber != b->processNumber){ return a->processNumber < b->processNumber; }
+        return a->encoder->GetCodecName() < b->encoder->GetCodecName();
+    });
+
+    //Excelで開いても日本語が化けないようBOMを付ける
+    QString csv = QString::fromUtf8("\xEF\xBB\xBF");
+    csv += "track,title,codec,result,duration_s,queue_wait_s,wall_s,cpu_user_s,cpu_sys_s,cpu_utilization,peak_rss_bytes,input_bytes,output_bytes,compression_ratio,input,outputs\n";
+
+    QJsonArray jobArray;
+    double elapsedSeconds = 0.0;
+    double totalCpuSeconds = 0.0;
+    qint64 maxPeakRssBytes = -1;
+    qint64 totalInputBytes = 0;
+    qint64 totalOutputBytes = 0;
+    for(const auto* job : jobs)
+    {
+        const auto& stats = job->stats;
+        const double wallSeconds = stats.GetWallSeconds();
+        const double cpuUtilization = wallSeconds > 0.0 ? stats.usage.GetCpuSeconds() / wallSeconds : 0.0;
+        const QStringList outputs = job->encoder->GetOutputFilePaths(job->metaData, job->processNumber);
+
+        csv += QStringList{
+            QString::number(job->processNumber + 1),
+            CsvField(job->metaData.title),
+            job->encoder->GetCodecName(),
+            GetResultName(stats.result),
+            Number(job->progress.durationSeconds),
+            Number(stats.GetQueueWaitSeconds()),
+            Number(wallSeconds),
+            Number(stats.usage.userSeconds),
+            Number(stats.usage.systemSeconds),
+            Number(cpuUtilization),
+            QString::number(stats.usage.peakRssBytes),
+            QString::number(stats.inputBytes),
+            QString::number(stats.outputBytes),
+            Number(stats.GetCompressionRatio()),
+            CsvField(job->inputPath),
+            CsvField(outputs.join(';')),
+        }.join(',') + "\n";
+
+        QJsonObject object;
+        object["track"] = job->processNumber + 1;
+        object["title"] = job->metaData.title;
+        object["codec"] = job->encoder->GetCodecName();
+        object["result"] = GetResultName(stats.result);
+        object["durationSeconds"] = job->progress.durationSeconds;
+        object["queueWaitSeconds"] = stats.GetQueueWaitSeconds();
+        object["wallSeconds"] = wallSeconds;
+        object["cpuUserSeconds"] = stats.usage.userSeconds;
+        object["cpuSystemSeconds"] = stats.usage.systemSeconds;
+        object["cpuUtilization"] = cpuUtilization;
+        object["peakRssBytes"] = stats.usage.peakRssBytes;
+        object["inputBytes"] = stats.inputBytes;
+        object["outputBytes"] = stats.outputBytes;
+        object["compressionRatio"] = stats.GetCompressionRatio();
+        object["input"] = job->inputPath;
+        object["outputs"] = QJsonArray::fromStringList(outputs);
+        object["verifySeconds"] = stats.verifySeconds;
+        if(job->verifyMessages.isEmpty() == false){
+            object["verifyMessages"] = QJsonArray::fromStringList(job->verifyMessages);
+        }
+        jobArray.append(object);
+
+        elapsedSeconds = std::max(elapsedSeconds, stats.finishedSeconds + stats.verifySeconds);
+        totalCpuSeconds += stats.usage.GetCpuSeconds();
+        maxPeakRssBytes = std::max(maxPeakRssBytes, stats.usage.peakRssBytes);
+        totalInputBytes += stats.inputBytes;
+        totalOutputBytes += stats.outputBytes;
+    }
+
+    QJsonObject summary;
+    summary["jobs"] = static_cast<int>(jobs.size());
+    summary["elapsedSeconds"] = elapsedSeconds;
+    summary["cpuSeconds"] = totalCpuSeconds;
+    //平均して何コア分使っていたか
+    summary["averageCpuCores"] = elapsedSeconds > 0.0 ? totalCpuSeconds / elapsedSeconds : 0.0;
+    summary["maxPeakRssBytes"] = maxPeakRssBytes;
+    summary["inputBytes"] = totalInputBytes;
+    summary["outputBytes"] = totalOutputBytes;
+    summary["compressionRatio"] = totalOutputBytes > 0 ? double(totalInputBytes) / double(totalOutputBytes) : 0.0;
+
+    QJsonObject root;
+    root["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["summary"] = summary;
+    root["jobs"] = jobArray;
+
+    const QDir folder(folderPath);
+    const bool isCsvWritten = WriteFile(folder.filePath(csvFileName), csv.toUtf8());
+    const bool isJsonWritten = WriteFile(folder.filePath(jsonFileName), QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return isCsvWritten && isJsonWritten;
+}
+
+QString GetResultName(EncodeJobStats::Result result)
+{
+    switch(result)
+    {
+    case EncodeJobStats::Result::Encoded:       return "encoded";
+    case EncodeJobStats::Result::Skipped:       return "skipped";
+    case EncodeJobStats::Result::TagUpdated:    return "tag-updated";
+    case EncodeJobStats::Result::Failed:        return "failed";
+    case EncodeJobStats::Result::VerifyFailed:  return "verify-failed";
+    case EncodeJobStats::Result::Pending:       break;
+    }
+    return "pending";
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef ENCODEREPORT_H
+#define ENCODEREPORT_H
+
+#include <QString>
+#include <vector>
+
+#include "EncodeScheduler.h"
+
+//ジョブ(曲 x コーデック)ごとの計測値を出力フォルダにCSV・JSONで書き出す
+//遅い曲を探したり、エンコード用マシンのコア数・メモリを見積もるためのもの
+namespace EncodeReport
+{
+    static constexpr char csvFileName[]  = "encode-report.csv";
+    static constexpr char jsonFileName[] = "encode-report.json";
+
+    //どちらかの書き込みに失敗した場合はfalse
+    bool Write(const QString& folderPath, const std::vector<EncodeJob>& jobs);
+
+    QString GetResultName(EncodeJobStats::Result result);
+}
+
+#endif // ENCODEREPORT_H
@@ -0,0 +1,571 @@
+#include "EncodeScheduler.h"
+#include "OutputVerifier.h"
+
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+EncodeScheduler::EncodeScheduler(QObject* parent)
+    : QObject(parent)
+    , maxParallelJobs(QThread::idealThreadCount())
+    , numFinished(0)
+    , numTotal(0)
+    , isRunning(false)
+    , isQueueSorted(false)
+    , isBatchEncode(false)
+    , isVerifyOutputs(false)
+    , isLearnCost(true)
+    , isPreparing(false)
+    , numVerifying(0)
+    , numTagUpdating(0)
+    , isCanceled(false)
+    , nextProcessId(0)
+    , totalSeconds(0.0)
+    , finishedSeconds(0.0)
+    , verifyingSeconds(0.0)
+{
+}
+
+EncodeScheduler::~EncodeScheduler()
+{
+    //計算中のスレッドがキャッシュを使っているので、終わるまで待つ
+    this->prepareFuture.cancel();
+    this->prepareFuture.waitForFinished();
+    if(this->cache){
+        this->cache->Flush();
+    }
+}
+
+void EncodeScheduler::SetMaxParallelJobs(int num)
+{
+    if(num <= 0){
+        num = QThread::idealThreadCount();
+    }
+    this->maxParallelJobs = std::max(num, 1);
+}
+
+void EncodeScheduler::AddEncoder(const std::shared_ptr<EncoderInterface>& encoder)
+{
+    const EncoderInterface* key = encoder.get();
+    connect(encoder.get(), &EncoderInterface::encodeError, this, [this, key](const QString, const AudioMetaData&, int processNumber, QString){
+        this->OnEncodeError(key, processNumber);
+    });
+    connect(encoder.get(), &EncoderInterface::encodeFinish, this, [this, key](const QString, const AudioMetaData&, int processNumber){
+        this->OnEncodeFinish(key, processNumber);
+    });
+    connect(encoder.get(), &EncoderInterface::encodeProgress, this, [this, key](int processNumber, const EncodeProgress& progress){
+        this->OnEncodeProgress(key, processNumber, progress);
+    });
+    connect(encoder.get(), &EncoderInterface::encodeUsage, this, [this, key](int processNumber, const ResourceUsage::Usage& usage){
+        this->OnEncodeUsage(key, processNumber, usage);
+    });
+}
+
+void EncodeScheduler::SetCache(std::shared_ptr<EncodeCache> cache)
+{
+    this->cache = std::move(cache);
+}
+
+void EncodeScheduler::Enqueue(EncodeJob job)
+{
+    //前回の実行が終わっていれば集計をリセットする
+    if(this->isRunning == false && this->queue.empty()){
+        this->numFinished = 0;
+        this->numTotal = 0;
+        this->totalSeconds = 0.0;
+        this->finishedSeconds = 0.0;
+        this->finishedJobs.clear();
+    }
+    job.progress.durationSeconds = EncoderInterface::GetInputDuration(job.inputPath, job.metaData);
+    job.stats.enqueuedSeconds = this->GetElapsedSeconds();
+    job.stats.inputBytes = QFileInfo(job.inputPath).size();
+    this->totalSeconds += job.progress.durationSeconds;
+
+    //実行中に追加されたジョブは空きが出た時点で投入される
+    this->queue.emplace_back(std::move(job));
+    this->numTotal++;
+    this->isQueueSorted = false;
+    if(this->isRunning){
+        this->Dispatch();
+    }
+    else{
+        this->NotifyProgress();
+    }
+}
+
+void EncodeScheduler::Start()
+{
+    if(this->isRunning){ return; }
+    this->isRunning = true;
+    this->isCanceled = false;
+    this->elapsedTimer.start();
+    //開始前に積まれたジョブの待ち時間はStartから数える
+    for(auto& job : this->queue){
+        job.stats.enqueuedSeconds = 0.0;
+    }
+    this->costModel.Load();
+    this->isQueueSorted = false;
+
+    if(this->cache)
+    {
+        //キーの計算で待たされないよう、入力ファイルのハッシュを先にまとめて求める
+        QStringList inputFiles;
+        for(const auto& job : this->queue){
+            inputFiles << job.inputPath << job.metaData.artworkPath;
+        }
+        inputFiles.removeAll(QString());
+
+        //数百曲のハッシュで画面が止まらないよう、スレッドプールで計算し終わってから投入を始める
+        this->isPreparing = true;
+        auto* watcher = new QFutureWatcher<QString>(this);
+        connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher](){
+            this->isPreparing = false;
+            watcher->deleteLater();
+            this->Dispatch();
+        });
+        this->prepareFuture = this->cache->PrepareFiles(inputFiles);
+        watcher->setFuture(this->prepareFuture);
+        this->NotifyProgress();
+        return;
+    }
+
+    this->Dispatch();
+}
+
+void EncodeScheduler::Cancel()
+{
+    //起動済みのプロセスは止めず、待ち行列だけを破棄する
+    this->numTotal -= static_cast<int>(this->queue.size());
+    for(const auto& job : this->queue){
+        this->totalSeconds -= job.progress.durationSeconds;
+    }
+    this->queue.clear();
+    this->isCanceled = true;
+    if(this->cache){
+        this->cache->Flush();
+    }
+    this->Dispatch();
+}
+
+void EncodeScheduler::Dispatch()
+{
+    //ハッシュの計算中に追加・中止された分は、計算が終わった時にまとめて反映する
+    if(this->isPreparing){
+        this->NotifyProgress();
+        return;
+    }
+    if(this->isQueueSorted == false){
+        this->SortQueue();
+    }
+    while(static_cast<int>(this->runningProcesses.size()) + this->numVerifying + this->numTagUpdating < this->maxParallelJobs && this->queue.empty() == false)
+    {
+        EncodeJob job = std::move(this->queue.front());
+        this->queue.pop_front();
+        job.stats.startedSeconds = this->GetElapsedSeconds();
+        const CacheState cacheState = this->CheckCache(job);
+        if(cacheState == CacheState::Finished){ continue; }
+        if(cacheState == CacheState::TagOnly){
+            this->StartTagUpdate(std::move(job));
+            continue;
+        }
+
+        std::vector<EncodeJob> jobs = this->TakeBatch(std::move(job));
+        const int processId = this->nextProcessId++;
+        std::vector<EncodeBatchItem> items;
+        for(auto& batchJob : jobs)
+        {
+            batchJob.batchSize = static_cast<int>(jobs.size());
+            const JobKey key{batchJob.encoder.get(), batchJob.processNumber};
+            this->runningJobs.emplace(key, batchJob);
+            this->jobProcesses[key] = processId;
+            items.push_back({batchJob.inputPath, batchJob.metaData, batchJob.processNumber});
+        }
+        this->runningProcesses[processId] = static_cast<int>(jobs.size());
+
+        const auto& encoder = jobs.front().encoder;
+        const bool isStarted = (jobs.size() == 1) ? encoder->Encode(items.front().inputPath, items.front().metaData, items.front().processNumber)
+                                                  : encoder->EncodeBatch(items);
+        if(isStarted){
+            for(const auto& batchJob : jobs){ emit this->jobStarted(batchJob); }
+            continue;
+        }
+        this->runningProcesses.erase(processId);
+        for(auto& batchJob : jobs)
+        {
+            const JobKey key{batchJob.encoder.get(), batchJob.processNumber};
+            this->runningJobs.erase(key);
+            this->jobProcesses.erase(key);
+            this->cacheKeys.erase(key);
+            this->CountFinished(batchJob, EncodeJobStats::Result::Failed);
+            emit this->jobFailed(batchJob);
+        }
+    }
+
+    this->NotifyProgress();
+
+    if(this->isRunning && this->queue.empty() && this->runningJobs.empty() && this->numVerifying == 0 && this->numTagUpdating == 0)
+    {
+        this->isRunning = false;
+        if(this->isLearnCost){
+            this->costModel.Save();
+        }
+        if(this->cache){
+            this->cache->Flush();
+        }
+        emit this->allFinished();
+    }
+}
+
+EncodeScheduler::CacheState EncodeScheduler::CheckCache(EncodeJob& job)
+{
+    if(!this->cache){ return CacheState::Encode; }
+
+    auto cacheKey = this->cache->MakeKey(*job.encoder, job.inputPath, job.metaData, job.processNumber);
+    if(this->cache->IsUpToDate(cacheKey)){
+        this->CountFinished(job, EncodeJobStats::Result::Skipped);
+        emit this->jobSkipped(job);
+        return CacheState::Finished;
+    }
+    //メタデータだけが変わった場合はタグを直接書き換える 失敗したら通常通りエンコードする
+    const bool isTagOnly = (job.isTagUpdateFailed == false && this->cache->IsTagOnlyChange(cacheKey));
+    this->cacheKeys[{job.encoder.get(), job.processNumber}] = std::move(cacheKey);
+    return isTagOnly ? CacheState::TagOnly : CacheState::Encode;
+}
+
+void EncodeScheduler::StartTagUpdate(EncodeJob job)
+{
+    //mp3はID3の余白が足りないとファイル全体を書き直すので、UIを止めないようスレッドプールで行う
+    //エンコーダーの設定を読むので、引数はこのスレッドで作っておく
+    const JobKey key{job.encoder.get(), job.processNumber};
+    const QStringList arguments = job.encoder->BuildArguments(job.inputPath, job.metaData, job.processNumber);
+    const QStringList outputs = this->cacheKeys.at(key).outputs;
+    const QString artworkPath = job.metaData.artworkPath;
+    this->numTagUpdating++;
+
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, job, key]() mutable {
+        this->numTagUpdating--;
+        auto cacheItr = this->cacheKeys.find(key);
+        if(watcher->result())
+        {
+            if(this->cache && cacheItr != this->cacheKeys.end()){
+                this->cache->Store(cacheItr->second);
+            }
+            this->CountFinished(job, EncodeJobStats::Result::TagUpdated);
+            emit this->jobTagUpdated(job);
+        }
+        else if(this->isCanceled)
+        {
+            //中止した後は待ち行列に戻さず、破棄したジョブと同じに扱う
+            this->numTotal--;
+            this->totalSeconds -= job.progress.durationSeconds;
+        }
+        else
+        {
+            //対応していない構造だった場合は、先頭に戻して通常通りエンコードする
+            job.isTagUpdateFailed = true;
+            this->queue.emplace_front(std::move(job));
+        }
+        if(cacheItr != this->cacheKeys.end()){
+            this->cacheKeys.erase(cacheItr);
+        }
+        watcher->deleteLater();
+        this->Dispatch();
+    });
+    watcher->setFuture(QtConcurrent::run([arguments, outputs, artworkPath](){
+        return WriteTags(arguments, outputs, artworkPath);
+    }));
+}
+
+std::vector<EncodeJob> EncodeScheduler::TakeBatch(EncodeJob first)
+{
+    std::vector<EncodeJob> jobs;
+    const bool isBatchable = this->IsBatchable(first);
+    jobs.emplace_back(std::move(first));
+    if(isBatchable == false){ return jobs; }
+
+    //残っている短い曲を同時実行数で割った長さを上限にし、まとめすぎて並列に動かせなくなるのを避ける
+    const EncoderInterface* encoder = jobs.front().encoder.get();
+    double queuedSeconds = jobs.front().progress.durationSeconds;
+    for(const auto& job : this->queue){
+        if(job.encoder.get() == encoder && this->IsBatchable(job)){
+            queuedSeconds += job.progress.durationSeconds;
+        }
+    }
+    const double targetSeconds = std::min(batchTargetSeconds, queuedSeconds / this->maxParallelJobs);
+
+    double batchSeconds = jobs.front().progress.durationSeconds;
+    auto itr = this->queue.begin();
+    while(itr != this->queue.end() && batchSeconds < targetSeconds && static_cast<int>(jobs.size()) < maxBatchTracks)
+    {
+        if(itr->encoder.get() != encoder || this->IsBatchable(*itr) == false){
+            ++itr;
+            continue;
+        }
+        itr->stats.startedSeconds = this->GetElapsedSeconds();
+        const CacheState cacheState = this->CheckCache(*itr);
+        //タグだけの書き換えはまとめず、枠が空いた時に行う
+        if(cacheState == CacheState::TagOnly){
+            ++itr;
+            continue;
+        }
+        EncodeJob job = std::move(*itr);
+        itr = this->queue.erase(itr);
+        if(cacheState == CacheState::Finished){ continue; }
+        batchSeconds += job.progress.durationSeconds;
+        jobs.emplace_back(std::move(job));
+    }
+    return jobs;
+}
+
+bool EncodeScheduler::IsBatchable(const EncodeJob& job) const
+{
+    return this->isBatchEncode && job.encoder->IsBatchSupported()
+        && job.progress.durationSeconds > 0.0 && job.progress.durationSeconds <= batchMaxTrackSeconds;
+}
+
+bool EncodeScheduler::WriteTags(const QStringList& arguments, const QStringList& outputs, const QString& artworkPath, bool isMp4Only)
+{
+    for(int i=0; i<outputs.size(); ++i)
+    {
+        if(isMp4Only && IsMp4Output(outputs[i]) == false){ continue; }
+        auto tags = TagWriter::Tags::FromArguments(arguments, outputs, i);
+        if(tags.LoadPicture(artworkPath) == false){ return false; }
+        if(TagWriter::Write(outputs[i], tags) == false){ return false; }
+    }
+    return true;
+}
+
+bool EncodeScheduler::IsMp4Output(const QString& path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == "m4a" || suffix == "mp4";
+}
+
+bool EncodeScheduler::HasLoudnessTags(const AudioMetaData& metaData)
+{
+    return metaData.replayGainTrackGain.isEmpty() == false || metaData.iTunNORM.isEmpty() == false;
+}
+
+void EncodeScheduler::OnEncodeError(const EncoderInterface* encoder, int processNumber)
+{
+    auto itr = this->runningJobs.find({encoder, processNumber});
+    if(itr == this->runningJobs.end()){ return; }
+    itr->second.isFailed = true;
+}
+
+void EncodeScheduler::OnEncodeFinish(const EncoderInterface* encoder, int processNumber)
+{
+    const JobKey key{encoder, processNumber};
+    auto itr = this->runningJobs.find(key);
+    if(itr == this->runningJobs.end()){ return; }
+
+    EncodeJob job = std::move(itr->second);
+    this->runningJobs.erase(itr);
+    //まとめてエンコードしたジョブが全て終わった時点でプロセスの枠を空ける
+    auto processItr = this->jobProcesses.find(key);
+    if(processItr != this->jobProcesses.end())
+    {
+        auto countItr = this->runningProcesses.find(processItr->second);
+        if(countItr != this->runningProcesses.end() && --countItr->second <= 0){
+            this->runningProcesses.erase(countItr);
+        }
+        this->jobProcesses.erase(processItr);
+    }
+    job.progress.outTimeSeconds = job.progress.durationSeconds;
+    job.progress.isEnd = true;
+    job.stats.finishedSeconds = this->GetElapsedSeconds();
+    //ffmpegはm4aにReplayGain・iTunNORMを書かないので、エンコード後にm4aのタグだけ書き直す
+    //mp3・flacはffmpegが-metadataの値をTXXX・Vorbis Commentに書いているので触らない
+    const auto outputs = job.encoder->GetOutputFilePaths(job.metaData, job.processNumber);
+    if(job.isFailed == false && HasLoudnessTags(job.metaData) && std::any_of(outputs.begin(), outputs.end(), IsMp4Output)){
+        this->StartLoudnessTagUpdate(std::move(job));
+    }
+    else{
+        this->FinishEncodedJob(std::move(job));
+    }
+
+    this->Dispatch();
+}
+
+void EncodeScheduler::StartLoudnessTagUpdate(EncodeJob job)
+{
+    const QStringList arguments = job.encoder->BuildArguments(job.inputPath, job.metaData, job.processNumber);
+    const QStringList outputs = job.encoder->GetOutputFilePaths(job.metaData, job.processNumber);
+    const QString artworkPath = job.metaData.artworkPath;
+    this->numTagUpdating++;
+
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, job]() mutable {
+        //失敗してもffmpegが書いたタグは残るので、エンコード自体は成功とする
+        this->numTagUpdating--;
+        watcher->deleteLater();
+        this->FinishEncodedJob(std::move(job));
+        this->Dispatch();
+    });
+    watcher->setFuture(QtConcurrent::run([arguments, outputs, artworkPath](){
+        return WriteTags(arguments, outputs, artworkPath, true);
+    }));
+}
+
+void EncodeScheduler::FinishEncodedJob(EncodeJob job)
+{
+    //タグを書き終えたファイルを検査する
+    if(this->isVerifyOutputs && job.isFailed == false){
+        this->StartVerify(std::move(job));
+    }
+    else{
+        this->CompleteJob(job);
+    }
+}
+
+void EncodeScheduler::StartVerify(EncodeJob job)
+{
+    //デコードのffmpegを待つ間とflacのMD5の計算でUIを止めないよう、スレッドプールで行う
+    const QString sourcePath = job.inputPath;
+    const QStringList outputPaths = job.encoder->GetOutputFilePaths(job.metaData, job.processNumber);
+    const QString ffmpegPath = job.encoder->GetFFmpegPath();
+    this->numVerifying++;
+    this->verifyingSeconds += job.progress.durationSeconds;
+
+    auto* watcher = new QFutureWatcher<OutputVerifier::Result>(this);
+    connect(watcher, &QFutureWatcher<OutputVerifier::Result>::finished, this, [this, watcher, job]() mutable {
+        this->numVerifying--;
+        this->verifyingSeconds -= job.progress.durationSeconds;
+        const auto result = watcher->result();
+        job.isVerifyFailed = (result.isPassed == false);
+        job.verifyMessages = result.messages;
+        job.stats.verifySeconds = std::max(this->GetElapsedSeconds() - job.stats.finishedSeconds, 0.0);
+        this->CompleteJob(job);
+        watcher->deleteLater();
+        this->Dispatch();
+    });
+    watcher->setFuture(QtConcurrent::run([sourcePath, outputPaths, ffmpegPath](){
+        return OutputVerifier::Verify(sourcePath, outputPaths, ffmpegPath);
+    }));
+}
+
+void EncodeScheduler::CompleteJob(EncodeJob& job)
+{
+    using Result = EncodeJobStats::Result;
+    this->CountFinished(job, job.isFailed ? Result::Failed : (job.isVerifyFailed ? Result::VerifyFailed : Result::Encoded));
+
+    //成功した出力だけを記録し、失敗したものは次回もエンコードする
+    auto cacheItr = this->cacheKeys.find({job.encoder.get(), job.processNumber});
+    if(cacheItr != this->cacheKeys.end())
+    {
+        if(this->cache && job.isFailed == false && job.isVerifyFailed == false){
+            this->cache->Store(cacheItr->second);
+        }
+        this->cacheKeys.erase(cacheItr);
+    }
+    if(job.isVerifyFailed){
+        emit this->jobVerifyFailed(job);
+    }
+    emit this->jobFinished(job);
+}
+
+void EncodeScheduler::OnEncodeProgress(const EncoderInterface* encoder, int processNumber, const EncodeProgress& progress)
+{
+    auto itr = this->runningJobs.find({encoder, processNumber});
+    if(itr == this->runningJobs.end()){ return; }
+
+    //長さはキューに入れた時点で求めたものを使う
+    const double durationSeconds = itr->second.progress.durationSeconds;
+    itr->second.progress = progress;
+    itr->second.progress.durationSeconds = durationSeconds;
+    emit this->jobProgress(itr->second);
+    this->NotifyProgress();
+}
+
+void EncodeScheduler::OnEncodeUsage(const EncoderInterface* encoder, int processNumber, const ResourceUsage::Usage& usage)
+{
+    auto itr = this->runningJobs.find({encoder, processNumber});
+    if(itr == this->runningJobs.end()){ return; }
+    itr->second.stats.usage = usage;
+}
+
+void EncodeScheduler::CountFinished(EncodeJob& job, EncodeJobStats::Result result)
+{
+    this->numFinished++;
+    //エンコードせずに終わったジョブ(起動できなかったものを含む)は速度の計算に含めない
+    if(result == EncodeJobStats::Result::Encoded || result == EncodeJobStats::Result::VerifyFailed || job.isFailed){
+        this->finishedSeconds += job.progress.durationSeconds;
+    }
+    else{
+        this->totalSeconds -= job.progress.durationSeconds;
+    }
+
+    job.stats.result = result;
+    //エンコードしたジョブはOnEncodeFinishで記録済み 検査の時間を処理時間に含めない
+    if(job.stats.finishedSeconds <= 0.0){
+        job.stats.finishedSeconds = this->GetElapsedSeconds();
+    }
+    //まとめてエンコードしたジョブの処理時間はプロセス全体のものなので学習しない
+    if(this->isLearnCost && result == EncodeJobStats::Result::Encoded && job.batchSize == 1){
+        this->costModel.Learn(job.encoder->GetCodecName(), job.progress.durationSeconds, job.stats.GetWallSeconds());
+    }
+    job.stats.outputBytes = 0;
+    for(const auto& path : job.encoder->GetOutputFilePaths(job.metaData, job.processNumber)){
+        job.stats.outputBytes += QFileInfo(path).size();
+    }
+    this->finishedJobs.push_back(job);
+}
+
+EncodeProgress EncodeScheduler::GetOverallProgress() const
+{
+    EncodeProgress progress;
+    progress.durationSeconds = this->totalSeconds;
+    progress.outTimeSeconds = this->finishedSeconds + this->verifyingSeconds;
+    for(const auto& [key, job] : this->runningJobs){
+        progress.outTimeSeconds += std::min(job.progress.outTimeSeconds, job.progress.durationSeconds);
+        progress.totalSize += job.progress.totalSize;
+    }
+    const double elapsedSeconds = this->elapsedTimer.isValid() ? this->elapsedTimer.elapsed() / 1000.0 : 0.0;
+    if(elapsedSeconds > 0.0){
+        progress.speed = progress.outTimeSeconds / elapsedSeconds;
+    }
+    progress.isEnd = (this->isRunning == false && this->queue.empty());
+    return progress;
+}
+
+void EncodeScheduler::SortQueue()
+{
+    std::vector<std::pair<double, EncodeJob>> jobs;
+    jobs.reserve(this->queue.size());
+    for(auto& job : this->queue){
+        const double cost = this->EstimateCost(job);
+        jobs.emplace_back(cost, std::move(job));
+    }
+    std::stable_sort(jobs.begin(), jobs.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+
+    this->queue.clear();
+    for(auto& job : jobs){
+        this->queue.emplace_back(std::move(job.second));
+    }
+    this->isQueueSorted = true;
+}
+
+double EncodeScheduler::EstimateCost(const EncodeJob& job) const
+{
+    //長さが分からない場合はCD品質とみなしてファイルサイズから求める
+    double durationSeconds = job.progress.durationSeconds;
+    if(durationSeconds <= 0.0){
+        durationSeconds = double(job.stats.inputBytes) / (44100.0 * 2 * 2);
+    }
+    return this->costModel.Estimate(job.encoder->GetCodecName(), durationSeconds);
+}
+
+double EncodeScheduler::GetElapsedSeconds() const
+{
+    if(this->isRunning == false || this->elapsedTimer.isValid() == false){ return 0.0; }
+    return this->elapsedTimer.nsecsElapsed() / 1e9;
+}
+
+void EncodeScheduler::NotifyProgress()
+{
+    emit this->progressChanged(this->GetNumQueued(), this->GetNumRunning(), this->numFinished, this->numTotal);
+}
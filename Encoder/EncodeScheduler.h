@@ -0,0 +1,189 @@
+#ifndef ENCODESCHEDULER_H
+#define ENCODESCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "EncoderInterface.h"
+#include "EncodeCache.h"
+#include "EncodeCostModel.h"
+#include "../Tag/TagWriter.h"
+
+//ジョブの計測値 時刻はスケジューラーのStartからの経過秒
+struct EncodeJobStats
+{
+    enum class Result { Pending, Encoded, Skipped, TagUpdated, Failed, VerifyFailed };
+
+    Result result = Result::Pending;
+    double enqueuedSeconds = 0.0;
+    double startedSeconds = 0.0;
+    double finishedSeconds = 0.0;   //エンコードが終わった時刻 出力の検査の時間は含めない
+    double verifySeconds = 0.0;     //出力の検査に掛かった時間
+    ResourceUsage::Usage usage;
+    qint64 inputBytes = 0;
+    qint64 outputBytes = 0;
+
+    double GetQueueWaitSeconds() const { return std::max(startedSeconds - enqueuedSeconds, 0.0); }
+    double GetWallSeconds() const { return std::max(finishedSeconds - startedSeconds, 0.0); }
+    //入力に対して出力が何分の1になったか 出力が無い場合は0
+    double GetCompressionRatio() const { return outputBytes > 0 ? double(inputBytes) / double(outputBytes) : 0.0; }
+};
+
+//エンコード1回分(1曲 x 1コーデック)のジョブ
+struct EncodeJob
+{
+    std::shared_ptr<EncoderInterface> encoder;
+    QString inputPath;
+    AudioMetaData metaData;
+    int processNumber = 0;
+    bool isFailed = false;  //ffmpegが異常終了した
+    bool isVerifyFailed = false;    //出力の検査で問題が見つかった
+    bool isTagUpdateFailed = false; //タグを書き換えられなかったので、通常通りエンコードする
+    QStringList verifyMessages;
+    int batchSize = 1;      //同じプロセスでまとめてエンコードした曲数 計測値はプロセス全体のもの
+    EncodeProgress progress;
+    EncodeJobStats stats;
+};
+
+//同時に起動するエンコーダープロセス数を制限しつつ、空きが出たら順にジョブを投入するキュー
+//ジョブは見積もった処理時間の長い順に投入し、最後に長い曲だけが残ってコアが空くのを避ける
+class EncodeScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    //まとめてエンコードする場合の1プロセス分の長さの目安(秒) 起動の時間がエンコードに比べて無視できる程度にする
+    static constexpr double batchTargetSeconds = 120.0;
+    //これより長い曲は起動の時間が問題にならないのでまとめない
+    static constexpr double batchMaxTrackSeconds = 20.0;
+    //1プロセスで同時に開く入力ファイルの上限
+    static constexpr int maxBatchTracks = 64;
+
+    explicit EncodeScheduler(QObject* parent = nullptr);
+    ~EncodeScheduler() override;
+
+    //同時実行数 0以下を指定した場合はハードウェアスレッド数
+    void SetMaxParallelJobs(int num);
+    int GetMaxParallelJobs() const { return maxParallelJobs; }
+
+    void AddEncoder(const std::shared_ptr<EncoderInterface>& encoder);
+
+    //有効にした場合、同じエンコーダーの短い曲を1回のffmpegでまとめてエンコードする
+    //同時実行数はプロセスの数で数える
+    void SetBatchEncode(bool enable) { isBatchEncode = enable; }
+    bool IsBatchEncode() const { return isBatchEncode; }
+
+    //有効にした場合、エンコードが終わった出力をスレッドプールで検査してから完了にする
+    //検査中のジョブも同時実行数の枠を1つ使う
+    void SetVerifyOutputs(bool enable) { isVerifyOutputs = enable; }
+    bool IsVerifyOutputs() const { return isVerifyOutputs; }
+
+    //無効にした場合、処理時間をコストモデルに学習させず設定ファイルにも保存しない
+    //ベンチマークのように同時実行数を人為的に変えた計測で、普段の見積もりを崩さないようにする
+    void SetLearnCost(bool enable) { isLearnCost = enable; }
+    bool IsLearnCost() const { return isLearnCost; }
+
+    //設定した場合、前回から変更の無い出力はエンコードせずに完了扱いにする
+    void SetCache(std::shared_ptr<EncodeCache> cache);
+
+    void Enqueue(EncodeJob job);
+    void Start();
+    void Cancel();
+
+    bool IsRunning() const { return isRunning; }
+    int GetNumQueued() const { return static_cast<int>(queue.size()); }
+    int GetNumRunning() const { return static_cast<int>(runningJobs.size()) + numVerifying + numTagUpdating; }
+    int GetNumFinished() const { return numFinished; }
+    int GetNumTotal() const { return numTotal; }
+
+    //実行全体の進捗 長さはエンコードする音声の合計(スキップしたジョブは含まない)
+    //speedは開始からの経過時間に対する処理済みの長さの倍率
+    EncodeProgress GetOverallProgress() const;
+    //Startからの経過秒
+    double GetElapsedSeconds() const;
+
+    //今回の実行で終わったジョブ(スキップ・失敗を含む) 終わった順
+    const std::vector<EncodeJob>& GetFinishedJobs() const { return finishedJobs; }
+
+signals:
+    void jobStarted(const EncodeJob& job);
+    void jobFailed(const EncodeJob& job);
+    void jobSkipped(const EncodeJob& job);
+    void jobTagUpdated(const EncodeJob& job);   //エンコードせずにタグだけを書き換えた
+    //出力の検査で問題が見つかった場合、jobFinishedの前に発行する
+    void jobVerifyFailed(const EncodeJob& job);
+    void jobFinished(const EncodeJob& job);
+    void jobProgress(const EncodeJob& job);
+    void progressChanged(int queued, int running, int finished, int total);
+    void allFinished();
+
+private:
+    using JobKey = std::pair<const EncoderInterface*, int>;
+
+    enum class CacheState { Encode, Finished, TagOnly };
+
+    void Dispatch();
+    //変更の無いジョブはここで完了扱いにしてFinishedを返す タグだけが変わったジョブはTagOnly
+    CacheState CheckCache(EncodeJob& job);
+    //タグの書き換えをスレッドプールで行う 書き換えも同時実行数の枠を1つ使う
+    void StartTagUpdate(EncodeJob job);
+    //先頭のジョブと一緒にエンコードする短いジョブを待ち行列から取り出す
+    std::vector<EncodeJob> TakeBatch(EncodeJob first);
+    bool IsBatchable(const EncodeJob& job) const;
+    //ffmpegに渡す引数と同じ内容のタグを出力に書き込む スレッドプールから呼ぶ
+    //isMp4Onlyの場合はm4aの出力だけを書き換える
+    static bool WriteTags(const QStringList& arguments, const QStringList& outputs, const QString& artworkPath, bool isMp4Only = false);
+    static bool IsMp4Output(const QString& path);
+    static bool HasLoudnessTags(const AudioMetaData& metaData);
+    void OnEncodeError(const EncoderInterface* encoder, int processNumber);
+    void OnEncodeFinish(const EncoderInterface* encoder, int processNumber);
+    void OnEncodeProgress(const EncoderInterface* encoder, int processNumber, const EncodeProgress& progress);
+    void OnEncodeUsage(const EncoderInterface* encoder, int processNumber, const ResourceUsage::Usage& usage);
+    //エンコード後にm4aへReplayGain・iTunNORMをスレッドプールで書き込む
+    void StartLoudnessTagUpdate(EncodeJob job);
+    //エンコードが終わったジョブを検査に回すか完了にする
+    void FinishEncodedJob(EncodeJob job);
+    void StartVerify(EncodeJob job);
+    //エンコード(と検査)が終わったジョブを集計し、成功した出力をキャッシュに記録する
+    void CompleteJob(EncodeJob& job);
+    //終了・スキップしたジョブを集計と履歴に反映する
+    void CountFinished(EncodeJob& job, EncodeJobStats::Result result);
+    void NotifyProgress();
+    //見積もった処理時間の長い順に並べる 同じ見積もりならテーブルの順
+    void SortQueue();
+    double EstimateCost(const EncodeJob& job) const;
+
+    int maxParallelJobs;
+    int numFinished;
+    int numTotal;
+    bool isRunning;
+    bool isQueueSorted;
+    bool isBatchEncode;
+    bool isVerifyOutputs;
+    bool isLearnCost;
+    bool isPreparing;           //キャッシュのハッシュを計算中 終わるまでジョブを投入しない
+    int numVerifying;
+    int numTagUpdating;
+    bool isCanceled;
+    int nextProcessId;
+    double totalSeconds;        //未スキップのジョブの長さの合計
+    double finishedSeconds;     //終了したジョブの長さの合計
+    double verifyingSeconds;    //検査中のジョブの長さの合計
+    QElapsedTimer elapsedTimer;
+    std::deque<EncodeJob> queue;
+    std::map<JobKey, EncodeJob> runningJobs;
+    std::map<JobKey, int> jobProcesses;     //ジョブ→実行中のプロセス
+    std::map<int, int> runningProcesses;    //プロセス→終わっていないジョブの数
+    std::shared_ptr<EncodeCache> cache;
+    std::map<JobKey, EncodeCache::Key> cacheKeys;
+    QFuture<QString> prepareFuture;
+    std::vector<EncodeJob> finishedJobs;
+    EncodeCostModel costModel;
+};
+
+#endif // ENCODESCHEDULER_H
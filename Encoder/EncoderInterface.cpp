@@ -0,0 +1,204 @@
+#include "EncoderInterface.h"
+
+#include "WaveFile.h"
+
+#include <QDebug>
+#include <QHash>
+#include <memory>
+#include <numeric>
+
+namespace
+{
+    //-progressの"00:01:23.456789"形式
+    double ParseTime(const QByteArray& value)
+    {
+        const auto parts = value.split(':');
+        if(parts.size() != 3){ return 0.0; }
+        return parts[0].toDouble() * 3600.0 + parts[1].toDouble() * 60.0 + parts[2].toDouble();
+    }
+
+    //key=valueの1行を反映する 1回分の報告の終わり(progress=)でtrueを返す
+    bool ParseProgressLine(const QByteArray& line, EncodeProgress& progress)
+    {
+        const int pos = line.indexOf('=');
+        if(pos <= 0){ return false; }
+        const QByteArray key = line.left(pos).trimmed();
+        const QByteArray value = line.mid(pos + 1).trimmed();
+
+        if(key == "out_time_us" || key == "out_time_ms"){
+            //out_time_msも実際にはマイクロ秒
+            bool isOk = false;
+            const qint64 us = value.toLongLong(&isOk);
+            if(isOk){ progress.outTimeSeconds = double(us) / 1e6; }
+        }
+        else if(key == "out_time"){
+            if(value != "N/A"){ progress.outTimeSeconds = ParseTime(value); }
+        }
+        else if(key == "speed"){
+            QByteArray speed = value;
+            speed.replace("x", "");
+            progress.speed = speed.toDouble();
+        }
+        else if(key == "total_size"){
+            progress.totalSize = value.toLongLong();
+        }
+        else if(key == "progress"){
+            progress.isEnd = (value == "end");
+            return true;
+        }
+        return false;
+    }
+}
+
+bool EncoderInterface::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+{
+    return StartProcess(BuildArguments(inputPath, metaData, processNumber), inputPath, metaData, processNumber);
+}
+
+QStringList EncoderInterface::BuildArguments(const QString& inputPath, const AudioMetaData& metaData, int processNumber) const
+{
+    QStringList option;
+    option << "-y" << "-i" << inputPath;
+
+    int artworkInput = -1;
+    const auto artworkPath = GetArtworkPath(metaData);
+    if(artworkPath.isEmpty() == false){
+        option << "-i" << artworkPath;
+        artworkInput = 1;
+    }
+
+    AppendOutputArguments(option, metaData, 0, artworkInput, processNumber);
+    return option;
+}
+
+bool EncoderInterface::EncodeBatch(const std::vector<EncodeBatchItem>& items)
+{
+    if(items.empty()){ return false; }
+    return StartProcess(BuildBatchArguments(items), items);
+}
+
+QStringList EncoderInterface::BuildBatchArguments(const std::vector<EncodeBatchItem>& items) const
+{
+    //音源を先に並べ、曲iの音源は入力i アートワークはその後ろに種類ごとに1つだけ置く
+    QStringList option;
+    option << "-y";
+    for(const auto& item : items){
+        option << "-i" << item.inputPath;
+    }
+    QHash<QString, int> artworkInputs;
+    for(const auto& item : items)
+    {
+        const auto artworkPath = GetArtworkPath(item.metaData);
+        if(artworkPath.isEmpty() || artworkInputs.contains(artworkPath)){ continue; }
+        artworkInputs.insert(artworkPath, int(items.size()) + artworkInputs.size());
+        option << "-i" << artworkPath;
+    }
+
+    for(int i=0; i<int(items.size()); ++i){
+        const auto& item = items[i];
+        AppendOutputArguments(option, item.metaData, i, artworkInputs.value(GetArtworkPath(item.metaData), -1), item.processNumber);
+    }
+    return option;
+}
+
+void EncoderInterface::AppendOutputArguments(QStringList& options, const AudioMetaData& metaData, int audioInput, int artworkInput, int processNumber) const
+{
+    options << GetOutputOptions(metaData, audioInput, artworkInput);
+
+    // 出力ファイルオプションの追加
+    options << GetOutputFilePath(metaData, processNumber);
+}
+
+double EncoderInterface::GetInputDuration(const QString& inputPath, const AudioMetaData& metaData)
+{
+    if(metaData.durationSeconds > 0.0){
+        return metaData.durationSeconds;
+    }
+    return WaveFile::GetDurationSeconds(inputPath);
+}
+
+bool EncoderInterface::StartProcess(const QStringList& arguments, const QString& inputPath, const AudioMetaData& metaData, int processNumber)
+{
+    return StartProcess(arguments, std::vector<EncodeBatchItem>{{inputPath, metaData, processNumber}});
+}
+
+bool EncoderInterface::StartProcess(const QStringList& arguments, const std::vector<EncodeBatchItem>& items)
+{
+    if(items.empty()){ return false; }
+    QProcess* process = new QProcess(this);
+    process->setProgram(GetFFmpegPath());
+    //ログはプロセス単位でしか分けられないので、まとめた場合は先頭の曲に出す
+    const int logProcessNumber = items.front().processNumber;
+
+    //入力は並行してデコードされるので、out_timeは全ての曲で共通の経過位置として扱う
+    std::vector<double> durations;
+    for(const auto& item : items){
+        durations.push_back(GetInputDuration(item.inputPath, item.metaData));
+    }
+    const double totalDuration = std::accumulate(durations.begin(), durations.end(), 0.0);
+
+    //標準出力には-progressのkey=valueだけが出力される
+    auto progress = std::make_shared<EncodeProgress>();
+    auto progressBuffer = std::make_shared<QByteArray>();
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, process, items, durations, totalDuration, progress, progressBuffer](){
+        progressBuffer->append(process->readAllStandardOutput());
+        qsizetype pos = 0;
+        while((pos = progressBuffer->indexOf('\n')) >= 0)
+        {
+            const QByteArray line = progressBuffer->left(pos);
+            progressBuffer->remove(0, pos + 1);
+            if(ParseProgressLine(line, *progress) == false){ continue; }
+
+            //回収された後は読めないので、progress=endを含む報告のたびに読んでおく
+            ResourceUsage::Usage usage;
+            const bool hasUsage = ResourceUsage::ReadProcess(process->processId(), usage);
+            for(size_t i=0; i<items.size(); ++i)
+            {
+                EncodeProgress itemProgress = *progress;
+                itemProgress.durationSeconds = durations[i];
+                emit this->encodeProgress(items[i].processNumber, itemProgress);
+                if(hasUsage == false){ continue; }
+                //CPU時間は曲の長さで按分する 最大メモリはプロセス全体の値
+                const double share = totalDuration > 0.0 ? durations[i] / totalDuration : 1.0 / items.size();
+                ResourceUsage::Usage itemUsage = usage;
+                itemUsage.userSeconds *= share;
+                itemUsage.systemSeconds *= share;
+                emit this->encodeUsage(items[i].processNumber, itemUsage);
+            }
+        }
+    });
+    connect(process, &QProcess::readyReadStandardError, this, [this, process, logProcessNumber](){
+        QByteArray arr = process->readAllStandardError();
+        emit this->readJobOutput(logProcessNumber, QString(arr));
+    });
+    //readChannelFinishedはチャンネル毎に発行されるため、プロセスの終了で完了とする
+    connect(process, &QProcess::finished, this, [this, process, items](int exitCode, QProcess::ExitStatus exitStatus){
+        //まとめた場合、どの曲で失敗したかは分からないので全て失敗とする
+        const bool isFailed = (exitStatus != QProcess::NormalExit || exitCode != 0);
+        for(const auto& item : items)
+        {
+            if(isFailed){
+                emit this->encodeError(item.inputPath, item.metaData, item.processNumber, QString("ffmpeg exited with code %1").arg(exitCode));
+            }
+            emit this->encodeFinish(item.inputPath, item.metaData, item.processNumber);
+        }
+        process->deleteLater();
+    });
+
+    //統計表示はログを埋めるだけなので止め、機械向けの進捗を標準出力に出させる
+    process->setArguments(QStringList{"-nostats", "-progress", "pipe:1"} + arguments);
+
+#ifdef QT_DEBUG
+    qDebug() << arguments;
+    emit this->readJobOutput(logProcessNumber, process->program() + " " + process->arguments().join(" ") + "\n");
+#endif
+
+    process->start();
+    if (!process->waitForStarted(-1)) {
+        qWarning() << process->errorString();
+        process->deleteLater();
+        return false;
+    }
+
+    return true;
+}
@@ -5,14 +5,51 @@
 #include <QString>
 #include <QStringList>
 #include <QFile>
+#include <QFileInfo>
 #include <QApplication>
 #include <QSettings>
 #include <QDir>
 #include <QProcess>
 #include <QObject>
+#include <QStandardPaths>
 
 #include "ProjectDefines.hpp"
 #include "AudioMetaData.hpp"
+#include "ArtworkPreprocessor.h"
+#include "ResourceUsage.h"
+#include "LoudnessAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//1ジョブ分の進捗 ffmpegの-progressの出力から作る
+struct EncodeProgress
+{
+    double durationSeconds = 0.0;   //入力の長さ 不明な場合は0
+    double outTimeSeconds = 0.0;    //エンコード済みの長さ
+    double speed = 0.0;             //実時間に対する倍率
+    qint64 totalSize = 0;           //書き出したバイト数
+    bool isEnd = false;
+
+    double GetRatio() const{
+        if(isEnd){ return 1.0; }
+        return durationSeconds > 0.0 ? std::clamp(outTimeSeconds / durationSeconds, 0.0, 1.0) : 0.0;
+    }
+    //残り時間(秒) 分からない場合は負の値
+    double GetEtaSeconds() const{
+        if(durationSeconds <= 0.0 || speed <= 0.0){ return -1.0; }
+        return std::max(durationSeconds - outTimeSeconds, 0.0) / speed;
+    }
+};
+
+//1回のffmpegでまとめてエンコードする曲の1つ分
+struct EncodeBatchItem
+{
+    QString inputPath;
+    AudioMetaData metaData;
+    int processNumber = 0;
+};
 
 class EncoderInterface : public QObject
 {
@@ -24,8 +61,63 @@ public:
 
     virtual QString GetEncoderFileName() const = 0;
     virtual QString GetCodecExtention() const = 0;
+    //ログの接頭辞に使うコーデック名
+    virtual QString GetCodecName() const = 0;
+    //-c:aに渡すffmpegのエンコーダー名 ffmpegが対応しているかの確認に使う 空の場合は確認しない
+    virtual QString GetAudioEncoderName() const { return QString(); }
+
+    //1出力ファイル分のオプション(出力パスは含まない)
+    //audioInput, artworkInputはffmpegの入力番号。アートワークが無い場合artworkInputは-1
+    virtual QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const = 0;
+
+    virtual bool Encode(QString inputPath, AudioMetaData metaData, int processNumber);
+
+    //複数の曲を1回のffmpegでエンコードする 入力・出力は曲の数だけ並べ、完了は曲ごとにencodeFinishで通知する
+    //数秒の曲が大量にある場合、プロセスの起動をまとめて減らせる
+    virtual bool EncodeBatch(const std::vector<EncodeBatchItem>& items);
+    //EncodeBatchでまとめられるか ffmpegを起動しないエンコーダーではfalse
+    virtual bool IsBatchSupported() const { return true; }
+
+    QString GetOutputFilePath(const AudioMetaData& metaData, int processNumber) const{
+        return GetOutputPath(metaData.title, "." + GetCodecExtention(), processNumber).replace("\\", "/");
+    }
+
+    //このエンコーダーが1曲分で書き出すファイル
+    virtual QStringList GetOutputFilePaths(const AudioMetaData& metaData, int processNumber) const{
+        return {GetOutputFilePath(metaData, processNumber)};
+    }
+
+    //入力1つ・出力1つのffmpeg引数を作成する
+    virtual QStringList BuildArguments(const QString& inputPath, const AudioMetaData& metaData, int processNumber) const;
+    //入力N個・出力N個のffmpeg引数を作成する 同じアートワークは1回だけ入力する
+    QStringList BuildBatchArguments(const std::vector<EncodeBatchItem>& items) const;
+
+    //入力の長さ 設定されていなければwavのヘッダーから求める
+    static double GetInputDuration(const QString& inputPath, const AudioMetaData& metaData);
+
+    //ffmpegの実行ファイルを探す 指定パス→実行ファイルと同じ場所→PATHの順
+    static QString FindFFmpeg(const QString& configuredPath = QString())
+    {
+        if(configuredPath.isEmpty() == false && QFileInfo(configuredPath).isExecutable()){
+            return configuredPath;
+        }
+#ifdef Q_OS_WIN
+        const QString localPath = QCoreApplication::applicationDirPath()+"/ffmpeg.exe";
+#else
+        const QString localPath = QCoreApplication::applicationDirPath()+"/ffmpeg";
+#endif
+        if(QFile::exists(localPath)){
+            return localPath;
+        }
+        return QStandardPaths::findExecutable("ffmpeg");
+    }
 
-    virtual bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) = 0;
+    void SetFFmpegPath(QString path){
+        ffmpegPath = std::move(path);
+    }
+    QString GetFFmpegPath() const{
+        return ffmpegPath.isEmpty() ? FindFFmpeg() : ffmpegPath;
+    }
 
     void SetOutputFolderPath(QString path){
         outputBaseFolderPath = std::move(path);
@@ -66,9 +158,38 @@ public:
 signals:
     void readStdOut(QString);
     void readStdError(QString);
-    void encodeFinish(const QString inputPath, const AudioMetaData& AudioMetaData);
+    //ジョブ(曲番号)ごとのエンコーダー出力 行の途中で区切られていることがある
+    void readJobOutput(int processNumber, QString text);
+    void encodeProgress(int processNumber, const EncodeProgress& progress);
+    //エンコーダーが使ったCPU時間・メモリの累計 実行中に何度か発行し、最後の値が最終的な使用量
+    void encodeUsage(int processNumber, const ResourceUsage::Usage& usage);
+    //ffmpegが異常終了した場合、encodeFinishの前に発行する
+    void encodeError(const QString inputPath, const AudioMetaData& AudioMetaData, int processNumber, QString message);
+    void encodeFinish(const QString inputPath, const AudioMetaData& AudioMetaData, int processNumber);
 
 protected:
+    static QString GetArtworkPath(const AudioMetaData& metaData){
+        auto artworkPath = metaData.artworkPath;
+        artworkPath.replace("\\", "/");
+        return QFile::exists(artworkPath) ? artworkPath : QString();
+    }
+
+    //アートワークのビデオコーデック JPEGは事前処理済みなのでそのまま埋め込む
+    static QString GetArtworkCodec(const AudioMetaData& metaData){
+        return ArtworkPreprocessor::IsJpeg(metaData.artworkPath) ? "copy" : "mjpeg";
+    }
+
+    //ffmpegを起動し、終了時にencodeFinishを発行する
+    //-progressの出力を解析してencodeProgressを発行する
+    //進捗の報告ごとにプロセスの使用量を読み、encodeUsageを発行する
+    bool StartProcess(const QStringList& arguments, const QString& inputPath, const AudioMetaData& metaData, int processNumber);
+    //まとめてエンコードする場合 進捗・使用量は曲ごとに分けて発行する
+    bool StartProcess(const QStringList& arguments, const std::vector<EncodeBatchItem>& items);
+
+    //1曲分の出力(オプションと出力パス)を追加する
+    //audioInput, artworkInputはffmpegの入力番号 アートワークが無い場合artworkInputは-1
+    virtual void AppendOutputArguments(QStringList& options, const AudioMetaData& metaData, int audioInput, int artworkInput, int processNumber) const;
+
     QString GetOutputPath(QString title, QString extension, int i) const
     {
         auto outputFolder = outputBaseFolderPath+"/"+ GetCodecFolderName();
@@ -98,7 +219,8 @@ protected:
         return str;
     }
 
-    void AppendCommonMetaDataOption(QStringList& options, const AudioMetaData& metaData)
+    //appliedGainDbは出力に掛けたゲイン その分だけReplayGainのゲインとピークを直して書く
+    void AppendCommonMetaDataOption(QStringList& options, const AudioMetaData& metaData, double appliedGainDb = 0.0) const
     {
         // メタデータオプションの追加
         if(!metaData.title.isEmpty()){ options << "-metadata" << "title=" + EncloseDQ(metaData.title); }
@@ -110,6 +232,42 @@ protected:
         if(!metaData.year.isEmpty()){ options << "-metadata" << "date=" + EncloseDQ(metaData.year); }
         options << "-metadata" << "track=" + EncloseDQ(metaData.track_no + "/" + QString::number(numEncodingMusic));
         options << "-metadata" << "disc=1/1";
+        //ReplayGain・iTunNORMはffmpegが書けない形式(m4a)もあるので、エンコード後にTagWriterで書き直す
+        const AudioMetaData loudness = (appliedGainDb != 0.0) ? AdjustLoudnessTags(metaData, appliedGainDb) : metaData;
+        if(!loudness.replayGainTrackGain.isEmpty()){ options << "-metadata" << "REPLAYGAIN_TRACK_GAIN=" + loudness.replayGainTrackGain; }
+        if(!loudness.replayGainTrackPeak.isEmpty()){ options << "-metadata" << "REPLAYGAIN_TRACK_PEAK=" + loudness.replayGainTrackPeak; }
+        if(!loudness.replayGainAlbumGain.isEmpty()){ options << "-metadata" << "REPLAYGAIN_ALBUM_GAIN=" + loudness.replayGainAlbumGain; }
+        if(!loudness.replayGainAlbumPeak.isEmpty()){ options << "-metadata" << "REPLAYGAIN_ALBUM_PEAK=" + loudness.replayGainAlbumPeak; }
+        if(!loudness.iTunNORM.isEmpty()){ options << "-metadata" << "iTunNORM=" + loudness.iTunNORM; }
+    }
+
+    //クリップを避けるゲインを、非可逆圧縮の出力にだけ掛ける
+    void AppendLossyGainOption(QStringList& options, const AudioMetaData& metaData) const
+    {
+        if(metaData.lossyGainDb < 0.0){
+            options << "-af" << QString("volume=%1dB").arg(metaData.lossyGainDb, 0, 'f', 2);
+        }
+    }
+
+    //gainDbだけ音量を変えた出力に合わせて、ReplayGainのゲイン・ピークとiTunNORMを作り直す
+    static AudioMetaData AdjustLoudnessTags(AudioMetaData metaData, double gainDb)
+    {
+        const double peakScale = std::pow(10.0, gainDb / 20.0);
+        auto Gain = [gainDb](QString& value){
+            if(value.isEmpty() == false){ value = LoudnessAnalyzer::FormatGain(value.section(' ', 0, 0).toDouble() - gainDb); }
+        };
+        auto Peak = [peakScale](QString& value){
+            if(value.isEmpty() == false){ value = LoudnessAnalyzer::FormatPeak(value.toDouble() * peakScale); }
+        };
+        Gain(metaData.replayGainTrackGain);
+        Gain(metaData.replayGainAlbumGain);
+        Peak(metaData.replayGainTrackPeak);
+        Peak(metaData.replayGainAlbumPeak);
+        if(metaData.iTunNORM.isEmpty() == false && metaData.replayGainTrackGain.isEmpty() == false){
+            metaData.iTunNORM = LoudnessAnalyzer::MakeITunNorm(metaData.replayGainTrackGain.section(' ', 0, 0).toDouble(),
+                                                               metaData.replayGainTrackPeak.toDouble());
+        }
+        return metaData;
     }
 
     bool isEnableEncoder;
@@ -119,6 +277,7 @@ protected:
     int numEncodingMusic;   //コーデックを抜きにした曲数
     QString trackNumberDelimiter = "_";
 
+    QString ffmpegPath;             //空の場合はFindFFmpegで探す
     QString outputBaseFolderPath;   //出力先のルートフォルダパス
     QString codecFolderName;        //ルートの下に作る、コーデックごとのフォルダ名
 
@@ -0,0 +1,99 @@
+#include "EncoderProbe.h"
+#include "EncoderInterface.h"
+#include "ProjectDefines.hpp"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSettings>
+
+#include <memory>
+
+namespace
+{
+    bool RunFFmpeg(const QString& ffmpegPath, const QStringList& arguments, QByteArray& output)
+    {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::MergedChannels);
+        process.start(ffmpegPath, arguments);
+        if(process.waitForFinished(EncoderProbe::timeoutMs) == false){
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        output = process.readAll();
+        return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    }
+}
+
+namespace EncoderProbe
+{
+
+Capabilities Probe(const QString& configuredPath)
+{
+    Capabilities capabilities;
+    capabilities.ffmpegPath = EncoderInterface::FindFFmpeg(configuredPath);
+    if(capabilities.IsFound() == false){ return capabilities; }
+
+    const QFileInfo info(capabilities.ffmpegPath);
+    const QString path = info.absoluteFilePath();
+    const qint64 size = info.size();
+    const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+
+    std::unique_ptr<QSettings> settingfile;
+    if(ProjectDefines::settingFilePath.isEmpty() == false)
+    {
+        settingfile = std::make_unique<QSettings>(ProjectDefines::settingFilePath, QSettings::IniFormat);
+        settingfile->beginGroup(ProjectDefines::settingEncoderProbe);
+        //同じ実行ファイルのままなら前回の結果を使う
+        if(settingfile->value("path").toString() == path && settingfile->value("size").toLongLong() == size
+           && settingfile->value("lastModified").toLongLong() == lastModified)
+        {
+            capabilities.version = settingfile->value("version").toString();
+            capabilities.encoders = settingfile->value("encoders").toStringList();
+            capabilities.isCached = true;
+            return capabilities;
+        }
+    }
+
+    QByteArray output;
+    if(RunFFmpeg(capabilities.ffmpegPath, {"-hide_banner", "-version"}, output) == false){
+        //起動できない実行ファイルは見つからなかったものとする
+        return Capabilities();
+    }
+    capabilities.version = QString::fromUtf8(output).section('\n', 0, 0).trimmed();
+    if(RunFFmpeg(capabilities.ffmpegPath, {"-hide_banner", "-encoders"}, output)){
+        capabilities.encoders = ParseEncoders(output);
+    }
+
+    if(settingfile)
+    {
+        settingfile->setValue("path", path);
+        settingfile->setValue("size", size);
+        settingfile->setValue("lastModified", lastModified);
+        settingfile->setValue("version", capabilities.version);
+        settingfile->setValue("encoders", capabilities.encoders);
+    }
+    return capabilities;
+}
+
+QStringList ParseEncoders(const QByteArray& output)
+{
+    //" A....D libmp3lame           libmp3lame MP3 (MPEG audio layer 3)" の形式 "------"の行より後ろが一覧
+    QStringList encoders;
+    bool isList = false;
+    for(const auto& line : output.split('\n'))
+    {
+        const QByteArray trimmed = line.trimmed();
+        if(isList == false){
+            isList = trimmed.startsWith("------");
+            continue;
+        }
+        const auto fields = trimmed.simplified().split(' ');
+        if(fields.size() < 2 || fields[0].startsWith('A') == false){ continue; }
+        encoders.append(QString::fromLatin1(fields[1]));
+    }
+    return encoders;
+}
+
+}
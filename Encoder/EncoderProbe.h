@@ -0,0 +1,31 @@
+#ifndef ENCODERPROBE_H
+#define ENCODERPROBE_H
+
+#include <QString>
+#include <QStringList>
+
+//ffmpegの実行ファイルを探し、-versionと-encodersで使えるエンコーダーを調べる
+//結果は実行ファイルのパス・サイズ・更新日時と一緒に設定ファイルへ保存し、変わっていなければffmpegを起動しない
+namespace EncoderProbe
+{
+    struct Capabilities
+    {
+        QString ffmpegPath;     //見つからなければ空
+        QString version;        //-versionの1行目
+        QStringList encoders;   //音声エンコーダーの名前(aac, libfdk_aac, libmp3lame, flacなど)
+        bool isCached = false;  //ffmpegを起動せず設定ファイルから読んだ
+
+        bool IsFound() const { return ffmpegPath.isEmpty() == false; }
+        bool HasEncoder(const QString& name) const { return encoders.contains(name); }
+    };
+
+    static constexpr int timeoutMs = 10000;
+
+    //設定したパス→実行ファイルと同じ場所→PATHの順に探して調べる ワーカースレッドから呼んでよい
+    Capabilities Probe(const QString& configuredPath);
+
+    //-encodersの出力から音声エンコーダーの名前を取り出す
+    QStringList ParseEncoders(const QByteArray& output);
+}
+
+#endif // ENCODERPROBE_H
@@ -0,0 +1,243 @@
+#include "FastFileCopy.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(Q_OS_LINUX)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+#if defined(Q_OS_MACOS)
+#include <sys/clonefile.h>
+#endif
+
+namespace
+{
+    constexpr qint64 bufferSize = 1024 * 1024;
+
+    bool HardLink(const QString& source, const QString& destination)
+    {
+#if defined(Q_OS_WIN)
+        return CreateHardLinkW(reinterpret_cast<LPCWSTR>(destination.utf16()), reinterpret_cast<LPCWSTR>(source.utf16()), nullptr) != FALSE;
+#else
+        return ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+#endif
+    }
+
+    //データを共有するだけで済む方法(reflink)を試す
+    bool Reflink(const QString& source, const QString& destination)
+    {
+#if defined(Q_OS_LINUX)
+        const int sourceFd = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+        if(sourceFd < 0){ return false; }
+        struct stat sourceStat;
+        bool isSucceeded = false;
+        if(::fstat(sourceFd, &sourceStat) == 0)
+        {
+            const int destinationFd = ::open(QFile::encodeName(destination).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, sourceStat.st_mode & 0777);
+            if(destinationFd >= 0)
+            {
+                //同じファイルシステムでCoWに対応していれば、データブロックを共有するだけで終わる
+                isSucceeded = (::ioctl(destinationFd, FICLONE, sourceFd) == 0);
+                ::close(destinationFd);
+                if(isSucceeded == false){
+                    ::unlink(QFile::encodeName(destination).constData());
+                }
+            }
+        }
+        ::close(sourceFd);
+        return isSucceeded;
+#elif defined(Q_OS_MACOS)
+        //APFSではclonefileがreflinkに相当する
+        return ::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData(), 0) == 0;
+#else
+        Q_UNUSED(source);
+        Q_UNUSED(destination);
+        return false;
+#endif
+    }
+
+#if !defined(Q_OS_WIN)
+    //全て書き込むまで繰り返す 書き込み途中のエラーはfalse
+    bool WriteAll(int fd, const char* data, qint64 size)
+    {
+        while(size > 0)
+        {
+            const ssize_t written = ::write(fd, data, size_t(size));
+            if(written < 0){
+                if(errno == EINTR){ continue; }
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    //開いたファイル同士でカーネル内コピーを試す
+    //1バイトも書けないうちに非対応で失敗した場合はFailedのまま返し(isError=false)、次の方法に任せる
+    FastFileCopy::Method KernelCopy(int sourceFd, int destinationFd, qint64 size, bool& isError)
+    {
+        isError = false;
+#if defined(Q_OS_LINUX)
+        qint64 copied = 0;
+        while(copied < size)
+        {
+            const ssize_t result = ::copy_file_range(sourceFd, nullptr, destinationFd, nullptr, size_t(size - copied), 0);
+            if(result < 0 && errno == EINTR){ continue; }
+            if(result <= 0){ break; }
+            copied += result;
+        }
+        if(copied == size){ return FastFileCopy::Method::CopyFileRange; }
+        if(copied > 0){
+            isError = true;
+            return FastFileCopy::Method::Failed;
+        }
+
+        off_t offset = 0;
+        while(offset < size)
+        {
+            const ssize_t result = ::sendfile(destinationFd, sourceFd, &offset, size_t(size - offset));
+            if(result < 0 && errno == EINTR){ continue; }
+            if(result <= 0){ break; }
+        }
+        if(offset == size){ return FastFileCopy::Method::SendFile; }
+        if(offset > 0){ isError = true; }
+#else
+        Q_UNUSED(sourceFd);
+        Q_UNUSED(destinationFd);
+        Q_UNUSED(size);
+#endif
+        return FastFileCopy::Method::Failed;
+    }
+
+    FastFileCopy::Method CopyContents(const QString& source, const QString& destination, qint64 size)
+    {
+        const int sourceFd = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+        if(sourceFd < 0){ return FastFileCopy::Method::Failed; }
+        struct stat sourceStat;
+        if(::fstat(sourceFd, &sourceStat) != 0){
+            ::close(sourceFd);
+            return FastFileCopy::Method::Failed;
+        }
+        const int destinationFd = ::open(QFile::encodeName(destination).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, sourceStat.st_mode & 0777);
+        if(destinationFd < 0){
+            ::close(sourceFd);
+            return FastFileCopy::Method::Failed;
+        }
+
+        bool isError = false;
+        auto method = KernelCopy(sourceFd, destinationFd, size, isError);
+        if(method == FastFileCopy::Method::Failed && isError == false)
+        {
+            //カーネル内コピーに対応していないファイルシステムでは通常のコピーを行う
+            method = FastFileCopy::Method::Buffered;
+            QByteArray buffer(bufferSize, Qt::Uninitialized);
+            ::lseek(sourceFd, 0, SEEK_SET);
+            ::lseek(destinationFd, 0, SEEK_SET);
+            while(true)
+            {
+                const ssize_t numRead = ::read(sourceFd, buffer.data(), size_t(buffer.size()));
+                if(numRead < 0 && errno == EINTR){ continue; }
+                if(numRead == 0){ break; }
+                if(numRead < 0 || WriteAll(destinationFd, buffer.constData(), numRead) == false){
+                    method = FastFileCopy::Method::Failed;
+                    break;
+                }
+            }
+        }
+
+        ::close(sourceFd);
+        if(::close(destinationFd) != 0){
+            method = FastFileCopy::Method::Failed;
+        }
+        return method;
+    }
+#else
+    FastFileCopy::Method CopyContents(const QString& source, const QString& destination, qint64)
+    {
+        //CopyFileExはカーネル内でコピーする
+        return QFile::copy(source, destination) ? FastFileCopy::Method::Buffered : FastFileCopy::Method::Failed;
+    }
+#endif
+}
+
+namespace FastFileCopy
+{
+
+double Result::GetBytesPerSecond() const
+{
+    if(elapsedNs <= 0){ return 0.0; }
+    return double(bytes) * 1e9 / double(elapsedNs);
+}
+
+Result Copy(const QString& source, const QString& destination, bool allowHardLink)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    result.source = source;
+    result.destination = destination;
+
+    const QFileInfo sourceInfo(source);
+    if(sourceInfo.isFile() == false){ return result; }
+
+    //途中で失敗しても中途半端なファイルが残らないよう、一時ファイルに作ってから置き換える
+    const QString temporaryPath = destination + ".part";
+    QFile::remove(temporaryPath);
+
+    //reflinkはハードリンクと同じく一瞬で終わり、出力を編集しても元ファイルに影響しないので優先する
+    Method method = Method::Failed;
+    if(Reflink(source, temporaryPath)){
+        method = Method::Reflink;
+    }
+    else if(allowHardLink && HardLink(source, temporaryPath)){
+        method = Method::HardLink;
+    }
+    else{
+        method = CopyContents(source, temporaryPath, sourceInfo.size());
+    }
+
+    if(method != Method::Failed)
+    {
+        QFile::remove(destination);
+        if(QFile::rename(temporaryPath, destination) == false){
+            method = Method::Failed;
+        }
+    }
+    if(method == Method::Failed){
+        QFile::remove(temporaryPath);
+    }
+
+    result.method = method;
+    result.bytes = (method == Method::Failed) ? 0 : sourceInfo.size();
+    result.elapsedNs = timer.nsecsElapsed();
+    return result;
+}
+
+QString GetMethodName(Method method)
+{
+    switch(method)
+    {
+    case Method::Reflink:       return "reflink";
+    case Method::HardLink:      return "hardlink";
+    case Method::CopyFileRange: return "copy_file_range";
+    case Method::SendFile:      return "sendfile";
+    case Method::Buffered:      return "copy";
+    case Method::Failed:        break;
+    }
+    return "failed";
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef FASTFILECOPY_H
+#define FASTFILECOPY_H
+
+#include <QString>
+
+//wav出力用のファイルコピー
+//ユーザー空間を経由しない方法から順に試し、最後に通常のコピーを行う
+//  reflink(FICLONE) → ハードリンク(許可した場合) → copy_file_range → sendfile → 通常のコピー
+//書き込みは一時ファイルに行い、完了後に置き換えるので既存ファイルは上書きされる
+namespace FastFileCopy
+{
+    enum class Method
+    {
+        Failed,
+        Reflink,
+        HardLink,
+        CopyFileRange,
+        SendFile,
+        Buffered,
+    };
+
+    struct Result
+    {
+        QString source;
+        QString destination;
+        Method method = Method::Failed;
+        qint64 bytes = 0;
+        qint64 elapsedNs = 0;
+
+        bool IsSucceeded() const { return method != Method::Failed; }
+        //1秒あたりのバイト数
+        double GetBytesPerSecond() const;
+    };
+
+    //ワーカースレッドから呼んでよい
+    //allowHardLinkの場合、同じファイルシステム上ならコピーせずにハードリンクを作る(出力を編集すると元ファイルも変わる)
+    Result Copy(const QString& source, const QString& destination, bool allowHardLink);
+
+    QString GetMethodName(Method method);
+}
+
+#endif // FASTFILECOPY_H
@@ -14,53 +14,23 @@ FlacEncoder::FlacEncoder()
 FlacEncoder::~FlacEncoder(){
 }
 
-bool FlacEncoder::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+QStringList FlacEncoder::GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const
 {
-    QProcess* process = new QProcess(this);
-    process->setProgram(qApp->applicationDirPath()+"/ffmpeg.exe");
-    connect(process, &QProcess::readyReadStandardOutput, this, [this, process](){
-        QByteArray arr = process->readAllStandardOutput();
-        emit this->readStdOut("[mp3] " + QString(arr));
-    });
-    connect(process, &QProcess::readyReadStandardError, this, [this, process](){
-        QByteArray arr = process->readAllStandardError();
-        emit this->readStdOut("[mp3] " + QString(arr));
-    });
-    connect(process, &QProcess::readChannelFinished, this, [this, inputPath, metaData](){
-        emit this->encodeFinish(inputPath, metaData);
-    });
-
-    QString outputFile = GetOutputPath(metaData.title, ".flac", processNumber);
-
     // エンコードオプション
     QStringList option;
-    option << "-y" << "-i" << inputPath;
     // アートワークオプションの追加
-    auto artworkPath = metaData.artworkPath.replace("\\", "/");
-    if(QFile::exists(artworkPath)){
-        option << "-i" << artworkPath
-                      << "-map" << "0:0" << "-map" << "1:0"
-                      << "-c:v" << "mjpeg" << "-disposition:v:0" << "attached_pic";
+    if(artworkInput >= 0){
+        option << "-map" << QString("%1:0").arg(audioInput) << "-map" << QString("%1:0").arg(artworkInput)
+               << "-c:v" << GetArtworkCodec(metaData) << "-disposition:v:0" << "attached_pic";
     }
-    option << "-c:a" << "flac";
+    else{
+        //まとめてエンコードする場合は入力が複数あるので、常にこの曲の音源だけを明示して出力する
+        option << "-map" << QString("%1:0").arg(audioInput);
+    }
+    option << "-c:a" << GetAudioEncoderName();
 
     // メタデータオプションの追加
     AppendCommonMetaDataOption(option, metaData);
 
-    // 入力と出力ファイルオプションの追加
-    option << outputFile.replace("\\", "/");
-
-#ifdef QT_DEBUG
-    emit this->readStdOut(process->program() + " ");
-    emit this->readStdOut(process->arguments().join(" ") + "\n");
-#endif
-
-    process->setArguments(option);
-    process->start();
-    if (!process->waitForStarted(-1)) {
-        qWarning() << process->errorString();
-        return false;
-    }
-
-    return true;
+    return option;
 }
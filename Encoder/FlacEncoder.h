@@ -10,10 +10,12 @@ public:
     FlacEncoder();
     ~FlacEncoder() override;
 
-    bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) override;
+    QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const override;
 
     QString GetEncoderFileName() const override { return "refalac"; }
-    QString GetCodecExtention() const override { return "m4a"; }
+    QString GetCodecExtention() const override { return "flac"; }
+    QString GetCodecName() const override { return "flac"; }
+    QString GetAudioEncoderName() const override { return "flac"; }
 
 private:
 };
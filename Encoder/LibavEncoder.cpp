@@ -0,0 +1,637 @@
+#include "LibavEncoder.h"
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#ifdef ENCODEUTILITY_USE_LIBAV
+#include <QBuffer>
+#include <QImage>
+#include <QImageReader>
+#include <QMap>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+
+namespace
+{
+    QString AvError(int errorCode)
+    {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(errorCode, buffer, sizeof(buffer));
+        return QString::fromUtf8(buffer);
+    }
+
+    //ffmpegの引数のうち、1出力ファイル分の指定
+    struct OutputSpec
+    {
+        QString path;
+        QList<int> mapInputs;                   //-mapで指定された入力番号
+        QMap<QString, QString> codecs;          //"a" / "v" → エンコーダー名
+        QMap<QString, QString> options;         //コーデック・マルチプレクサーへのオプション
+        QList<std::pair<QString, QString>> metaData;
+        QList<std::pair<QString, QString>> pictureMetaData;
+        double volumeDb = 0.0;                  //-af volume=XdB
+    };
+
+    struct Command
+    {
+        QStringList inputs;
+        std::vector<OutputSpec> outputs;
+    };
+
+    //ffmpegのコマンドラインのうち、各エンコーダーが出力する範囲だけを解釈する
+    bool ParseArguments(const QStringList& arguments, const QStringList& outputPaths, Command& command, QString& error)
+    {
+        OutputSpec current;
+        for(int i=0; i<arguments.size(); ++i)
+        {
+            const QString& arg = arguments[i];
+            if(arg == "-y"){ continue; }
+            if(outputPaths.contains(arg)){
+                current.path = arg;
+                command.outputs.emplace_back(std::move(current));
+                current = OutputSpec();
+                continue;
+            }
+            if(arg.startsWith('-') == false || i+1 >= arguments.size()){
+                error = "unsupported argument : " + arg;
+                return false;
+            }
+
+            const QString& value = arguments[++i];
+            if(arg == "-i"){
+                command.inputs << value;
+            }
+            else if(arg == "-map"){
+                current.mapInputs << value.section(':', 0, 0).toInt();
+            }
+            else if(arg == "-c:a" || arg == "-acodec"){
+                current.codecs["a"] = value;
+            }
+            else if(arg == "-c:v" || arg == "-vcodec"){
+                current.codecs["v"] = value;
+            }
+            else if(arg == "-metadata" || arg == "-metadata:s:v"){
+                const int pos = value.indexOf('=');
+                if(pos <= 0){ continue; }
+                auto& target = (arg == "-metadata") ? current.metaData : current.pictureMetaData;
+                target.append({value.left(pos), value.mid(pos+1)});
+            }
+            else if(arg == "-af" || arg == "-filter:a"){
+                //フィルターはAppendLossyGainOptionが付けるvolume=XdBだけに対応する
+                bool isOk = false;
+                if(value.startsWith("volume=") && value.endsWith("dB")){
+                    current.volumeDb = value.mid(7).chopped(2).toDouble(&isOk);
+                }
+                if(isOk == false){
+                    error = "unsupported filter : " + value;
+                    return false;
+                }
+            }
+            else if(arg.startsWith("-disposition")){
+                //アートワークは常にattached_picとして書き出す
+                continue;
+            }
+            else{
+                //-b:a 320k → b=320k のようにストリーム指定を外してAVOptionとして渡す
+                QString name = arg.mid(1).section(':', 0, 0);
+                current.options[name] = value;
+            }
+        }
+        if(command.inputs.isEmpty() || command.outputs.empty()){
+            error = "no input or output";
+            return false;
+        }
+        return true;
+    }
+
+    const AVSampleFormat* SupportedSampleFormats(const AVCodec* codec)
+    {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+        const void* values = nullptr;
+        avcodec_get_supported_config(nullptr, codec, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0, &values, nullptr);
+        return static_cast<const AVSampleFormat*>(values);
+#else
+        return codec->sample_fmts;
+#endif
+    }
+
+    const int* SupportedSampleRates(const AVCodec* codec)
+    {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+        const void* values = nullptr;
+        avcodec_get_supported_config(nullptr, codec, AV_CODEC_CONFIG_SAMPLE_RATE, 0, &values, nullptr);
+        return static_cast<const int*>(values);
+#else
+        return codec->supported_samplerates;
+#endif
+    }
+
+    //ffmpegと同じく、入力と同じ形式→planar/packedだけ違う形式→先頭の形式の順に選ぶ
+    AVSampleFormat ChooseSampleFormat(const AVCodec* codec, AVSampleFormat input)
+    {
+        const auto* formats = SupportedSampleFormats(codec);
+        if(formats == nullptr){ return input; }
+        const AVSampleFormat alternative = av_get_alt_sample_fmt(input, av_sample_fmt_is_planar(input) == 0);
+        for(const auto* p = formats; *p != AV_SAMPLE_FMT_NONE; ++p){
+            if(*p == input){ return input; }
+        }
+        for(const auto* p = formats; *p != AV_SAMPLE_FMT_NONE; ++p){
+            if(*p == alternative){ return alternative; }
+        }
+        return formats[0];
+    }
+
+    //対応していないサンプリングレートの場合は最も近いものにリサンプルする
+    int ChooseSampleRate(const AVCodec* codec, int input)
+    {
+        const auto* rates = SupportedSampleRates(codec);
+        if(rates == nullptr){ return input; }
+        int best = rates[0];
+        for(const auto* p = rates; *p != 0; ++p){
+            if(std::abs(*p - input) < std::abs(best - input)){ best = *p; }
+        }
+        return best;
+    }
+
+    //1出力ファイル分のlibavの状態
+    struct Output
+    {
+        ~Output()
+        {
+            if(convertBuffer){ av_freep(&convertBuffer[0]); }
+            av_freep(&convertBuffer);
+            av_audio_fifo_free(fifo);
+            swr_free(&resampler);
+            avcodec_free_context(&codec);
+            if(format && (format->oformat->flags & AVFMT_NOFILE) == 0){ avio_closep(&format->pb); }
+            avformat_free_context(format);
+        }
+
+        AVFormatContext* format = nullptr;
+        AVCodecContext* codec = nullptr;
+        AVStream* audioStream = nullptr;
+        SwrContext* resampler = nullptr;
+        AVAudioFifo* fifo = nullptr;
+        uint8_t** convertBuffer = nullptr;
+        int convertCapacity = 0;
+        int64_t nextPts = 0;
+    };
+
+    class Encoder
+    {
+    public:
+        //ffmpegの-progressと同程度の間隔で報告する
+        static constexpr qint64 progressIntervalMs = 500;
+
+        explicit Encoder(LibavEncoder::ProgressCallback onProgress) : onProgress(std::move(onProgress)){
+            reportTimer.start();
+        }
+        ~Encoder()
+        {
+            av_packet_free(&packet);
+            av_frame_free(&frame);
+            avcodec_free_context(&decoder);
+            avformat_close_input(&input);
+        }
+
+        QString Run(const Command& command)
+        {
+            QString error = OpenInput(command.inputs.first());
+            if(error.isEmpty() == false){ return error; }
+
+            QByteArray picture;
+            for(const auto& spec : command.outputs)
+            {
+                outputs.emplace_back(std::make_unique<Output>());
+                if(command.inputs.size() > 1 && picture.isEmpty()){
+                    error = LoadPicture(command.inputs[1], spec.codecs.value("v", "copy"), picture);
+                    if(error.isEmpty() == false){ return error; }
+                }
+                const bool hasPicture = command.inputs.size() > 1 && (spec.mapInputs.isEmpty() || spec.mapInputs.contains(1));
+                error = OpenOutput(*outputs.back(), spec, hasPicture ? picture : QByteArray());
+                if(error.isEmpty() == false){ return spec.path + " : " + error; }
+            }
+
+            //入力は1回だけデコードし、全ての出力に配る
+            int ret = 0;
+            while((ret = av_read_frame(input, packet)) >= 0)
+            {
+                if(packet->stream_index == audioStreamIndex){
+                    ret = avcodec_send_packet(decoder, packet);
+                }
+                av_packet_unref(packet);
+                if(ret < 0){ return "decode : " + AvError(ret); }
+                error = ReceiveFrames();
+                if(error.isEmpty() == false){ return error; }
+            }
+            if(ret != AVERROR_EOF){ return "read : " + AvError(ret); }
+
+            avcodec_send_packet(decoder, nullptr);
+            error = ReceiveFrames();
+            if(error.isEmpty() == false){ return error; }
+
+            for(auto& output : outputs)
+            {
+                error = Flush(*output);
+                if(error.isEmpty() == false){ return error; }
+            }
+            return QString();
+        }
+
+    private:
+        QString OpenInput(const QString& path)
+        {
+            int ret = avformat_open_input(&input, path.toUtf8().constData(), nullptr, nullptr);
+            if(ret < 0){ return "open " + path + " : " + AvError(ret); }
+            ret = avformat_find_stream_info(input, nullptr);
+            if(ret < 0){ return "stream info : " + AvError(ret); }
+
+            const AVCodec* codec = nullptr;
+            audioStreamIndex = av_find_best_stream(input, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+            if(audioStreamIndex < 0){ return "no audio stream : " + path; }
+
+            decoder = avcodec_alloc_context3(codec);
+            avcodec_parameters_to_context(decoder, input->streams[audioStreamIndex]->codecpar);
+            ret = avcodec_open2(decoder, codec, nullptr);
+            if(ret < 0){ return "open decoder : " + AvError(ret); }
+
+            frame = av_frame_alloc();
+            packet = av_packet_alloc();
+            return QString();
+        }
+
+        //-c:v copy はファイルをそのまま、mjpegはJPEGに変換して1パケットとして埋め込む
+        static QString LoadPicture(const QString& path, const QString& codec, QByteArray& picture)
+        {
+            QFile file(path);
+            if(file.open(QFile::ReadOnly) == false){ return "can't read artwork : " + path; }
+            picture = file.readAll();
+            if(codec == "copy"){ return QString(); }
+
+            QImage image;
+            if(image.loadFromData(picture) == false){ return "can't decode artwork : " + path; }
+            picture.clear();
+            QBuffer buffer(&picture);
+            buffer.open(QIODevice::WriteOnly);
+            image.convertToFormat(QImage::Format_RGB888).save(&buffer, "JPEG", 95);
+            return QString();
+        }
+
+        QString OpenOutput(Output& output, const OutputSpec& spec, const QByteArray& picture)
+        {
+            const QByteArray path = spec.path.toUtf8();
+            int ret = avformat_alloc_output_context2(&output.format, nullptr, nullptr, path.constData());
+            if(ret < 0){ return "output format : " + AvError(ret); }
+
+            const AVCodec* codec = nullptr;
+            if(spec.codecs.contains("a")){
+                codec = avcodec_find_encoder_by_name(spec.codecs["a"].toUtf8().constData());
+            }
+            else{
+                codec = avcodec_find_encoder(output.format->oformat->audio_codec);
+            }
+            if(codec == nullptr){ return "encoder not found : " + spec.codecs.value("a"); }
+
+            output.codec = avcodec_alloc_context3(codec);
+            output.codec->sample_fmt  = ChooseSampleFormat(codec, decoder->sample_fmt);
+            output.codec->sample_rate = ChooseSampleRate(codec, decoder->sample_rate);
+            output.codec->time_base   = AVRational{1, output.codec->sample_rate};
+            av_channel_layout_copy(&output.codec->ch_layout, &decoder->ch_layout);
+            if(decoder->bits_per_raw_sample > 0){
+                output.codec->bits_per_raw_sample = std::min(decoder->bits_per_raw_sample, av_get_bytes_per_sample(output.codec->sample_fmt) * 8);
+            }
+            if(output.format->oformat->flags & AVFMT_GLOBALHEADER){
+                output.codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+            }
+
+            //エンコーダーが使わなかったオプションはマルチプレクサーに渡す(-id3v2_versionなど)
+            AVDictionary* options = nullptr;
+            for(auto itr = spec.options.cbegin(); itr != spec.options.cend(); ++itr){
+                av_dict_set(&options, itr.key().toUtf8().constData(), itr.value().toUtf8().constData(), 0);
+            }
+            ret = avcodec_open2(output.codec, codec, &options);
+            if(ret < 0){
+                av_dict_free(&options);
+                return "open encoder : " + AvError(ret);
+            }
+
+            output.audioStream = avformat_new_stream(output.format, nullptr);
+            avcodec_parameters_from_context(output.audioStream->codecpar, output.codec);
+            output.audioStream->time_base = output.codec->time_base;
+
+            AVStream* pictureStream = nullptr;
+            if(picture.isEmpty() == false)
+            {
+                pictureStream = avformat_new_stream(output.format, nullptr);
+                pictureStream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+                pictureStream->codecpar->codec_id   = AV_CODEC_ID_MJPEG;
+                QBuffer buffer;
+                buffer.setData(picture);
+                const QSize size = QImageReader(&buffer).size();
+                pictureStream->codecpar->width  = size.width();
+                pictureStream->codecpar->height = size.height();
+                pictureStream->disposition = AV_DISPOSITION_ATTACHED_PIC;
+                pictureStream->time_base = AVRational{1, 90000};
+                for(const auto& [key, value] : spec.pictureMetaData){
+                    av_dict_set(&pictureStream->metadata, key.toUtf8().constData(), value.toUtf8().constData(), 0);
+                }
+            }
+
+            //ffmpegと同様に入力のメタデータを引き継ぎ、-metadataで上書きする
+            av_dict_copy(&output.format->metadata, input->metadata, 0);
+            av_dict_set(&output.format->metadata, "encoder", LIBAVFORMAT_IDENT, 0);
+            for(const auto& [key, value] : spec.metaData){
+                av_dict_set(&output.format->metadata, key.toUtf8().constData(), value.toUtf8().constData(), 0);
+            }
+
+            if((output.format->oformat->flags & AVFMT_NOFILE) == 0)
+            {
+                ret = avio_open(&output.format->pb, path.constData(), AVIO_FLAG_WRITE);
+                if(ret < 0){
+                    av_dict_free(&options);
+                    return "open : " + AvError(ret);
+                }
+            }
+            ret = avformat_write_header(output.format, &options);
+            av_dict_free(&options);
+            if(ret < 0){ return "write header : " + AvError(ret); }
+
+            if(pictureStream)
+            {
+                AVPacket* picturePacket = av_packet_alloc();
+                av_new_packet(picturePacket, static_cast<int>(picture.size()));
+                std::memcpy(picturePacket->data, picture.constData(), picture.size());
+                picturePacket->stream_index = pictureStream->index;
+                picturePacket->flags |= AV_PKT_FLAG_KEY;
+                picturePacket->pts = picturePacket->dts = 0;
+                ret = av_interleaved_write_frame(output.format, picturePacket);
+                av_packet_free(&picturePacket);
+                if(ret < 0){ return "write artwork : " + AvError(ret); }
+            }
+
+            ret = swr_alloc_set_opts2(&output.resampler,
+                                      &output.codec->ch_layout, output.codec->sample_fmt, output.codec->sample_rate,
+                                      &decoder->ch_layout, decoder->sample_fmt, decoder->sample_rate, 0, nullptr);
+            if(ret >= 0 && spec.volumeDb != 0.0)
+            {
+                //-af volumeの代わりに、チャンネルをそのまま移す行列にゲインを掛けてswresampleで掛ける
+                const int inChannels = decoder->ch_layout.nb_channels;
+                const int outChannels = output.codec->ch_layout.nb_channels;
+                std::vector<double> matrix(size_t(inChannels) * outChannels, 0.0);
+                const double gain = std::pow(10.0, spec.volumeDb / 20.0);
+                for(int ch=0; ch<std::min(inChannels, outChannels); ++ch){
+                    matrix[size_t(ch) * inChannels + ch] = gain;
+                }
+                ret = swr_set_matrix(output.resampler, matrix.data(), inChannels);
+            }
+            if(ret < 0 || (ret = swr_init(output.resampler)) < 0){ return "resampler : " + AvError(ret); }
+
+            output.fifo = av_audio_fifo_alloc(output.codec->sample_fmt, output.codec->ch_layout.nb_channels, 1);
+            if(output.fifo == nullptr){ return "out of memory"; }
+            return QString();
+        }
+
+        QString ReceiveFrames()
+        {
+            int ret = 0;
+            while((ret = avcodec_receive_frame(decoder, frame)) >= 0)
+            {
+                for(auto& output : outputs)
+                {
+                    QString error = Convert(*output, const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples);
+                    if(error.isEmpty()){ error = EncodeFifo(*output, false); }
+                    if(error.isEmpty() == false){
+                        av_frame_unref(frame);
+                        return error;
+                    }
+                }
+                ReportProgress();
+                av_frame_unref(frame);
+            }
+            if(ret != AVERROR(EAGAIN) && ret != AVERROR_EOF){ return "decode : " + AvError(ret); }
+            return QString();
+        }
+
+        //入力のサンプルをエンコーダーの形式に変換してFIFOに溜める inputがnullptrの場合はリサンプラーの残りを出す
+        static QString Convert(Output& output, const uint8_t** input, int numSamples)
+        {
+            const int capacity = swr_get_out_samples(output.resampler, numSamples);
+            if(capacity <= 0){ return QString(); }
+            if(capacity > output.convertCapacity)
+            {
+                if(output.convertBuffer){ av_freep(&output.convertBuffer[0]); }
+                av_freep(&output.convertBuffer);
+                const int ret = av_samples_alloc_array_and_samples(&output.convertBuffer, nullptr, output.codec->ch_layout.nb_channels,
+                                                                   capacity, output.codec->sample_fmt, 0);
+                if(ret < 0){ return "out of memory"; }
+                output.convertCapacity = capacity;
+            }
+            const int converted = swr_convert(output.resampler, output.convertBuffer, capacity, input, numSamples);
+            if(converted < 0){ return "resample : " + AvError(converted); }
+            if(converted > 0 && av_audio_fifo_write(output.fifo, reinterpret_cast<void**>(output.convertBuffer), converted) < converted){
+                return "out of memory";
+            }
+            return QString();
+        }
+
+        //FIFOからエンコーダーのフレームサイズずつ取り出してエンコードする isFlushの場合は端数も出す
+        static QString EncodeFifo(Output& output, bool isFlush)
+        {
+            const bool isVariable = output.codec->frame_size <= 0 || (output.codec->codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE);
+            const int frameSize = isVariable ? 4096 : output.codec->frame_size;
+            while(av_audio_fifo_size(output.fifo) >= frameSize || (isFlush && av_audio_fifo_size(output.fifo) > 0))
+            {
+                AVFrame* frame = av_frame_alloc();
+                frame->nb_samples  = std::min(frameSize, av_audio_fifo_size(output.fifo));
+                frame->format      = output.codec->sample_fmt;
+                frame->sample_rate = output.codec->sample_rate;
+                av_channel_layout_copy(&frame->ch_layout, &output.codec->ch_layout);
+                int ret = av_frame_get_buffer(frame, 0);
+                if(ret >= 0){
+                    av_audio_fifo_read(output.fifo, reinterpret_cast<void**>(frame->data), frame->nb_samples);
+                    frame->pts = output.nextPts;
+                    output.nextPts += frame->nb_samples;
+                    ret = avcodec_send_frame(output.codec, frame);
+                }
+                av_frame_free(&frame);
+                if(ret < 0){ return "encode : " + AvError(ret); }
+
+                const QString error = WritePackets(output);
+                if(error.isEmpty() == false){ return error; }
+            }
+            return QString();
+        }
+
+        static QString WritePackets(Output& output)
+        {
+            AVPacket* packet = av_packet_alloc();
+            int ret = 0;
+            while((ret = avcodec_receive_packet(output.codec, packet)) >= 0)
+            {
+                av_packet_rescale_ts(packet, output.codec->time_base, output.audioStream->time_base);
+                packet->stream_index = output.audioStream->index;
+                ret = av_interleaved_write_frame(output.format, packet);
+                if(ret < 0){ break; }
+            }
+            av_packet_free(&packet);
+            if(ret != AVERROR(EAGAIN) && ret != AVERROR_EOF){ return "write : " + AvError(ret); }
+            return QString();
+        }
+
+        static QString Flush(Output& output)
+        {
+            QString error = Convert(output, nullptr, 0);
+            if(error.isEmpty()){ error = EncodeFifo(output, true); }
+            if(error.isEmpty() == false){ return error; }
+
+            avcodec_send_frame(output.codec, nullptr);
+            error = WritePackets(output);
+            if(error.isEmpty() == false){ return error; }
+
+            const int ret = av_write_trailer(output.format);
+            if(ret < 0){ return "write trailer : " + AvError(ret); }
+            return QString();
+        }
+
+        void ReportProgress()
+        {
+            if(!onProgress || reportTimer.elapsed() < progressIntervalMs){ return; }
+            reportTimer.restart();
+
+            const AVStream* stream = input->streams[audioStreamIndex];
+            const int64_t timestamp = frame->best_effort_timestamp;
+            if(timestamp == AV_NOPTS_VALUE){ return; }
+            double seconds = double(timestamp) * av_q2d(stream->time_base);
+            if(stream->start_time != AV_NOPTS_VALUE){
+                seconds -= double(stream->start_time) * av_q2d(stream->time_base);
+            }
+            qint64 totalSize = 0;
+            for(const auto& output : outputs){
+                if(output->format->pb){ totalSize += avio_tell(output->format->pb); }
+            }
+            onProgress(seconds, totalSize);
+        }
+
+        LibavEncoder::ProgressCallback onProgress;
+        QElapsedTimer reportTimer;
+        AVFormatContext* input = nullptr;
+        AVCodecContext* decoder = nullptr;
+        AVFrame* frame = nullptr;
+        AVPacket* packet = nullptr;
+        int audioStreamIndex = -1;
+        std::vector<std::unique_ptr<Output>> outputs;
+    };
+}
+#endif
+
+LibavEncoder::LibavEncoder(std::shared_ptr<EncoderInterface> baseEncoder)
+    : EncoderInterface()
+    , baseEncoder(std::move(baseEncoder))
+{
+}
+
+LibavEncoder::~LibavEncoder(){
+}
+
+bool LibavEncoder::IsAvailable()
+{
+#ifdef ENCODEUTILITY_USE_LIBAV
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LibavEncoder::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+{
+    if(IsAvailable() == false){ return false; }
+
+    const auto arguments = this->BuildArguments(inputPath, metaData, processNumber);
+    const auto outputPaths = this->GetOutputFilePaths(metaData, processNumber);
+    if(outputPaths.isEmpty()){ return false; }
+
+    //進捗はffmpeg版と同じ形でencodeProgressとして通知する
+    EncodeProgress progress;
+    progress.durationSeconds = GetInputDuration(inputPath, metaData);
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+    ProgressCallback onProgress = [this, processNumber, progress, elapsedTimer](double outTimeSeconds, qint64 totalSize) mutable {
+        progress.outTimeSeconds = outTimeSeconds;
+        progress.totalSize = totalSize;
+        const double elapsedSeconds = elapsedTimer.elapsed() / 1000.0;
+        progress.speed = elapsedSeconds > 0.0 ? outTimeSeconds / elapsedSeconds : 0.0;
+        QMetaObject::invokeMethod(this, [this, processNumber, progress](){
+            emit this->encodeProgress(processNumber, progress);
+        }, Qt::QueuedConnection);
+    };
+
+    //エンコードはスレッドプールで行い、完了通知はこのオブジェクトのスレッドで発行する
+    //使用量はワーカースレッドのCPU時間 メモリはプロセス全体と区別できないので記録しない
+    auto usage = std::make_shared<ResourceUsage::Usage>();
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, inputPath, metaData, processNumber, usage](){
+        emit this->encodeUsage(processNumber, *usage);
+        const QString error = watcher->result();
+        if(error.isEmpty() == false){
+            emit this->readJobOutput(processNumber, "[" + GetCodecName() + "] " + error + "\n");
+            emit this->encodeError(inputPath, metaData, processNumber, error);
+        }
+        emit this->encodeFinish(inputPath, metaData, processNumber);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([arguments, outputPaths, onProgress, usage](){
+        const auto begin = ResourceUsage::ReadCurrentThread();
+        QString error = LibavEncoder::EncodeArguments(arguments, outputPaths, onProgress);
+        *usage = ResourceUsage::Difference(begin, ResourceUsage::ReadCurrentThread());
+        return error;
+    }));
+    return true;
+}
+
+QStringList LibavEncoder::BuildArguments(const QString& inputPath, const AudioMetaData& metaData, int processNumber) const
+{
+    return baseEncoder->BuildArguments(inputPath, metaData, processNumber);
+}
+
+QStringList LibavEncoder::GetOutputFilePaths(const AudioMetaData& metaData, int processNumber) const
+{
+    return baseEncoder->GetOutputFilePaths(metaData, processNumber);
+}
+
+QStringList LibavEncoder::GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const
+{
+    return baseEncoder->GetOutputOptions(metaData, audioInput, artworkInput);
+}
+
+QString LibavEncoder::EncodeArguments(const QStringList& arguments, const QStringList& outputPaths, const ProgressCallback& onProgress)
+{
+#ifdef ENCODEUTILITY_USE_LIBAV
+    Command command;
+    QString error;
+    if(ParseArguments(arguments, outputPaths, command, error) == false){
+        return error;
+    }
+    Encoder encoder(onProgress);
+    return encoder.Run(command);
+#else
+    Q_UNUSED(arguments);
+    Q_UNUSED(outputPaths);
+    Q_UNUSED(onProgress);
+    return "built without libavcodec";
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef LIBAVENCODER_H
+#define LIBAVENCODER_H
+
+#include "EncoderInterface.h"
+
+#include <functional>
+#include <memory>
+
+//ffmpegを起動せず、libavformat/libavcodecでプロセス内エンコードする
+//引数は元のエンコーダーのBuildArgumentsをそのまま解釈するので、コーデック設定・メタデータはffmpeg版と同じになる
+//qmakeで CONFIG+=libav を指定した場合のみ有効(ENCODEUTILITY_USE_LIBAV)
+class LibavEncoder : public EncoderInterface
+{
+    Q_OBJECT
+public:
+    explicit LibavEncoder(std::shared_ptr<EncoderInterface> baseEncoder);
+    ~LibavEncoder() override;
+
+    //libavcodecをリンクしてビルドされているか
+    static bool IsAvailable();
+    //ワーカースレッドで1曲ずつエンコードするので、まとめても起動の手間は減らない
+    bool IsBatchSupported() const override { return false; }
+
+    const std::shared_ptr<EncoderInterface>& GetBaseEncoder() const { return baseEncoder; }
+
+    bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) override;
+    QStringList BuildArguments(const QString& inputPath, const AudioMetaData& metaData, int processNumber) const override;
+    QStringList GetOutputFilePaths(const AudioMetaData& metaData, int processNumber) const override;
+    QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const override;
+
+    QString GetEncoderFileName() const override { return "libavcodec"; }
+    QString GetCodecExtention() const override { return baseEncoder->GetCodecExtention(); }
+    QString GetCodecName() const override { return baseEncoder->GetCodecName(); }
+
+    //エンコード済みの長さ(秒)と書き出したバイト数を受け取る
+    using ProgressCallback = std::function<void(double outTimeSeconds, qint64 totalSize)>;
+
+    //ffmpegの引数を解釈して、outputPathsの各ファイルを書き出す
+    //ワーカースレッドから呼ばれる 成功時は空文字、失敗時はエラーメッセージを返す
+    static QString EncodeArguments(const QStringList& arguments, const QStringList& outputPaths, const ProgressCallback& onProgress = {});
+
+private:
+    std::shared_ptr<EncoderInterface> baseEncoder;
+};
+
+#endif // LIBAVENCODER_H
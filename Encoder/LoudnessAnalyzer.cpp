@@ -0,0 +1,251 @@
+#include "LoudnessAnalyzer.h"
+
+#include "PcmReader.h"
+#include "SimdFloat.h"
+#include "TruePeakFilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    double EnergyOf(double lufs){ return std::pow(10.0, (lufs + 0.691) / 10.0); }
+    double LoudnessOf(double energy){
+        return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+    }
+
+    //転置直接形IIの2次IIR 4チャンネル分をまとめて計算する
+    struct Biquad4
+    {
+        Float4 b0, b1, b2, a1, a2;
+        Float4 z1 = Float4::Zero();
+        Float4 z2 = Float4::Zero();
+
+        explicit Biquad4(const std::array<double, 5>& c)
+            : b0(Float4::Set1(float(c[0]))), b1(Float4::Set1(float(c[1]))), b2(Float4::Set1(float(c[2])))
+            , a1(Float4::Set1(float(c[3]))), a2(Float4::Set1(float(c[4])))
+        {
+        }
+        Float4 Process(Float4 x)
+        {
+            const Float4 y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    //BS.1770の48kHzの係数を、元のアナログ特性からサンプリング周波数に合わせて作り直す {b0, b1, b2, a1, a2}
+    std::array<double, 5> MakeShelfFilter(double sampleRate)
+    {
+        const double f0 = 1681.974450955533;
+        const double gain = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gain / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        return {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+    std::array<double, 5> MakeHighPassFilter(double sampleRate)
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        return {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+
+    //5.1ch(L R C LFE Ls Rs)のLFEは含めず、サラウンドは+1.5dBで数える
+    float ChannelWeight(int channel, int numChannels)
+    {
+        if(numChannels == 6){
+            if(channel == 3){ return 0.0f; }
+            if(channel >= 4){ return 1.41f; }
+        }
+        return 1.0f;
+    }
+
+    //EBU Tech 3342 3秒の短時間ラウドネスを1秒ごとに求め、ゲート後の10〜95パーセンタイルの幅
+    double GetLoudnessRange(const std::vector<double>& subBlocks)
+    {
+        std::vector<double> energies;
+        for(size_t end=30; end<=subBlocks.size(); end+=10)
+        {
+            double sum = 0.0;
+            for(size_t i=end-30; i<end; ++i){ sum += subBlocks[i]; }
+            energies.push_back(sum / 30.0);
+        }
+        const double absoluteGate = EnergyOf(LoudnessAnalyzer::absoluteGateLufs);
+        double sum = 0.0;
+        int count = 0;
+        for(double energy : energies){
+            if(energy > absoluteGate){ sum += energy; ++count; }
+        }
+        if(count == 0){ return 0.0; }
+        const double relativeGate = std::max(absoluteGate, sum / count * 0.01);   //-20LU
+
+        std::vector<double> loudness;
+        for(double energy : energies){
+            if(energy > relativeGate){ loudness.push_back(LoudnessOf(energy)); }
+        }
+        if(loudness.empty()){ return 0.0; }
+        std::sort(loudness.begin(), loudness.end());
+        const auto Percentile = [&](double ratio){ return loudness[size_t(std::lround((loudness.size() - 1) * ratio))]; };
+        return Percentile(0.95) - Percentile(0.10);
+    }
+}
+
+namespace LoudnessAnalyzer
+{
+
+double Result::GetTruePeakDb() const
+{
+    return truePeak > 0.0 ? 20.0 * std::log10(truePeak) : -std::numeric_limits<double>::infinity();
+}
+
+Result Analyze(const QString& filePath, const std::atomic_bool* isCanceled)
+{
+    Result result;
+    PcmReader reader;
+    if(reader.Open(filePath) == false){ return result; }
+
+    const int numChannels = reader.GetNumChannels();
+    const int numGroups = (numChannels + 3) / 4;
+    const double sampleRate = reader.GetSampleRate();
+    std::vector<Biquad4> shelves(numGroups, Biquad4(MakeShelfFilter(sampleRate)));
+    std::vector<Biquad4> highPasses(numGroups, Biquad4(MakeHighPassFilter(sampleRate)));
+    std::vector<Float4> weights;
+    for(int group=0; group<numGroups; ++group)
+    {
+        float weight[4];
+        for(int lane=0; lane<4; ++lane){
+            const int channel = group * 4 + lane;
+            weight[lane] = channel < numChannels ? ChannelWeight(channel, numChannels) : 0.0f;
+        }
+        weights.push_back(Float4::Load(weight));
+    }
+    std::vector<Float4> sums(numGroups, Float4::Zero());
+    std::vector<TruePeakFilter> truePeaks(numChannels);
+
+    //100msごとの二乗和 400msブロック・3秒の短時間ラウドネスはここから組み立てる
+    const qint64 framesPer100ms = std::max<qint64>(1, std::llround(sampleRate / 10.0));
+    qint64 framesInSubBlock = 0;
+    std::vector<double> subBlocks;
+    subBlocks.reserve(size_t(reader.GetNumFrames() / framesPer100ms) + 1);
+
+    std::vector<std::vector<float>> channels;
+    std::vector<float> silence;
+    while(true)
+    {
+        if(isCanceled != nullptr && isCanceled->load()){ return Result(); }
+        const qint64 frames = reader.Read(channels);
+        if(frames <= 0){ break; }
+        if(numChannels % 4 != 0 && qint64(silence.size()) < frames){ silence.resize(frames, 0.0f); }
+
+        for(int ch=0; ch<numChannels; ++ch){
+            truePeaks[ch].Process(channels[ch].data(), frames);
+        }
+
+        qint64 begin = 0;
+        while(begin < frames)
+        {
+            const qint64 end = std::min(frames, begin + framesPer100ms - framesInSubBlock);
+            for(int group=0; group<numGroups; ++group)
+            {
+                const float* lanes[4];
+                for(int lane=0; lane<4; ++lane){
+                    const int channel = group * 4 + lane;
+                    lanes[lane] = channel < numChannels ? channels[channel].data() : silence.data();
+                }
+                Biquad4& shelf = shelves[group];
+                Biquad4& highPass = highPasses[group];
+                Float4 sum = sums[group];
+                for(qint64 i=begin; i<end; ++i)
+                {
+                    const Float4 y = highPass.Process(shelf.Process(Float4::Set(lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i])));
+                    sum = sum + y * y;
+                }
+                sums[group] = sum;
+            }
+            framesInSubBlock += end - begin;
+            begin = end;
+
+            if(framesInSubBlock == framesPer100ms)
+            {
+                double energy = 0.0;
+                for(int group=0; group<numGroups; ++group){
+                    energy += (sums[group] * weights[group]).Sum();
+                    sums[group] = Float4::Zero();
+                }
+                subBlocks.push_back(energy / framesPer100ms);
+                framesInSubBlock = 0;
+            }
+        }
+    }
+
+    //400msのブロックを100msずつずらす
+    for(size_t i=3; i<subBlocks.size(); ++i){
+        result.blockEnergies.push_back(float((subBlocks[i-3] + subBlocks[i-2] + subBlocks[i-1] + subBlocks[i]) / 4.0));
+    }
+    result.integratedLufs = GetGatedLoudness({&result.blockEnergies});
+    result.loudnessRange = GetLoudnessRange(subBlocks);
+    for(const auto& filter : truePeaks){
+        result.truePeak = std::max(result.truePeak, double(filter.GetPeak()));
+    }
+    result.isValid = true;
+    return result;
+}
+
+double GetGatedLoudness(const std::vector<const std::vector<float>*>& blockLists)
+{
+    const double absoluteGate = EnergyOf(absoluteGateLufs);
+    double sum = 0.0;
+    qint64 count = 0;
+    for(const auto* blocks : blockLists){
+        for(float energy : *blocks){
+            if(energy > absoluteGate){ sum += energy; ++count; }
+        }
+    }
+    if(count == 0){ return -std::numeric_limits<double>::infinity(); }
+
+    //ゲートを通ったブロックの平均から-10LU
+    const double relativeGate = std::max(absoluteGate, sum / count * 0.1);
+    sum = 0.0;
+    count = 0;
+    for(const auto* blocks : blockLists){
+        for(float energy : *blocks){
+            if(energy > relativeGate){ sum += energy; ++count; }
+        }
+    }
+    return count > 0 ? LoudnessOf(sum / count) : -std::numeric_limits<double>::infinity();
+}
+
+QString FormatGain(double gainDb)
+{
+    return QString::asprintf("%.2f dB", gainDb);
+}
+
+QString FormatPeak(double peak)
+{
+    return QString::asprintf("%.6f", peak);
+}
+
+QString MakeITunNorm(double gainDb, double peak)
+{
+    //1/1000W・1/2500Wを基準にした音量比を左右に1組ずつ、ピークは16bitのサンプル値で入れる
+    const double ratio = std::pow(10.0, -gainDb / 10.0);
+    const auto Scale = [ratio](double reference){ return uint(std::clamp(std::round(ratio * reference), 0.0, 65534.0)); };
+    const uint peakValue = uint(std::clamp(std::round(peak * 32768.0), 0.0, 4294967295.0));
+    const uint v1000 = Scale(1000.0);
+    const uint v2500 = Scale(2500.0);
+    return QString::asprintf(" %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X",
+                             v1000, v1000, v2500, v2500, 0u, 0u, peakValue, peakValue, 0u, 0u);
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include <QString>
+#include <atomic>
+#include <vector>
+
+//ITU-R BS.1770-4 / EBU R128 のラウドネスを元のwavから測る
+//K特性フィルターはチャンネルを4つずつまとめて計算する トゥルーピークはTruePeakFilterで求める
+namespace LoudnessAnalyzer
+{
+    static constexpr double absoluteGateLufs = -70.0;
+    //ReplayGain 2.0の基準
+    static constexpr double replayGainReferenceLufs = -18.0;
+
+    struct Result
+    {
+        bool isValid = false;
+        double integratedLufs = 0.0;    //無音の場合は-inf
+        double loudnessRange = 0.0;     //LU (EBU Tech 3342)
+        double truePeak = 0.0;          //リニア 1.0が0dBTP
+        //400msブロック(100ms間隔)ごとのチャンネル重み付き平均二乗 アルバム全体のゲート処理に使う
+        std::vector<float> blockEnergies;
+
+        double GetTruePeakDb() const;
+        //ReplayGainのトラックゲイン(dB)
+        double GetGainDb() const { return replayGainReferenceLufs - integratedLufs; }
+    };
+
+    //読めない・対応していない形式の場合はisValidがfalse isCanceledがtrueになったら途中で止める
+    Result Analyze(const QString& filePath, const std::atomic_bool* isCanceled = nullptr);
+
+    //複数の曲のブロックをまとめてゲート処理した平均ラウドネス(LUFS) アルバムのラウドネスに使う
+    double GetGatedLoudness(const std::vector<const std::vector<float>*>& blockLists);
+
+    //タグに書く値 ゲインは"-6.52 dB"、ピークは"0.988553"
+    QString FormatGain(double gainDb);
+    QString FormatPeak(double peak);
+    //iTunesのSound Check(iTunNORM) 左右同じ値を入れる
+    QString MakeITunNorm(double gainDb, double peak);
+}
+
+#endif // LOUDNESSANALYZER_H
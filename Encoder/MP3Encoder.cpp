@@ -14,56 +14,26 @@ MP3Encoder::MP3Encoder()
 MP3Encoder::~MP3Encoder(){
 }
 
-bool MP3Encoder::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+QStringList MP3Encoder::GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const
 {
-    QProcess* process = new QProcess(this);
-    process->setProgram(qApp->applicationDirPath()+"/ffmpeg.exe");
-    connect(process, &QProcess::readyReadStandardOutput, this, [this, process](){
-        QByteArray arr = process->readAllStandardOutput();
-        emit this->readStdOut("[mp3] " + QString(arr));
-    });
-    connect(process, &QProcess::readyReadStandardError, this, [this, process](){
-        QByteArray arr = process->readAllStandardError();
-        emit this->readStdOut("[mp3] " + QString(arr));
-    });
-    connect(process, &QProcess::readChannelFinished, this, [this, inputPath, metaData](){
-        emit this->encodeFinish(inputPath, metaData);
-    });
-
-    QString outputFile = GetOutputPath(metaData.title, ".mp3", processNumber);
-
     // エンコードオプション
     QStringList option;
-    option << "-y" << "-i" << inputPath;
     // アートワークオプションの追加
-    auto artworkPath = metaData.artworkPath.replace("\\", "/");
-    if(QFile::exists(artworkPath)){
-        option << "-i" << artworkPath
-            << "-map" << "0" << "-map" << "1"
-            << "-metadata:s:v" << "title=Album cover"
-            << "-metadata:s:v" << "comment=\"Cover (front)\""
-            << "-c:v" << "mjpeg";
+    if(artworkInput >= 0){
+        option << "-map" << QString::number(audioInput) << "-map" << QString::number(artworkInput)
+               << "-metadata:s:v" << "title=Album cover"
+               << "-metadata:s:v" << "comment=\"Cover (front)\""
+               << "-c:v" << GetArtworkCodec(metaData);
+    }
+    else{
+        //まとめてエンコードする場合は入力が複数あるので、常にこの曲の音源だけを明示して出力する
+        option << "-map" << QString::number(audioInput);
     }
     option << "-id3v2_version" << "3";
-    option << "-c:a" << "libmp3lame" << "-b:a" << "320k" << "-compression_level" << "0";
-
-    AppendCommonMetaDataOption(option, metaData);
+    AppendLossyGainOption(option, metaData);
+    option << "-c:a" << GetAudioEncoderName() << "-b:a" << "320k" << "-compression_level" << "0";
 
-    // 入力と出力ファイルオプションの追加
-    option << outputFile.replace("\\", "/");
-
-    process->setArguments(option);
-
-#ifdef QT_DEBUG
-    emit this->readStdOut(process->program() + " ");
-    emit this->readStdOut(process->arguments().join(" ") + "\n");
-#endif
-
-    process->start();
-    if (!process->waitForStarted(-1)) {
-        qWarning() << process->errorString();
-        return false;
-    }
+    AppendCommonMetaDataOption(option, metaData, metaData.lossyGainDb);
 
-    return true;
+    return option;
 }
@@ -9,10 +9,12 @@ public:
     MP3Encoder();
     ~MP3Encoder() override;
 
-    bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) override;
+    QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const override;
 
     QString GetEncoderFileName() const override { return "lame"; }
     QString GetCodecExtention() const override { return "mp3"; }
+    QString GetCodecName() const override { return "mp3"; }
+    QString GetAudioEncoderName() const override { return "libmp3lame"; }
 
 private:
 };
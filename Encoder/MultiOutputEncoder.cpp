@@ -0,0 +1,59 @@
+#include "MultiOutputEncoder.h"
+
+MultiOutputEncoder::MultiOutputEncoder()
+    : EncoderInterface()
+{
+}
+
+MultiOutputEncoder::~MultiOutputEncoder(){
+}
+
+void MultiOutputEncoder::SetOutputEncoders(std::vector<std::shared_ptr<EncoderInterface>> encoders)
+{
+    this->outputEncoders = std::move(encoders);
+}
+
+QString MultiOutputEncoder::GetCodecExtention() const
+{
+    QStringList extensions;
+    for(const auto& encoder : outputEncoders){
+        extensions << encoder->GetCodecExtention();
+    }
+    return extensions.join(",");
+}
+
+bool MultiOutputEncoder::Encode(QString inputPath, AudioMetaData metaData, int processNumber)
+{
+    if(outputEncoders.empty()){ return false; }
+    return EncoderInterface::Encode(std::move(inputPath), std::move(metaData), processNumber);
+}
+
+bool MultiOutputEncoder::EncodeBatch(const std::vector<EncodeBatchItem>& items)
+{
+    if(outputEncoders.empty()){ return false; }
+    return EncoderInterface::EncodeBatch(items);
+}
+
+void MultiOutputEncoder::AppendOutputArguments(QStringList& options, const AudioMetaData& metaData, int audioInput, int artworkInput, int processNumber) const
+{
+    //ffmpegのオプションは直後の出力ファイルに掛かるため、出力毎に並べる
+    for(const auto& encoder : outputEncoders){
+        options << encoder->GetOutputOptions(metaData, audioInput, artworkInput);
+        options << encoder->GetOutputFilePath(metaData, processNumber);
+    }
+}
+
+QStringList MultiOutputEncoder::GetOutputFilePaths(const AudioMetaData& metaData, int processNumber) const
+{
+    QStringList paths;
+    for(const auto& encoder : outputEncoders){
+        paths << encoder->GetOutputFilePath(metaData, processNumber);
+    }
+    return paths;
+}
+
+QStringList MultiOutputEncoder::GetOutputOptions(const AudioMetaData&, int, int) const
+{
+    //出力毎のオプションは出力パスと対でAppendOutputArgumentsが組み立てる
+    return {};
+}
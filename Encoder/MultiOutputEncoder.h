@@ -0,0 +1,39 @@
+#ifndef MULTIOUTPUTENCODER_H
+#define MULTIOUTPUTENCODER_H
+
+#include "EncoderInterface.h"
+
+#include <memory>
+#include <vector>
+
+//1曲につきffmpegを1回だけ起動し、登録したエンコーダー全ての出力をまとめて書き出す
+//各出力のオプションは登録したエンコーダーのGetOutputOptionsをそのまま使う
+class MultiOutputEncoder : public EncoderInterface
+{
+    Q_OBJECT
+public:
+    MultiOutputEncoder();
+    ~MultiOutputEncoder() override;
+
+    void SetOutputEncoders(std::vector<std::shared_ptr<EncoderInterface>> encoders);
+    const std::vector<std::shared_ptr<EncoderInterface>>& GetOutputEncoders() const { return outputEncoders; }
+
+    bool Encode(QString inputPath, AudioMetaData metaData, int processNumber) override;
+    bool EncodeBatch(const std::vector<EncodeBatchItem>& items) override;
+    QStringList GetOutputFilePaths(const AudioMetaData& metaData, int processNumber) const override;
+
+    QStringList GetOutputOptions(const AudioMetaData& metaData, int audioInput, int artworkInput) const override;
+
+    QString GetEncoderFileName() const override { return "ffmpeg"; }
+    QString GetCodecExtention() const override;
+    QString GetCodecName() const override { return "fan-out"; }
+
+protected:
+    //入力(音源・アートワーク)は1回だけ読み込み、デコード結果を各出力で共有する
+    void AppendOutputArguments(QStringList& options, const AudioMetaData& metaData, int audioInput, int artworkInput, int processNumber) const override;
+
+private:
+    std::vector<std::shared_ptr<EncoderInterface>> outputEncoders;
+};
+
+#endif // MULTIOUTPUTENCODER_H
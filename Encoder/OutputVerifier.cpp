@@ -0,0 +1,212 @@
+#include "OutputVerifier.h"
+
+#include "PcmReader.h"
+#include "WaveFile.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    //MD5を求める時に1回に渡す大きさ
+    constexpr qint64 md5ChunkBytes = 1 << 20;
+
+    struct Decoded
+    {
+        QString error;          //空の場合は最後までデコードできた
+        int sampleRate = 0;
+        qint64 numSamples = 0;
+    };
+
+    //framecrcで最初の音声ストリームをデコードし、フレームの長さを足してサンプル数を求める
+    //PCMをパイプで受け取らずに済み、デコードのエラーは-v errorで標準エラーに出る
+    Decoded Decode(const QString& ffmpegPath, const QString& filePath)
+    {
+        Decoded result;
+        QProcess process;
+        process.start(ffmpegPath, {"-hide_banner", "-nostdin", "-nostats", "-v", "error", "-i", filePath,
+                                   "-map", "0:a:0", "-c:a", "pcm_s16le", "-f", "framecrc", "-"});
+        if(process.waitForStarted() == false){
+            result.error = "can't start ffmpeg";
+            return result;
+        }
+        if(process.waitForFinished(OutputVerifier::decodeTimeoutMs) == false)
+        {
+            process.kill();
+            process.waitForFinished();
+            result.error = "decoding timed out";
+            return result;
+        }
+        const QString errors = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+        if(process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0 || errors.isEmpty() == false)
+        {
+            result.error = errors.isEmpty() ? QString("ffmpeg exited with code %1").arg(process.exitCode()) : errors.section('\n', 0, 0);
+            return result;
+        }
+
+        //"#tb 0: 1/44100" "#sample_rate 0: 44100" の後に "0, dts, pts, duration, size, crc" が並ぶ
+        qint64 timeBaseNum = 1;
+        qint64 timeBaseDen = 0;
+        qint64 duration = 0;
+        for(const QByteArray& line : process.readAllStandardOutput().split('\n'))
+        {
+            if(line.startsWith("#tb 0:"))
+            {
+                const QList<QByteArray> ratio = line.mid(6).trimmed().split('/');
+                if(ratio.size() == 2){
+                    timeBaseNum = ratio[0].toLongLong();
+                    timeBaseDen = ratio[1].toLongLong();
+                }
+            }
+            else if(line.startsWith("#sample_rate 0:")){
+                result.sampleRate = line.mid(15).trimmed().toInt();
+            }
+            else if(line.startsWith('#') == false)
+            {
+                const QList<QByteArray> fields = line.split(',');
+                if(fields.size() >= 4 && fields[0].trimmed() == "0"){
+                    duration += fields[3].trimmed().toLongLong();
+                }
+            }
+        }
+        //古いffmpegは#sample_rateを出さないが、音声のタイムベースは1/サンプリング周波数になる
+        if(result.sampleRate == 0 && timeBaseNum == 1){ result.sampleRate = int(timeBaseDen); }
+        if(timeBaseDen > 0 && result.sampleRate > 0){
+            result.numSamples = std::llround(double(duration) * timeBaseNum * result.sampleRate / timeBaseDen);
+        }
+        return result;
+    }
+}
+
+namespace OutputVerifier
+{
+
+Result Verify(const QString& sourcePath, const QStringList& outputPaths, const QString& ffmpegPath)
+{
+    Result result;
+    const auto Fail = [&result](const QString& outputPath, const QString& message){
+        result.isPassed = false;
+        result.messages << QFileInfo(outputPath).fileName() + " : " + message;
+    };
+
+    WaveFile::Info source;
+    const bool hasSource = WaveFile::ReadInfo(sourcePath, source) && source.sampleRate > 0;
+    const qint64 sourceFrames = hasSource ? source.GetNumSamples() : 0;
+    QByteArray sourceMd5;
+
+    for(const auto& outputPath : outputPaths)
+    {
+        if(QFileInfo(outputPath).size() <= 0){
+            Fail(outputPath, "output is missing or empty");
+            continue;
+        }
+
+        if(ffmpegPath.isEmpty() == false)
+        {
+            const Decoded decoded = Decode(ffmpegPath, outputPath);
+            if(decoded.error.isEmpty() == false){
+                Fail(outputPath, "decode error : " + decoded.error);
+                continue;
+            }
+            if(hasSource && decoded.sampleRate > 0)
+            {
+                //サンプリング周波数を変えた出力は、元の長さを出力の周波数に直して比べ、変換の誤差に10ms見込む
+                const qint64 expected = std::llround(double(sourceFrames) * decoded.sampleRate / source.sampleRate);
+                qint64 tolerance = GetSampleTolerance(outputPath);
+                if(decoded.sampleRate != source.sampleRate){ tolerance += decoded.sampleRate / 100; }
+                if(std::abs(decoded.numSamples - expected) > tolerance){
+                    Fail(outputPath, QString("decoded %1 samples, expected %2 (tolerance %3)").arg(decoded.numSamples).arg(expected).arg(tolerance));
+                }
+            }
+        }
+
+        if(hasSource == false || QFileInfo(outputPath).suffix().compare("flac", Qt::CaseInsensitive) != 0){ continue; }
+        const FlacStreamInfo info = ReadFlacStreamInfo(outputPath);
+        if(info.isValid == false){
+            Fail(outputPath, "no STREAMINFO");
+            continue;
+        }
+        if(info.sampleRate == source.sampleRate && info.totalSamples > 0 && info.totalSamples != sourceFrames){
+            Fail(outputPath, QString("STREAMINFO has %1 samples, source has %2").arg(info.totalSamples).arg(sourceFrames));
+        }
+        //ビット深度・チャンネル数を変えた場合と、MD5が書かれていない場合は比べられない
+        const bool isSameFormat = info.sampleRate == source.sampleRate && info.numChannels == source.numChannels
+                               && info.bitsPerSample == source.bitsPerSample && source.validBitsPerSample == source.bitsPerSample;
+        if(isSameFormat == false || info.md5 == QByteArray(16, '\0')){ continue; }
+        if(sourceMd5.isEmpty()){
+            sourceMd5 = ComputePcmMd5(sourcePath);
+        }
+        if(sourceMd5.isEmpty() == false && sourceMd5 != info.md5){
+            Fail(outputPath, "MD5 of the decoded audio does not match the source");
+        }
+    }
+    return result;
+}
+
+qint64 GetSampleTolerance(const QString& outputPath)
+{
+    const QString suffix = QFileInfo(outputPath).suffix().toLower();
+    //AACは1024サンプルのフレーム 先頭の遅延(1024〜2112)と最後のフレームの詰め物
+    if(suffix == "m4a" || suffix == "mp4" || suffix == "aac"){ return 2112 + 1024; }
+    //MP3は1152サンプルのフレーム LAMEの遅延(576 + デコーダー529)と最後の詰め物 ギャップレス情報が無い場合も含める
+    if(suffix == "mp3"){ return 576 + 529 + 1152 * 2; }
+    return 0;
+}
+
+FlacStreamInfo ReadFlacStreamInfo(const QString& filePath)
+{
+    FlacStreamInfo info;
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return info; }
+    //"fLaC"の直後は必ずSTREAMINFO(種類0・34バイト)
+    const QByteArray header = file.read(4 + 4 + 34);
+    if(header.size() < 42 || header.startsWith("fLaC") == false){ return info; }
+    const auto* p = reinterpret_cast<const uchar*>(header.constData()) + 4;
+    const int blockSize = (p[1] << 16) | (p[2] << 8) | p[3];
+    if((p[0] & 0x7F) != 0 || blockSize != 34){ return info; }
+
+    //最小・最大ブロック(16bit x2)、最小・最大フレーム(24bit x2)の後に
+    //サンプリング周波数20bit、チャンネル数-1 3bit、ビット深度-1 5bit、総サンプル数36bit、MD5 128bit
+    const uchar* s = p + 4;
+    info.sampleRate = (s[10] << 12) | (s[11] << 4) | (s[12] >> 4);
+    info.numChannels = ((s[12] >> 1) & 0x07) + 1;
+    info.bitsPerSample = (((s[12] & 0x01) << 4) | (s[13] >> 4)) + 1;
+    info.totalSamples = (qint64(s[13] & 0x0F) << 32) | (qint64(s[14]) << 24) | (qint64(s[15]) << 16) | (qint64(s[16]) << 8) | qint64(s[17]);
+    info.md5 = QByteArray(reinterpret_cast<const char*>(s + 18), 16);
+    info.isValid = true;
+    return info;
+}
+
+QByteArray ComputePcmMd5(const QString& sourcePath)
+{
+    PcmReader reader;
+    if(reader.Open(sourcePath) == false || reader.GetInfo().formatTag != WaveFile::formatPcm){ return QByteArray(); }
+
+    //wavの整数PCMは8bit以外はFLACのMD5と同じ並びなので、メモリマップしたdataチャンクをそのまま渡す
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    const uchar* data = reader.GetRawData();
+    const qint64 size = reader.GetNumFrames() * reader.GetInfo().blockAlign;
+    const bool isUnsigned = (reader.GetInfo().bitsPerSample == 8);
+    QByteArray block;
+    for(qint64 offset=0; data != nullptr && offset<size; offset+=md5ChunkBytes)
+    {
+        const qint64 length = std::min(md5ChunkBytes, size - offset);
+        const char* chunk = reinterpret_cast<const char*>(data + offset);
+        if(isUnsigned == false){
+            hash.addData(QByteArrayView(chunk, length));
+            continue;
+        }
+        //8bitだけは符号無しなので、符号付きに直してから
+        block = QByteArray(chunk, length);
+        for(char& sample : block){ sample = char(uchar(sample) ^ 0x80); }
+        hash.addData(block);
+    }
+    return hash.result();
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef OUTPUTVERIFIER_H
+#define OUTPUTVERIFIER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+//エンコードした出力を検査する
+//ffmpegで最後までデコードできるか、サンプル数が元のwavと合っているかを確かめ、
+//flacはSTREAMINFOのMD5を元のPCMから求めたMD5と比べる
+namespace OutputVerifier
+{
+    //1ファイルのデコードを待つ上限
+    static constexpr int decodeTimeoutMs = 10 * 60 * 1000;
+
+    struct Result
+    {
+        bool isPassed = true;
+        QStringList messages;   //見つかった問題 "ファイル名 : 内容"
+    };
+
+    struct FlacStreamInfo
+    {
+        bool isValid = false;
+        int sampleRate = 0;
+        int numChannels = 0;
+        int bitsPerSample = 0;
+        qint64 totalSamples = 0;    //0は不明
+        QByteArray md5;             //全て0の場合は書かれていない
+    };
+
+    //1つのジョブの出力をまとめて検査する ワーカースレッドから呼ぶ
+    //ffmpegPathが空の場合はデコードの検査を行わない
+    Result Verify(const QString& sourcePath, const QStringList& outputPaths, const QString& ffmpegPath);
+
+    //エンコーダーの遅延と最後のフレームの詰め物で増えてよいサンプル数 拡張子で判断し、可逆圧縮は0
+    qint64 GetSampleTolerance(const QString& outputPath);
+
+    FlacStreamInfo ReadFlacStreamInfo(const QString& filePath);
+    //元のwavのPCMを、FLACのMD5と同じ形(符号付き整数・リトルエンディアン・インターリーブ)で求める
+    //整数PCM以外・読めない場合は空
+    QByteArray ComputePcmMd5(const QString& sourcePath);
+}
+
+#endif // OUTPUTVERIFIER_H
@@ -0,0 +1,122 @@
+#include "PcmReader.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+    //チャンネルを分けながら変換する 形式ごとにループを分け、内側は単純な掛け算だけにする
+    template<class Convert>
+    void Deinterleave(const uchar* source, int numChannels, int bytesPerSample, qint64 frames,
+                      std::vector<std::vector<float>>& channels, Convert convert)
+    {
+        const qint64 stride = qint64(numChannels) * bytesPerSample;
+        for(int ch=0; ch<numChannels; ++ch)
+        {
+            float* out = channels[ch].data();
+            const uchar* in = source + qint64(ch) * bytesPerSample;
+            for(qint64 i=0; i<frames; ++i, in += stride){
+                out[i] = convert(in);
+            }
+        }
+    }
+}
+
+PcmReader::PcmReader()
+    : data(nullptr)
+    , numFrames(0)
+    , position(0)
+    , bytesPerSample(0)
+    , isFloat(false)
+{
+}
+
+PcmReader::~PcmReader(){
+}
+
+bool PcmReader::Open(const QString& filePath)
+{
+    this->Close();
+    if(WaveFile::ReadInfo(filePath, this->info) == false){ return false; }
+    if(this->info.numChannels <= 0 || this->info.sampleRate <= 0){ return false; }
+
+    this->bytesPerSample = this->info.bitsPerSample / 8;
+    this->isFloat = (this->info.formatTag == WaveFile::formatFloat);
+    if(this->isFloat){
+        if(this->bytesPerSample != 4 && this->bytesPerSample != 8){ return false; }
+    }
+    else if(this->info.formatTag != WaveFile::formatPcm || this->bytesPerSample < 1 || this->bytesPerSample > 4){
+        return false;
+    }
+    if(this->info.blockAlign != this->info.numChannels * this->bytesPerSample){ return false; }
+
+    this->file.setFileName(filePath);
+    if(this->file.open(QFile::ReadOnly) == false){ return false; }
+    this->numFrames = this->info.GetNumSamples();
+    if(this->numFrames > 0)
+    {
+        this->data = this->file.map(this->info.dataOffset, this->numFrames * this->info.blockAlign);
+        if(this->data == nullptr){
+            this->Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PcmReader::Close()
+{
+    if(this->data != nullptr){
+        this->file.unmap(this->data);
+        this->data = nullptr;
+    }
+    this->file.close();
+    this->numFrames = 0;
+    this->position = 0;
+}
+
+qint64 PcmReader::Read(std::vector<std::vector<float>>& channels, qint64 frames)
+{
+    frames = std::min(frames, this->numFrames - this->position);
+    if(frames <= 0 || this->data == nullptr){ return 0; }
+
+    const int numChannels = this->info.numChannels;
+    if(int(channels.size()) < numChannels){ channels.resize(numChannels); }
+    for(int ch=0; ch<numChannels; ++ch){
+        if(qint64(channels[ch].size()) < frames){ channels[ch].resize(frames); }
+    }
+
+    const uchar* source = this->data + this->position * this->info.blockAlign;
+    if(this->isFloat && this->bytesPerSample == 4){
+        Deinterleave(source, numChannels, 4, frames, channels, [](const uchar* p){ return qFromLittleEndian<float>(p); });
+    }
+    else if(this->isFloat){
+        Deinterleave(source, numChannels, 8, frames, channels, [](const uchar* p){ return float(qFromLittleEndian<double>(p)); });
+    }
+    else
+    {
+        switch(this->bytesPerSample)
+        {
+        case 1:
+            //8bitだけは符号無し
+            Deinterleave(source, numChannels, 1, frames, channels, [](const uchar* p){ return (int(p[0]) - 128) * (1.0f / 128.0f); });
+            break;
+        case 2:
+            Deinterleave(source, numChannels, 2, frames, channels, [](const uchar* p){ return qFromLittleEndian<qint16>(p) * (1.0f / 32768.0f); });
+            break;
+        case 3:
+            Deinterleave(source, numChannels, 3, frames, channels, [](const uchar* p){
+                //上位に詰めて算術シフトで符号を広げる
+                const qint32 value = qint32(quint32(p[0]) << 8 | quint32(p[1]) << 16 | quint32(p[2]) << 24) >> 8;
+                return value * (1.0f / 8388608.0f);
+            });
+            break;
+        default:
+            Deinterleave(source, numChannels, 4, frames, channels, [](const uchar* p){ return float(qFromLittleEndian<qint32>(p) * (1.0 / 2147483648.0)); });
+            break;
+        }
+    }
+    this->position += frames;
+    return frames;
+}
@@ -0,0 +1,47 @@
+#ifndef PCMREADER_H
+#define PCMREADER_H
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+#include "WaveFile.h"
+
+//wavのPCMデータをメモリマップし、チャンネルごとのfloat(-1〜1)に変換しながら先頭から順に読む
+//ファイル全体を読み込まないので、長い曲でも使うメモリは1回に読む分だけで済む
+class PcmReader
+{
+public:
+    //1回のReadで変換するフレーム数の目安
+    static constexpr qint64 blockFrames = 16384;
+
+    PcmReader();
+    ~PcmReader();
+
+    //8/16/24/32bit整数・32/64bit浮動小数点以外はfalse
+    bool Open(const QString& filePath);
+    void Close();
+
+    const WaveFile::Info& GetInfo() const { return info; }
+    int GetNumChannels() const { return info.numChannels; }
+    int GetSampleRate() const { return info.sampleRate; }
+    qint64 GetNumFrames() const { return numFrames; }
+    qint64 GetPosition() const { return position; }
+    //変換前のdataチャンク(GetNumFrames() * blockAlignバイト) 長さ0の場合はnullptr
+    const uchar* GetRawData() const { return data; }
+
+    //最大framesフレームを読み、channels[ch]の先頭から書き込む channelsの大きさは必要に応じて広げる
+    //読んだフレーム数を返す 終端では0
+    qint64 Read(std::vector<std::vector<float>>& channels, qint64 frames = blockFrames);
+
+private:
+    QFile file;
+    WaveFile::Info info;
+    uchar* data;
+    qint64 numFrames;
+    qint64 position;
+    int bytesPerSample;
+    bool isFloat;
+};
+
+#endif // PCMREADER_H
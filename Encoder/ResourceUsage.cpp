@@ -0,0 +1,144 @@
+#include "ResourceUsage.h"
+
+#include <QByteArray>
+#include <QFile>
+
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(Q_OS_MACOS)
+#include <libproc.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#endif
+
+namespace
+{
+#if defined(Q_OS_WIN)
+    //FILETIMEは100ナノ秒単位
+    double FileTimeToSeconds(const FILETIME& time)
+    {
+        const quint64 value = (quint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return double(value) / 1e7;
+    }
+#endif
+
+#if defined(Q_OS_MACOS)
+    double MachTimeToSeconds(quint64 time)
+    {
+        static const mach_timebase_info_data_t timebase = []{
+            mach_timebase_info_data_t info{};
+            mach_timebase_info(&info);
+            return info;
+        }();
+        return double(time) * timebase.numer / timebase.denom / 1e9;
+    }
+#endif
+}
+
+namespace ResourceUsage
+{
+
+bool ReadProcess(qint64 pid, Usage& usage)
+{
+    if(pid <= 0){ return false; }
+#if defined(Q_OS_LINUX)
+    QFile statFile(QString("/proc/%1/stat").arg(pid));
+    if(statFile.open(QFile::ReadOnly) == false){ return false; }
+    const QByteArray stat = statFile.readAll();
+    //コマンド名は括弧や空白を含むことがあるので、最後の')'より後ろを分割する
+    const auto fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if(fields.size() < 13){ return false; }
+    static const double ticksPerSecond = double(::sysconf(_SC_CLK_TCK));
+    //フィールド3(state)から数えるので、utime(14)・stime(15)は11番目・12番目
+    usage.userSeconds = fields[11].toLongLong() / ticksPerSecond;
+    usage.systemSeconds = fields[12].toLongLong() / ticksPerSecond;
+
+    //VmHWMはカーネルが記録している最大常駐サイズなので、終了直前に読めれば十分
+    QFile statusFile(QString("/proc/%1/status").arg(pid));
+    if(statusFile.open(QFile::ReadOnly))
+    {
+        for(const auto& line : statusFile.readAll().split('\n'))
+        {
+            if(line.startsWith("VmHWM:")){
+                usage.peakRssBytes = line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+                break;
+            }
+        }
+    }
+    return true;
+#elif defined(Q_OS_MACOS)
+    rusage_info_v4 info{};
+    if(::proc_pid_rusage(int(pid), RUSAGE_INFO_V4, reinterpret_cast<rusage_info_t*>(&info)) != 0){
+        return false;
+    }
+    usage.userSeconds = MachTimeToSeconds(info.ri_user_time);
+    usage.systemSeconds = MachTimeToSeconds(info.ri_system_time);
+    usage.peakRssBytes = qint64(info.ri_lifetime_max_phys_footprint);
+    return true;
+#elif defined(Q_OS_WIN)
+    HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+    if(process == nullptr){ return false; }
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    const bool isSucceeded = ::GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime) != FALSE;
+    if(isSucceeded)
+    {
+        usage.userSeconds = FileTimeToSeconds(userTime);
+        usage.systemSeconds = FileTimeToSeconds(kernelTime);
+        PROCESS_MEMORY_COUNTERS counters{};
+        if(::K32GetProcessMemoryInfo(process, &counters, sizeof(counters))){
+            usage.peakRssBytes = qint64(counters.PeakWorkingSetSize);
+        }
+    }
+    ::CloseHandle(process);
+    return isSucceeded;
+#else
+    Q_UNUSED(usage);
+    return false;
+#endif
+}
+
+Usage ReadCurrentThread()
+{
+    Usage usage;
+#if defined(Q_OS_LINUX)
+    struct rusage threadUsage{};
+    if(::getrusage(RUSAGE_THREAD, &threadUsage) == 0){
+        usage.userSeconds = threadUsage.ru_utime.tv_sec + threadUsage.ru_utime.tv_usec / 1e6;
+        usage.systemSeconds = threadUsage.ru_stime.tv_sec + threadUsage.ru_stime.tv_usec / 1e6;
+    }
+#elif defined(Q_OS_MACOS)
+    const mach_port_t thread = ::mach_thread_self();
+    thread_basic_info_data_t info{};
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if(::thread_info(thread, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count) == KERN_SUCCESS){
+        usage.userSeconds = info.user_time.seconds + info.user_time.microseconds / 1e6;
+        usage.systemSeconds = info.system_time.seconds + info.system_time.microseconds / 1e6;
+    }
+    ::mach_port_deallocate(::mach_task_self(), thread);
+#elif defined(Q_OS_WIN)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if(::GetThreadTimes(::GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)){
+        usage.userSeconds = FileTimeToSeconds(userTime);
+        usage.systemSeconds = FileTimeToSeconds(kernelTime);
+    }
+#endif
+    return usage;
+}
+
+Usage Difference(const Usage& begin, const Usage& end)
+{
+    Usage usage;
+    usage.userSeconds = std::max(end.userSeconds - begin.userSeconds, 0.0);
+    usage.systemSeconds = std::max(end.systemSeconds - begin.systemSeconds, 0.0);
+    usage.peakRssBytes = end.peakRssBytes;
+    return usage;
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef RESOURCEUSAGE_H
+#define RESOURCEUSAGE_H
+
+#include <QtGlobal>
+
+//エンコーダーのプロセス(またはプロセス内エンコードのスレッド)が使ったCPU時間とメモリ
+namespace ResourceUsage
+{
+    struct Usage
+    {
+        double userSeconds = 0.0;
+        double systemSeconds = 0.0;
+        qint64 peakRssBytes = -1;   //取得できない場合は-1
+
+        double GetCpuSeconds() const { return userSeconds + systemSeconds; }
+    };
+
+    //実行中のプロセスの累計値を読む 終了して回収されたプロセスは読めないのでfalse
+    //Linuxは/proc/<pid>/stat・status(VmHWM)、macOSはproc_pid_rusage、WindowsはGetProcessTimes・GetProcessMemoryInfo
+    bool ReadProcess(qint64 pid, Usage& usage);
+
+    //呼び出したスレッドの累計CPU時間 peakRssBytesは-1
+    Usage ReadCurrentThread();
+
+    //beginからendまでに使ったCPU時間 peakRssBytesはendの値
+    Usage Difference(const Usage& begin, const Usage& end);
+}
+
+#endif // RESOURCEUSAGE_H
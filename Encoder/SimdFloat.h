@@ -0,0 +1,92 @@
+#ifndef SIMDFLOAT_H
+#define SIMDFLOAT_H
+
+#include <algorithm>
+#include <cmath>
+
+//floatを4つまとめて計算する SSE2・NEONが使えない環境では配列で計算する
+//PCMの解析(K特性フィルター・オーバーサンプリング・ピーク・クリップ検出)で使う
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENCODEUTILITY_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define ENCODEUTILITY_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+struct Float4
+{
+#if defined(ENCODEUTILITY_SIMD_SSE2)
+    __m128 v;
+
+    static Float4 Zero(){ return {_mm_setzero_ps()}; }
+    static Float4 Set1(float x){ return {_mm_set1_ps(x)}; }
+    static Float4 Set(float x0, float x1, float x2, float x3){ return {_mm_setr_ps(x0, x1, x2, x3)}; }
+    static Float4 Load(const float* p){ return {_mm_loadu_ps(p)}; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b){ return {_mm_add_ps(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b){ return {_mm_sub_ps(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b){ return {_mm_mul_ps(a.v, b.v)}; }
+    friend Float4 Min(Float4 a, Float4 b){ return {_mm_min_ps(a.v, b.v)}; }
+    friend Float4 Max(Float4 a, Float4 b){ return {_mm_max_ps(a.v, b.v)}; }
+    friend Float4 Abs(Float4 a){ return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+    //threshold以上の要素のビットを立てる(要素kがビットk)
+    int MaskAtLeast(Float4 threshold) const { return _mm_movemask_ps(_mm_cmpge_ps(v, threshold.v)); }
+#elif defined(ENCODEUTILITY_SIMD_NEON)
+    float32x4_t v;
+
+    static Float4 Zero(){ return {vdupq_n_f32(0.0f)}; }
+    static Float4 Set1(float x){ return {vdupq_n_f32(x)}; }
+    static Float4 Set(float x0, float x1, float x2, float x3){ const float p[4] = {x0, x1, x2, x3}; return Load(p); }
+    static Float4 Load(const float* p){ return {vld1q_f32(p)}; }
+    void Store(float* p) const { vst1q_f32(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b){ return {vaddq_f32(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b){ return {vsubq_f32(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b){ return {vmulq_f32(a.v, b.v)}; }
+    friend Float4 Min(Float4 a, Float4 b){ return {vminq_f32(a.v, b.v)}; }
+    friend Float4 Max(Float4 a, Float4 b){ return {vmaxq_f32(a.v, b.v)}; }
+    friend Float4 Abs(Float4 a){ return {vabsq_f32(a.v)}; }
+    int MaskAtLeast(Float4 threshold) const {
+        //比較結果は要素ごとに全ビット1か0なので、要素ごとの重みと論理積を取って足す
+        static const uint32_t bits[4] = {1, 2, 4, 8};
+        const uint32x4_t mask = vandq_u32(vcgeq_f32(v, threshold.v), vld1q_u32(bits));
+        const uint32x2_t pair = vadd_u32(vget_low_u32(mask), vget_high_u32(mask));
+        return int(vget_lane_u32(vpadd_u32(pair, pair), 0));
+    }
+#else
+    float v[4];
+
+    static Float4 Zero(){ return Set1(0.0f); }
+    static Float4 Set1(float x){ return {{x, x, x, x}}; }
+    static Float4 Set(float x0, float x1, float x2, float x3){ return {{x0, x1, x2, x3}}; }
+    static Float4 Load(const float* p){ return {{p[0], p[1], p[2], p[3]}}; }
+    void Store(float* p) const { std::copy_n(v, 4, p); }
+
+    template<class Op>
+    static Float4 Apply(const Float4& a, const Float4& b, Op op){
+        return {{op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3])}};
+    }
+    friend Float4 operator+(Float4 a, Float4 b){ return Apply(a, b, [](float x, float y){ return x + y; }); }
+    friend Float4 operator-(Float4 a, Float4 b){ return Apply(a, b, [](float x, float y){ return x - y; }); }
+    friend Float4 operator*(Float4 a, Float4 b){ return Apply(a, b, [](float x, float y){ return x * y; }); }
+    friend Float4 Min(Float4 a, Float4 b){ return Apply(a, b, [](float x, float y){ return std::min(x, y); }); }
+    friend Float4 Max(Float4 a, Float4 b){ return Apply(a, b, [](float x, float y){ return std::max(x, y); }); }
+    friend Float4 Abs(Float4 a){ return {{std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3])}}; }
+    int MaskAtLeast(Float4 threshold) const {
+        int mask = 0;
+        for(int k=0; k<4; ++k){
+            if(v[k] >= threshold.v[k]){ mask |= 1 << k; }
+        }
+        return mask;
+    }
+#endif
+
+    //要素をまとめる ブロックの終わりなどで時々呼ぶだけなので、取り出してから計算する
+    float Sum() const { float p[4]; Store(p); return (p[0] + p[1]) + (p[2] + p[3]); }
+    float MaxElement() const { float p[4]; Store(p); return std::max(std::max(p[0], p[1]), std::max(p[2], p[3])); }
+    float MinElement() const { float p[4]; Store(p); return std::min(std::min(p[0], p[1]), std::min(p[2], p[3])); }
+};
+
+#endif // SIMDFLOAT_H
@@ -0,0 +1,67 @@
+#include "TruePeakFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+const TruePeakFilter::Coefficients& TruePeakFilter::GetCoefficients()
+{
+    //窓関数を掛けたsincを位相ごとに分け、各位相の合計を1にする 要素k(0〜3)が位相kの係数
+    static const Coefficients coefficients = []()
+    {
+        constexpr double pi = 3.14159265358979323846;
+        constexpr int length = taps * oversampling;
+        double phases[oversampling][taps];
+        for(int n=0; n<length; ++n)
+        {
+            const double x = (n - (length - 1) / 2.0) / oversampling;
+            const double sinc = std::sin(pi * x) / (pi * x);
+            const double window = 0.5 - 0.5 * std::cos(2.0 * pi * (n + 0.5) / length);
+            phases[n % oversampling][n / oversampling] = sinc * window;
+        }
+        for(auto& phase : phases)
+        {
+            double sum = 0.0;
+            for(double value : phase){ sum += value; }
+            for(double& value : phase){ value /= sum; }
+        }
+        Coefficients result;
+        for(int k=0; k<taps; ++k){
+            result[k] = Float4::Set(float(phases[0][k]), float(phases[1][k]), float(phases[2][k]), float(phases[3][k]));
+        }
+        return result;
+    }();
+    return coefficients;
+}
+
+void TruePeakFilter::Push(float x)
+{
+    this->position = (this->position == 0 ? taps : this->position) - 1;
+    this->history[this->position] = x;
+    this->history[this->position + taps] = x;
+}
+
+void TruePeakFilter::Process(const float* samples, qint64 frames)
+{
+    const auto& filter = GetCoefficients();
+    Float4 result = this->peak;
+    for(qint64 i=0; i<frames; ++i)
+    {
+        const float x = samples[i];
+        this->Push(x);
+        const float* past = this->history.data() + this->position;
+        Float4 y = Float4::Zero();
+        for(int k=0; k<taps; ++k){
+            y = y + filter[k] * Float4::Set1(past[k]);
+        }
+        result = Max(result, Max(Abs(y), Abs(Float4::Set1(x))));
+    }
+    this->peak = result;
+}
+
+void TruePeakFilter::Skip(const float* samples, qint64 frames)
+{
+    //次に補間する時に要るのは直前のtapsサンプルだけ
+    for(qint64 i=std::max<qint64>(0, frames - taps); i<frames; ++i){
+        this->Push(samples[i]);
+    }
+}
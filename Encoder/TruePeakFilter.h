@@ -0,0 +1,34 @@
+#ifndef TRUEPEAKFILTER_H
+#define TRUEPEAKFILTER_H
+
+#include <QtGlobal>
+#include <array>
+
+#include "SimdFloat.h"
+
+//4倍オーバーサンプリングでサンプル間のピーク(トゥルーピーク)を求める 1チャンネルに1つ使う
+//補間フィルターは位相ごとに分けてあり、入力1サンプルにつき4位相の補間値をFloat4でまとめて求める
+class TruePeakFilter
+{
+public:
+    static constexpr int oversampling = 4;
+    static constexpr int taps = 12;     //1位相あたりのタップ数
+
+    void Process(const float* samples, qint64 frames);
+    //補間せずに履歴だけを進める ピークに届かないと分かっている区間を飛ばす時に使う
+    void Skip(const float* samples, qint64 frames);
+    //補間値と元のサンプルの絶対値の最大 リニア
+    float GetPeak() const { return peak.MaxElement(); }
+
+private:
+    using Coefficients = std::array<Float4, taps>;
+    static const Coefficients& GetCoefficients();
+    void Push(float x);
+
+    //同じ値を2回書いておき、リングバッファを折り返さずに読む history[position + k]がkサンプル前
+    std::array<float, taps * 2> history{};
+    int position = 0;
+    Float4 peak = Float4::Zero();
+};
+
+#endif // TRUEPEAKFILTER_H
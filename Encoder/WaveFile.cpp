@@ -0,0 +1,271 @@
+#include "WaveFile.h"
+
+#include <QFile>
+#include <QStringDecoder>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+    constexpr quint32 sizePlaceholder = 0xFFFFFFFF;    //RF64で実際のサイズはds64にある
+
+    //マップした範囲を越えずに読むためのカーソル
+    struct Span
+    {
+        const uchar* data = nullptr;
+        qint64 size = 0;
+
+        bool Contains(qint64 offset, qint64 length) const {
+            return offset >= 0 && length >= 0 && offset <= size && length <= size - offset;
+        }
+        quint16 U16(qint64 offset) const { return qFromLittleEndian<quint16>(data + offset); }
+        quint32 U32(qint64 offset) const { return qFromLittleEndian<quint32>(data + offset); }
+        quint64 U64(qint64 offset) const { return qFromLittleEndian<quint64>(data + offset); }
+        bool IsId(qint64 offset, const char* id) const { return std::equal(id, id + 4, reinterpret_cast<const char*>(data + offset)); }
+    };
+
+    //NUL終端・NUL埋めの文字列 UTF-8として正しくなければ古いWindowsのツールに多いローカルの文字コードとみなす
+    QString DecodeText(const uchar* data, qint64 size)
+    {
+        const auto* text = reinterpret_cast<const char*>(data);
+        const qint64 length = std::find(text, text + size, '\0') - text;
+        QStringDecoder decoder(QStringDecoder::Utf8);
+        QString result = decoder.decode(QByteArrayView(text, length));
+        if(decoder.hasError()){
+            result = QString::fromLocal8Bit(text, length);
+        }
+        return result.trimmed();
+    }
+
+    void ReadInfoList(const Span& span, qint64 offset, qint64 size, WaveFile::Tags& tags)
+    {
+        qint64 pos = offset;
+        while(pos + 8 <= offset + size)
+        {
+            const quint32 length = span.U32(pos + 4);
+            if(span.Contains(pos + 8, length) == false){ break; }
+            const QString text = DecodeText(span.data + pos + 8, length);
+
+            if(span.IsId(pos, "INAM")){ tags.title = text; }
+            else if(span.IsId(pos, "IART")){ tags.artist = text; }
+            else if(span.IsId(pos, "IPRD")){ tags.albumTitle = text; }
+            else if(span.IsId(pos, "IGNR")){ tags.genre = text; }
+            else if(span.IsId(pos, "ICRD")){ tags.year = text.left(4); }
+            else if(span.IsId(pos, "ITRK") || span.IsId(pos, "IPRT")){ tags.trackNo = text; }
+            else if(span.IsId(pos, "ICMT")){ tags.comment = text; }
+            else if(span.IsId(pos, "IMUS") || span.IsId(pos, "ICMP")){ tags.composer = text; }
+            pos += 8 + length + (length & 1);
+        }
+    }
+
+    //ID3v2のテキストフレーム 先頭1バイトが文字コード
+    QString DecodeId3Text(const uchar* data, qint64 size)
+    {
+        if(size < 1){ return QString(); }
+        const auto* text = reinterpret_cast<const char*>(data + 1);
+        const qint64 length = size - 1;
+        QString result;
+        switch(data[0])
+        {
+        case 0:  result = QString::fromLatin1(text, length); break;
+        case 1:  result = QStringDecoder(QStringDecoder::Utf16, QStringDecoder::Flag::ConvertInitialBom)(QByteArrayView(text, length)); break;
+        case 2:  result = QStringDecoder(QStringDecoder::Utf16BE)(QByteArrayView(text, length)); break;
+        default: result = QString::fromUtf8(text, length); break;
+        }
+        //複数の値はNULで区切られるので最初の値だけを使う
+        return result.section(QChar('\0'), 0, 0).trimmed();
+    }
+
+    quint32 SyncSafe(const uchar* data){
+        return (quint32(data[0] & 0x7F) << 21) | (quint32(data[1] & 0x7F) << 14) | (quint32(data[2] & 0x7F) << 7) | quint32(data[3] & 0x7F);
+    }
+
+    //ID3v2.3/2.4のうち、テーブルの列に対応するフレームだけを読む 非同期化されたタグは読まない
+    void ReadId3(const uchar* data, qint64 size, WaveFile::Tags& tags)
+    {
+        if(size < 10 || std::equal(data, data + 3, "ID3") == false){ return; }
+        const int version = data[3];
+        const int flags = data[5];
+        if((version != 3 && version != 4) || (flags & 0x80)){ return; }
+
+        const qint64 end = std::min<qint64>(10 + SyncSafe(data + 6), size);
+        qint64 pos = 10;
+        if(flags & 0x40){
+            if(pos + 4 > end){ return; }
+            //拡張ヘッダー v2.3はサイズ自身を含まない
+            pos += (version == 4) ? SyncSafe(data + pos) : qFromBigEndian<quint32>(data + pos) + 4;
+        }
+        while(pos + 10 <= end && data[pos] != 0)
+        {
+            const QByteArray id(reinterpret_cast<const char*>(data + pos), 4);
+            const qint64 length = (version == 4) ? SyncSafe(data + pos + 4) : qFromBigEndian<quint32>(data + pos + 4);
+            if(length <= 0 || pos + 10 + length > end){ break; }
+            const uchar* frame = data + pos + 10;
+
+            if(id == "TIT2"){ tags.title = DecodeId3Text(frame, length); }
+            else if(id == "TPE1"){ tags.artist = DecodeId3Text(frame, length); }
+            else if(id == "TALB"){ tags.albumTitle = DecodeId3Text(frame, length); }
+            else if(id == "TPE2"){ tags.albumArtist = DecodeId3Text(frame, length); }
+            else if(id == "TCON"){ tags.genre = DecodeId3Text(frame, length); }
+            else if(id == "TCOM"){ tags.composer = DecodeId3Text(frame, length); }
+            else if(id == "TIT1" || id == "GRP1"){ tags.group = DecodeId3Text(frame, length); }
+            else if(id == "TYER" || id == "TDRC"){ tags.year = DecodeId3Text(frame, length).left(4); }
+            else if(id == "TRCK"){ tags.trackNo = DecodeId3Text(frame, length).section('/', 0, 0); }
+            pos += 10 + length;
+        }
+    }
+
+    //空でない項目だけを上書きする
+    void MergeTags(WaveFile::Tags& base, const WaveFile::Tags& overlay)
+    {
+        auto Merge = [](QString& to, const QString& from){ if(from.isEmpty() == false){ to = from; } };
+        Merge(base.title, overlay.title);
+        Merge(base.artist, overlay.artist);
+        Merge(base.albumTitle, overlay.albumTitle);
+        Merge(base.albumArtist, overlay.albumArtist);
+        Merge(base.genre, overlay.genre);
+        Merge(base.composer, overlay.composer);
+        Merge(base.group, overlay.group);
+        Merge(base.year, overlay.year);
+        Merge(base.trackNo, overlay.trackNo);
+        Merge(base.comment, overlay.comment);
+    }
+}
+
+namespace WaveFile
+{
+
+bool Tags::IsEmpty() const
+{
+    return title.isEmpty() && artist.isEmpty() && albumTitle.isEmpty() && albumArtist.isEmpty() && genre.isEmpty()
+        && composer.isEmpty() && group.isEmpty() && year.isEmpty() && trackNo.isEmpty() && comment.isEmpty();
+}
+
+QString Info::GetFormatText() const
+{
+    const int bits = validBitsPerSample > 0 ? validBitsPerSample : bitsPerSample;
+    switch(formatTag)
+    {
+    case formatPcm:     return QString("%1bit PCM").arg(bits);
+    case formatFloat:   return QString("%1bit float").arg(bits);
+    default:            return QString("%1bit (0x%2)").arg(bits).arg(formatTag, 4, 16, QChar('0'));
+    }
+}
+
+bool ReadInfo(const QString& filePath, Info& info)
+{
+    info = Info();
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+
+    //マップしても触ったページしか読み込まれないので、ヘッダーと末尾のタグだけがディスクから読まれる
+    Span span;
+    span.size = file.size();
+    if(span.size < 12){ return false; }
+    span.data = file.map(0, span.size);
+    if(span.data == nullptr){ return false; }
+
+    if(span.IsId(0, "RF64") || span.IsId(0, "BW64")){
+        info.isRf64 = true;
+    }
+    else if(span.IsId(0, "RIFF") == false){
+        return false;
+    }
+    if(span.IsId(8, "WAVE") == false){ return false; }
+
+    bool hasFormat = false;
+    bool hasData = false;
+    quint64 rf64DataSize = 0;
+    Tags infoTags;
+    Tags id3Tags;
+    qint64 pos = 12;
+    while(span.Contains(pos, 8))
+    {
+        const quint32 size32 = span.U32(pos + 4);
+        const qint64 body = pos + 8;
+        qint64 size = size32;
+
+        if(span.IsId(pos, "ds64") && span.Contains(body, 24))
+        {
+            rf64DataSize = span.U64(body + 8);
+        }
+        else if(span.IsId(pos, "fmt ") && span.Contains(body, 16))
+        {
+            info.formatTag     = span.U16(body);
+            info.numChannels   = span.U16(body + 2);
+            info.sampleRate    = int(span.U32(body + 4));
+            info.blockAlign    = span.U16(body + 12);
+            info.bitsPerSample = span.U16(body + 14);
+            info.validBitsPerSample = info.bitsPerSample;
+            //EXTENSIBLEはSubFormat(GUID)の先頭2バイトが実際のフォーマット
+            if(info.formatTag == formatExtensible && size >= 40 && span.Contains(body, 40))
+            {
+                if(span.U16(body + 18) > 0){
+                    info.validBitsPerSample = span.U16(body + 18);
+                }
+                info.formatTag = span.U16(body + 24);
+            }
+            hasFormat = true;
+        }
+        else if(span.IsId(pos, "data"))
+        {
+            if(info.isRf64 && size32 == sizePlaceholder){
+                size = qint64(rf64DataSize);
+            }
+            //書き込み途中のファイルなどでサイズが実際より大きい場合は、ファイル末尾までとする
+            info.dataOffset = body;
+            info.dataSize = std::min(size, span.size - body);
+            hasData = true;
+        }
+        else if(span.IsId(pos, "LIST") && span.Contains(body, 4) && span.IsId(body, "INFO"))
+        {
+            ReadInfoList(span, body + 4, std::min(size - 4, span.size - body - 4), infoTags);
+        }
+        else if(span.IsId(pos, "bext") && span.Contains(body, 346))
+        {
+            info.bextDescription = DecodeText(span.data + body, 256);
+            info.bextOriginator = DecodeText(span.data + body + 256, 32);
+            info.bextOriginationDate = DecodeText(span.data + body + 320, 10);
+            info.bextTimeReference = span.U64(body + 338);
+        }
+        else if(span.IsId(pos, "id3 ") || span.IsId(pos, "ID3 "))
+        {
+            ReadId3(span.data + body, std::min(size, span.size - body), id3Tags);
+        }
+
+        pos = body + size + (size & 1);
+    }
+
+    info.tags = infoTags;
+    MergeTags(info.tags, id3Tags);
+    return hasFormat && hasData;
+}
+
+double GetDurationSeconds(const QString& filePath)
+{
+    Info info;
+    return ReadInfo(filePath, info) ? info.GetDurationSeconds() : 0.0;
+}
+
+QByteArray MakeHeader(const Info& info)
+{
+    QByteArray header(44, '\0');
+    char* data = header.data();
+    const auto blockAlign = quint16(info.blockAlign > 0 ? info.blockAlign : info.numChannels * (info.bitsPerSample / 8));
+    std::copy_n("RIFF", 4, data);
+    qToLittleEndian<quint32>(quint32(36 + info.dataSize), data + 4);
+    std::copy_n("WAVEfmt ", 8, data + 8);
+    qToLittleEndian<quint32>(16, data + 16);
+    qToLittleEndian<quint16>(quint16(info.formatTag > 0 ? info.formatTag : formatPcm), data + 20);
+    qToLittleEndian<quint16>(quint16(info.numChannels), data + 22);
+    qToLittleEndian<quint32>(quint32(info.sampleRate), data + 24);
+    qToLittleEndian<quint32>(quint32(info.sampleRate) * blockAlign, data + 28);
+    qToLittleEndian<quint16>(blockAlign, data + 32);
+    qToLittleEndian<quint16>(quint16(info.bitsPerSample), data + 34);
+    std::copy_n("data", 4, data + 36);
+    qToLittleEndian<quint32>(quint32(info.dataSize), data + 40);
+    return header;
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef WAVEFILE_H
+#define WAVEFILE_H
+
+#include <QByteArray>
+#include <QString>
+
+//wavファイルのチャンク(fmt・data・LIST/INFO・bext・id3、RF64のds64)を読む
+//ファイルはメモリマップして辿るだけなので、PCMデータは読み込まない
+namespace WaveFile
+{
+    //LIST/INFOまたはid3チャンクに埋め込まれたタグ
+    struct Tags
+    {
+        QString title;
+        QString artist;
+        QString albumTitle;
+        QString albumArtist;
+        QString genre;
+        QString composer;
+        QString group;
+        QString year;
+        QString trackNo;
+        QString comment;
+
+        bool IsEmpty() const;
+    };
+
+    struct Info
+    {
+        int formatTag = 0;          //WAVE_FORMAT_EXTENSIBLEの場合はSubFormatの値
+        int numChannels = 0;
+        int sampleRate = 0;
+        int bitsPerSample = 0;
+        int validBitsPerSample = 0; //EXTENSIBLEで指定されていない場合はbitsPerSampleと同じ
+        int blockAlign = 0;
+        qint64 dataOffset = 0;      //PCMデータの先頭位置
+        qint64 dataSize = 0;
+        bool isRf64 = false;        //4GBを超えるRF64/BW64
+
+        Tags tags;                  //両方ある場合はid3を優先する
+
+        //bextチャンク(Broadcast Wave)
+        QString bextDescription;
+        QString bextOriginator;
+        QString bextOriginationDate;
+        quint64 bextTimeReference = 0;  //日付の0時からのサンプル数
+
+        qint64 GetNumSamples() const { return blockAlign > 0 ? dataSize / blockAlign : 0; }
+        double GetDurationSeconds() const { return sampleRate > 0 ? double(GetNumSamples()) / sampleRate : 0.0; }
+        //"24bit PCM"・"32bit float"など
+        QString GetFormatText() const;
+    };
+
+    static constexpr int formatPcm = 0x0001;
+    static constexpr int formatFloat = 0x0003;
+    static constexpr int formatExtensible = 0xFFFE;
+
+    //RIFF(RF64)/WAVEでない、またはfmt・dataチャンクが無い場合はfalse
+    bool ReadInfo(const QString& filePath, Info& info);
+
+    //長さ(秒) 読めない場合は0
+    double GetDurationSeconds(const QString& filePath);
+
+    //infoの内容で44バイトのPCM wavヘッダーを作る 続けてdataSize分のサンプルを書けばwavになる
+    QByteArray MakeHeader(const Info& info);
+}
+
+#endif // WAVEFILE_H
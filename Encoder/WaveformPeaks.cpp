@@ -0,0 +1,153 @@
+#include "WaveformPeaks.h"
+
+#include "PcmReader.h"
+#include "SimdFloat.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    //キャッシュの先頭に付ける 形式を変えた場合は番号を上げ、古いキャッシュを使わないようにする
+    const QByteArray cacheMagic = QByteArrayLiteral("EUWF1");
+    //キャッシュのファイル名を作る時に1回に読む大きさ
+    constexpr qint64 keyChunkBytes = 1024 * 1024;
+
+    //4サンプルずつ最小・最大を取る 端数は同じ値を4つ並べて同じ計算で済ませる
+    void AccumulateMinMax(const float* samples, qint64 count, Float4& low, Float4& high)
+    {
+        qint64 i = 0;
+        for(; i+4<=count; i+=4)
+        {
+            const Float4 x = Float4::Load(samples + i);
+            low = Min(low, x);
+            high = Max(high, x);
+        }
+        for(; i<count; ++i)
+        {
+            const Float4 x = Float4::Set1(samples[i]);
+            low = Min(low, x);
+            high = Max(high, x);
+        }
+    }
+
+    char Quantize(float value){
+        return char(qint8(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f)));
+    }
+}
+
+namespace WaveformPeaks
+{
+
+QByteArray Compute(const QString& filePath, const std::atomic_bool* isCanceled)
+{
+    PcmReader reader;
+    if(reader.Open(filePath) == false){ return QByteArray(); }
+    const int numChannels = reader.GetNumChannels();
+    const qint64 numFrames = reader.GetNumFrames();
+
+    //フレーム数がビンより少ない曲は、中身の無いビンが0のまま残る
+    QByteArray peaks(numBins * 2, 0);
+    const auto BinEnd = [numFrames](int bin){ return qint64(bin + 1) * numFrames / numBins; };
+    int bin = 0;
+    qint64 binEnd = BinEnd(0);
+    //0から始めて、波形の中心線が必ず入るようにする
+    Float4 low = Float4::Zero();
+    Float4 high = Float4::Zero();
+
+    std::vector<std::vector<float>> channels;
+    qint64 position = 0;
+    while(bin < numBins)
+    {
+        if(isCanceled != nullptr && isCanceled->load()){ return QByteArray(); }
+        const qint64 frames = reader.Read(channels);
+        if(frames <= 0){ break; }
+
+        qint64 begin = 0;
+        while(begin < frames && bin < numBins)
+        {
+            const qint64 end = std::min(frames, binEnd - position);
+            for(int ch=0; ch<numChannels; ++ch){
+                AccumulateMinMax(channels[ch].data() + begin, end - begin, low, high);
+            }
+            begin = end;
+
+            //ブロックの途中でビンが終わったら書き出して次のビンへ
+            while(bin < numBins && position + begin >= binEnd)
+            {
+                peaks[bin * 2] = Quantize(low.MinElement());
+                peaks[bin * 2 + 1] = Quantize(high.MaxElement());
+                low = Float4::Zero();
+                high = Float4::Zero();
+                binEnd = BinEnd(++bin);
+            }
+        }
+        position += frames;
+    }
+    return peaks;
+}
+
+QByteArray Get(const QString& filePath, const std::atomic_bool* isCanceled)
+{
+    const QString key = MakeCacheKey(filePath, isCanceled);
+    const QString cachePath = key.isEmpty() ? QString() : GetCacheFolder() + "/" + key + ".peaks";
+    if(cachePath.isEmpty() == false)
+    {
+        QFile cache(cachePath);
+        if(cache.open(QFile::ReadOnly))
+        {
+            const QByteArray data = cache.readAll();
+            if(data.startsWith(cacheMagic) && data.size() == cacheMagic.size() + numBins * 2){
+                return data.mid(cacheMagic.size());
+            }
+        }
+    }
+
+    const QByteArray peaks = Compute(filePath, isCanceled);
+    if(peaks.isEmpty() || cachePath.isEmpty()){ return peaks; }
+
+    //保存できなくても表示はできるので、失敗は無視する
+    QDir().mkpath(GetCacheFolder());
+    QSaveFile output(cachePath);
+    if(output.open(QFile::WriteOnly))
+    {
+        output.write(cacheMagic);
+        output.write(peaks);
+        output.commit();
+    }
+    return peaks;
+}
+
+QString MakeCacheKey(const QString& filePath, const std::atomic_bool* isCanceled)
+{
+    QFile file(filePath);
+    if(QFileInfo(filePath).isFile() == false || file.open(QFile::ReadOnly) == false){ return QString(); }
+
+    //内容だけから作るので、途中のサンプルだけを書き換えた場合も作り直し、コピーや更新日時の変更では作り直さない
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(file.size()));
+    while(file.atEnd() == false)
+    {
+        if(isCanceled && *isCanceled){ return QString(); }
+        const QByteArray chunk = file.read(keyChunkBytes);
+        if(chunk.isEmpty()){ return QString(); }
+        hash.addData(chunk);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString GetCacheFolder()
+{
+    static const QString folder = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/waveforms";
+    return folder;
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef WAVEFORMPEAKS_H
+#define WAVEFORMPEAKS_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+//テーブルに表示する波形の縮小データ 曲全体をnumBins個に分け、全チャンネルの最小・最大を取る
+//値は-127〜127のqint8で、ビンごとに最小・最大の順に並べる(numBins * 2バイト)
+//一度作ったものはキャッシュフォルダーに保存し、同じファイルなら次からは読むだけで済ませる
+namespace WaveformPeaks
+{
+    static constexpr int numBins = 256;
+
+    //キャッシュを使わずに元のwavから作る 読めない形式・中止された場合は空
+    QByteArray Compute(const QString& filePath, const std::atomic_bool* isCanceled = nullptr);
+    //キャッシュがあればそれを返し、無ければComputeして保存する
+    QByteArray Get(const QString& filePath, const std::atomic_bool* isCanceled = nullptr);
+
+    //キャッシュのファイル名 ファイル全体の内容のハッシュ 読めない・中止された場合は空
+    //波形を作るよりずっと軽いので、数百曲のプロジェクトを開いてもすぐに表示できる
+    QString MakeCacheKey(const QString& filePath, const std::atomic_bool* isCanceled = nullptr);
+    QString GetCacheFolder();
+}
+
+#endif // WAVEFORMPEAKS_H
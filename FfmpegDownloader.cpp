@@ -0,0 +1,329 @@
+#include "FfmpegDownloader.h"
+
+#include <QDir>
+#include <QFutureWatcher>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include "quazip/quazip.h"
+#include "quazip/quazipfile.h"
+
+FfmpegDownloader::FfmpegDownloader(const QUrl& zipUrl, const QUrl& hashUrl, QObject* parent)
+    : QObject(parent)
+    , zipUrl(zipUrl)
+    , hashUrl(hashUrl)
+    , zipPath(QDir::tempPath() + "/encodeutility-ffmpeg.zip")
+    , hash(std::make_shared<QCryptographicHash>(QCryptographicHash::Sha256))
+    , resumeOffset(0)
+    , isCheckedResponse(false)
+    , isCanceled(false)
+{
+}
+
+FfmpegDownloader::~FfmpegDownloader()
+{
+    if(this->reply){
+        this->reply->abort();
+    }
+}
+
+void FfmpegDownloader::Start(const QString& destinationDir)
+{
+    this->destinationDir = destinationDir;
+    this->isCanceled = false;
+    this->errorString.clear();
+
+    //ハッシュ値のテキストファイル "<16進> *<ファイル名>" の形式の場合もあるので先頭だけを使う
+    this->reply = this->manager.get(QNetworkRequest(this->hashUrl));
+    connect(this->reply, &QNetworkReply::finished, this, [this, hashReply = this->reply]()
+    {
+        hashReply->deleteLater();
+        if(this->isCanceled){
+            this->Finish(Result::Canceled);
+            return;
+        }
+        if(hashReply->error() != QNetworkReply::NoError){
+            this->Finish(Result::NetworkError, hashReply->errorString());
+            return;
+        }
+        this->expectedHash = QString::fromLatin1(hashReply->readAll()).trimmed().section(QRegularExpression("\\s+"), 0, 0).toLower().toLatin1();
+        static const QRegularExpression sha256Pattern("^[0-9a-f]{64}$");
+        if(sha256Pattern.match(QString::fromLatin1(this->expectedHash)).hasMatch() == false){
+            this->Finish(Result::NetworkError, tr("Invalid hash file : %1").arg(this->hashUrl.toString()));
+            return;
+        }
+
+        //前回ダウンロードして検証済みのzipがあればそのまま使う
+        if(QFile::exists(this->zipPath) == false){
+            this->StartDownload();
+            return;
+        }
+        auto* watcher = new QFutureWatcher<QByteArray>(this);
+        connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher]()
+        {
+            watcher->deleteLater();
+            if(this->isCanceled){
+                this->Finish(Result::Canceled);
+                return;
+            }
+            if(watcher->result() == this->expectedHash){
+                this->VerifyAndExtract();
+            }
+            else{
+                this->StartDownload();
+            }
+        });
+        watcher->setFuture(QtConcurrent::run(HashFile, this->zipPath));
+    });
+}
+
+void FfmpegDownloader::Cancel()
+{
+    this->isCanceled = true;
+    if(this->reply){
+        this->reply->abort();
+    }
+}
+
+void FfmpegDownloader::StartDownload()
+{
+    //前回の続きから受け取る 受け取り済みの分は別スレッドで先にハッシュへ入れておく
+    using PartHash = std::pair<std::shared_ptr<QCryptographicHash>, qint64>;
+    auto* watcher = new QFutureWatcher<PartHash>(this);
+    connect(watcher, &QFutureWatcher<PartHash>::finished, this, [this, watcher]()
+    {
+        watcher->deleteLater();
+        if(this->isCanceled){
+            this->Finish(Result::Canceled);
+            return;
+        }
+        std::tie(this->hash, this->resumeOffset) = watcher->result();
+        this->RequestZip();
+    });
+    watcher->setFuture(QtConcurrent::run([partPath = this->GetPartPath()]()
+    {
+        auto hash = std::make_shared<QCryptographicHash>(QCryptographicHash::Sha256);
+        QFile file(partPath);
+        if(file.exists() && file.open(QFile::ReadOnly))
+        {
+            if(hash->addData(&file)){
+                return PartHash(hash, file.size());
+            }
+            hash->reset();
+        }
+        return PartHash(hash, 0);
+    }));
+}
+
+void FfmpegDownloader::RequestZip()
+{
+    this->isCheckedResponse = false;
+    this->partFile.setFileName(this->GetPartPath());
+    if(this->partFile.open(this->resumeOffset > 0 ? (QFile::WriteOnly | QFile::Append) : QFile::WriteOnly) == false){
+        this->Finish(Result::NetworkError, tr("Can't write %1").arg(this->partFile.fileName()));
+        return;
+    }
+
+    QNetworkRequest request(this->zipUrl);
+    if(this->resumeOffset > 0){
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(this->resumeOffset) + "-");
+    }
+    this->reply = this->manager.get(request);
+    //受け取ったデータはすぐファイルに書くので、メモリに溜まる量を抑える
+    this->reply->setReadBufferSize(readBufferSize);
+    connect(this->reply, &QNetworkReply::readyRead, this, &FfmpegDownloader::OnReadyRead);
+    connect(this->reply, &QNetworkReply::finished, this, &FfmpegDownloader::OnDownloadFinished);
+    connect(this->reply, &QNetworkReply::downloadProgress, this, [this](qint64 bytesReceived, qint64 bytesTotal){
+        emit this->downloadProgress(this->resumeOffset + bytesReceived, bytesTotal > 0 ? this->resumeOffset + bytesTotal : -1);
+    });
+}
+
+void FfmpegDownloader::OnReadyRead()
+{
+    const int status = this->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    //エラーの本文はファイルに書かない
+    if(status != 200 && status != 206){ return; }
+
+    if(this->isCheckedResponse == false)
+    {
+        this->isCheckedResponse = true;
+        if(this->resumeOffset > 0)
+        {
+            //Range非対応のサーバーは全体を返すので、最初から受け取り直す
+            static const QRegularExpression rangePattern("^bytes (\\d+)-");
+            const auto match = rangePattern.match(QString::fromLatin1(this->reply->rawHeader("Content-Range")));
+            if(status == 200 || match.hasMatch() == false || match.captured(1).toLongLong() != this->resumeOffset)
+            {
+                this->partFile.resize(0);
+                this->partFile.seek(0);
+                this->hash->reset();
+                this->resumeOffset = 0;
+                if(status == 206){
+                    //要求と違う範囲が返ってきた 続きとしては使えない
+                    this->errorString = tr("Unexpected Content-Range : %1").arg(QString::fromLatin1(this->reply->rawHeader("Content-Range")));
+                    this->reply->abort();
+                    return;
+                }
+            }
+        }
+    }
+
+    while(this->reply->bytesAvailable() > 0)
+    {
+        const QByteArray chunk = this->reply->read(chunkSize);
+        if(this->partFile.write(chunk) != chunk.size())
+        {
+            this->errorString = tr("Can't write %1").arg(this->partFile.fileName());
+            this->reply->abort();
+            return;
+        }
+        this->hash->addData(chunk);
+    }
+}
+
+void FfmpegDownloader::OnDownloadFinished()
+{
+    this->reply->deleteLater();
+    if(this->reply->error() == QNetworkReply::NoError){
+        this->OnReadyRead();
+    }
+    this->partFile.close();
+
+    const int status = this->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if(this->isCanceled){
+        //受け取った分は次回の続きに使う
+        this->Finish(Result::Canceled);
+        return;
+    }
+    if(this->errorString.isEmpty() == false){
+        this->Finish(Result::NetworkError, this->errorString);
+        return;
+    }
+    //416は受け取り済みの分で全体が揃っている場合 ハッシュで確かめる
+    if(this->reply->error() != QNetworkReply::NoError && status != 416){
+        this->Finish(Result::NetworkError, this->reply->errorString());
+        return;
+    }
+
+    const QByteArray actualHash = this->hash->result().toHex();
+    if(actualHash != this->expectedHash)
+    {
+        QFile::remove(this->GetPartPath());
+        this->Finish(Result::HashMismatch, tr("SHA-256 mismatch : expected %1, got %2")
+                     .arg(QString::fromLatin1(this->expectedHash), QString::fromLatin1(actualHash)));
+        return;
+    }
+    QFile::remove(this->zipPath);
+    if(QFile::rename(this->GetPartPath(), this->zipPath) == false){
+        this->Finish(Result::NetworkError, tr("Can't rename %1").arg(this->GetPartPath()));
+        return;
+    }
+    this->VerifyAndExtract();
+}
+
+void FfmpegDownloader::VerifyAndExtract()
+{
+    //展開はGUIスレッドを止めないよう別スレッドで行う 進捗はキュー接続でこのオブジェクトのスレッドに届く
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher]()
+    {
+        watcher->deleteLater();
+        const QString error = watcher->result();
+        if(error.isEmpty()){
+            this->Finish(Result::Succeeded);
+        }
+        else{
+            this->Finish(Result::ExtractError, error);
+        }
+    });
+    const QString zipPath = this->zipPath;
+    const QString outputPath = QDir(this->destinationDir).absoluteFilePath(executableName);
+    //展開中にこのオブジェクトが破棄された場合は進捗を送らない
+    watcher->setFuture(QtConcurrent::run([self = QPointer<FfmpegDownloader>(this), zipPath, outputPath]()
+    {
+        QString error;
+        ExtractFile(zipPath, executableName, outputPath, &error, [self](qint64 written, qint64 total){
+            if(self){
+                emit self->extractProgress(written, total);
+            }
+        });
+        return error;
+    }));
+}
+
+void FfmpegDownloader::Finish(Result result, const QString& error)
+{
+    this->errorString = error;
+    emit this->finished(result);
+}
+
+bool FfmpegDownloader::ExtractFile(const QString& zipPath, const QString& name, const QString& outputPath, QString* errorString,
+                                   const std::function<void(qint64, qint64)>& progress)
+{
+    auto Fail = [errorString](const QString& error){
+        if(errorString){ *errorString = error; }
+        return false;
+    };
+
+    QuaZip zip(zipPath);
+    if(zip.open(QuaZip::mdUnzip) == false){
+        return Fail(tr("Error opening the zip file : %1").arg(zipPath));
+    }
+    QString nameInZip;
+    for(const auto& fileName : zip.getFileNameList())
+    {
+        if(fileName.contains(name)){
+            nameInZip = fileName;
+            break;
+        }
+    }
+    if(nameInZip.isEmpty() || zip.setCurrentFile(nameInZip) == false){
+        return Fail(tr("Not found %1 in zip").arg(name));
+    }
+
+    QuaZipFile fileInsideZip(&zip);
+    if(fileInsideZip.open(QIODevice::ReadOnly) == false){
+        return Fail(tr("Can't open %1 in zip").arg(nameInZip));
+    }
+    QSaveFile outputFile(outputPath);
+    if(outputFile.open(QIODevice::WriteOnly) == false){
+        return Fail(tr("Can't write %1").arg(outputPath));
+    }
+
+    const qint64 total = fileInsideZip.usize();
+    QByteArray buffer(chunkSize, Qt::Uninitialized);
+    qint64 written = 0;
+    while(true)
+    {
+        const qint64 size = fileInsideZip.read(buffer.data(), buffer.size());
+        if(size < 0){
+            return Fail(tr("Can't read %1 in zip").arg(nameInZip));
+        }
+        if(size == 0){ break; }
+        if(outputFile.write(buffer.constData(), size) != size){
+            return Fail(tr("Can't write %1").arg(outputPath));
+        }
+        written += size;
+        if(progress){ progress(written, total); }
+    }
+    //閉じる時にCRCを確かめる
+    fileInsideZip.close();
+    if(fileInsideZip.getZipError() != UNZ_OK){
+        return Fail(tr("CRC error in %1").arg(nameInZip));
+    }
+    if(outputFile.commit() == false){
+        return Fail(tr("Can't write %1").arg(outputPath));
+    }
+    return true;
+}
+
+QByteArray FfmpegDownloader::HashFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return QByteArray(); }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if(hash.addData(&file) == false){ return QByteArray(); }
+    return hash.result().toHex();
+}
@@ -0,0 +1,88 @@
+#ifndef FFMPEGDOWNLOADER_H
+#define FFMPEGDOWNLOADER_H
+
+#include <QObject>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QUrl>
+#include <functional>
+#include <memory>
+
+class QNetworkReply;
+
+//ffmpegのzipをダウンロードし、ffmpeg.exeを取り出す
+//zipは受け取ったチャンクごとに一時ファイルへ書き、同時にSHA-256を計算する
+//既にあるファイルのハッシュは別スレッドで計算し、GUIスレッドを止めない
+//途中で止まった場合は一時ファイルを残し、次回はRangeで続きから受け取る
+//URLは差し替えられるので、ローカルのHTTPサーバーに向けて動作を確認できる
+class FfmpegDownloader : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Result
+    {
+        Succeeded,
+        Canceled,
+        NetworkError,
+        HashMismatch,
+        ExtractError,
+    };
+
+    static constexpr char defaultZipUrl[] = "https://www.gyan.dev/ffmpeg/builds/ffmpeg-release-essentials.zip";
+    static constexpr char defaultHashUrl[] = "https://www.gyan.dev/ffmpeg/builds/ffmpeg-release-essentials.zip.sha256";
+    static constexpr char executableName[] = "ffmpeg.exe";
+    static constexpr qint64 readBufferSize = 4 * 1024 * 1024;   //ネットワークから受け取って溜めておく上限
+    static constexpr qint64 chunkSize = 1024 * 1024;        //ダウンロード・展開で1回に読み書きする大きさ
+
+    FfmpegDownloader(const QUrl& zipUrl, const QUrl& hashUrl, QObject* parent = nullptr);
+    ~FfmpegDownloader() override;
+
+    //zipの保存先 省略時は一時フォルダ ダウンロード中は末尾に".part"を付けたファイルに書く
+    void SetZipPath(const QString& path) { zipPath = path; }
+    QString GetZipPath() const { return zipPath; }
+
+    //destinationDirにffmpeg.exeを置く 終わるとfinishedを発行する
+    void Start(const QString& destinationDir);
+    void Cancel();
+    QString GetErrorString() const { return errorString; }
+
+    //zip内で名前にnameを含む最初のファイルを、一定の大きさのバッファで書き出す
+    //書き込みは一時ファイルに行い、完了後に置き換える
+    static bool ExtractFile(const QString& zipPath, const QString& name, const QString& outputPath, QString* errorString = nullptr,
+                            const std::function<void(qint64, qint64)>& progress = {});
+    //ファイルのSHA-256を、全体を読み込まずに計算する
+    static QByteArray HashFile(const QString& filePath);
+
+signals:
+    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void extractProgress(qint64 bytesWritten, qint64 bytesTotal);
+    void finished(FfmpegDownloader::Result result);
+
+private:
+    void StartDownload();
+    void RequestZip();
+    void OnReadyRead();
+    void OnDownloadFinished();
+    void VerifyAndExtract();
+    void Finish(Result result, const QString& error = QString());
+    QString GetPartPath() const { return zipPath + ".part"; }
+
+    QUrl zipUrl;
+    QUrl hashUrl;
+    QString zipPath;
+    QString destinationDir;
+    QByteArray expectedHash;    //16進の小文字
+
+    QNetworkAccessManager manager;
+    QPointer<QNetworkReply> reply;
+    QFile partFile;
+    std::shared_ptr<QCryptographicHash> hash;
+    qint64 resumeOffset;
+    bool isCheckedResponse;
+    bool isCanceled;
+    QString errorString;
+};
+
+#endif // FFMPEGDOWNLOADER_H
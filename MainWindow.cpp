@@ -19,10 +19,21 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include "ProjectDefines.hpp"
+#include "ProjectFile.h"
+#include "EncodeLog.h"
+#include "MetadataTable.h"
+#include "TrackIngest.h"
+#include "TrackAnalysis.h"
+#include "SourceWatcher.h"
+#include "WaveformDelegate.h"
+#include "Undo/SetTextCommand.h"
+#include "Undo/RemoveRowsCommand.h"
 
 #include "Encoder/AACEncoder.h"
 #include "Encoder/MP3Encoder.h"
 #include "Encoder/FlacEncoder.h"
+#include "Encoder/ArtworkPreprocessor.h"
+#include "Encoder/EncodeReport.h"
 
 #include <QLabel>
 #include <QDropEvent>
@@ -36,37 +47,31 @@
 #include <QStandardPaths>
 #include <QPlainTextEdit>
 #include <QScrollBar>
+#include <QHeaderView>
 #include <QSettings>
 #include <QMessageBox>
 #include <QDesktopServices>
 #include <QTextStream>
 #include <QPainter>
 #include <QProgressDialog>
+#include <QProgressBar>
+#include <QImageReader>
+#include <QDateTime>
+#include <QtConcurrent>
 
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include "quazip/quazip.h"
-#include "quazip/quazipfile.h"
+#include "FfmpegDownloader.h"
 
 #include <QDebug>
 
-enum TableColumn
-{
-    TrackNo = 0,
-    Title,
-    Artist,
-    AlbumTitle,
-    AlbumArtist,
-    Composer,
-    Group,
-    Genre,
-    Year,
-    ALL
-};
+#include <cmath>
+#include <numeric>
+
+//アートワークのプレビューの大きさ
+constexpr int artworkPreviewSize = 128;
 
 bool downloadAndExtract(const QUrl &url, const QUrl &hashUrl, const QString &destinationDir)
 {
-    QNetworkAccessManager manager;
+    FfmpegDownloader downloader(url, hashUrl);
 
     // 進捗ダイアログの初期化
     QProgressDialog progressDialog;
@@ -75,155 +80,62 @@ bool downloadAndExtract(const QUrl &url, const QUrl &hashUrl, const QString &des
     progressDialog.setModal(true);
     progressDialog.show();
 
-    auto DownloadHash = [&](){
-        // 1. SHA-256ハッシュ値のテキストファイルをダウンロード。
-        QNetworkReply *hashReply = manager.get(QNetworkRequest(hashUrl));
-        QEventLoop hashLoop;
-        QObject::connect(hashReply, &QNetworkReply::finished, &hashLoop, &QEventLoop::quit);
-        hashLoop.exec();
-        QByteArray hashData = hashReply->readAll();
-        return QString(hashData).trimmed(); // 改行やスペースを取り除く
-    };
-
-    const auto zipHash = DownloadHash();
-
-    QString zipPath = QDir::tempPath() + "/encodeutility-ffmpeg.zip";
-#ifdef QT_DEBUG
-    if(QFile::exists(zipPath) == false)
-#endif
-    {
-        QNetworkReply *reply = manager.get(QNetworkRequest(url));
-
-        if (reply->error()) {
-            qDebug() << "Download error:" << reply->errorString();
-            return false;
-        }
-
-        QObject::connect(reply, &QNetworkReply::downloadProgress, [&](qint64 bytesReceived, qint64 bytesTotal) {
-            int progress = static_cast<int>(100.0 * bytesReceived / bytesTotal);
-            progressDialog.setValue(progress);
-            //ダウンロード完了後、自動でffmpeg.exeを配置します。
-            QString labelText = QObject::tr("downloading ffmpeg...\nAfter the download is complete, ffmpeg.exe will be placed automatically.\nDownloading: %1/%2 bytes").arg(bytesReceived).arg(bytesTotal);
-            progressDialog.setLabelText(labelText);
-        });
-
-        QEventLoop loop;  // ダウンロードが終わるまで待機するためのイベントループ
-        QObject::connect(&progressDialog, &QProgressDialog::canceled, [&]() {
-            reply->abort();
-            loop.quit();
-        });
-        QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-        loop.exec();
-
-        if(progressDialog.wasCanceled()){
-            qDebug() << "Download Canceled";
-            return false;
+    QObject::connect(&downloader, &FfmpegDownloader::downloadProgress, &progressDialog, [&](qint64 bytesReceived, qint64 bytesTotal) {
+        if(bytesTotal > 0){
+            progressDialog.setValue(static_cast<int>(100.0 * bytesReceived / bytesTotal));
         }
-
-        QByteArray zipData = reply->readAll();
-
-        // 3. ダウンロードしたZIPファイルのSHA-256ハッシュ値を計算。
-        QCryptographicHash hash(QCryptographicHash::Sha256);
-        hash.addData(zipData);
-        QString calculatedHash = hash.result().toHex();
-
-        // 4. ダウンロードしたハッシュ値テキストと計算されたハッシュ値を比較。
-        if (calculatedHash != zipHash) {
-            qDebug() << "Hash mismatch!";
-            return false;
+        //ダウンロード完了後、自動でffmpeg.exeを配置します。
+        QString labelText = QObject::tr("downloading ffmpeg...\nAfter the download is complete, ffmpeg.exe will be placed automatically.\nDownloading: %1/%2 bytes").arg(bytesReceived).arg(bytesTotal);
+        progressDialog.setLabelText(labelText);
+    });
+    QObject::connect(&downloader, &FfmpegDownloader::extractProgress, &progressDialog, [&](qint64 bytesWritten, qint64 bytesTotal) {
+        progressDialog.setLabelText(QObject::tr("Extracting..."));
+        if(bytesTotal > 0){
+            progressDialog.setValue(static_cast<int>(100.0 * bytesWritten / bytesTotal));
         }
+    });
 
-        QFile file(zipPath);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(zipData);
-            file.close();
-        }
-    }
-#ifdef QT_DEBUG
-    else
-    {
-        QFile file(zipPath);
-        if (file.open(QIODevice::ReadOnly)) {
-            QCryptographicHash hash(QCryptographicHash::Sha256);
-            hash.addData(file.readAll());
-            QString calculatedHash = hash.result().toHex();
-
-            // 4. ダウンロードしたハッシュ値テキストと計算されたハッシュ値を比較。
-            if (calculatedHash != zipHash) {
-                qDebug() << "Hash mismatch!";
-                return false;
-            }
-        }
-        else{
-            return true;
-        }
-    }
-#endif
+    QEventLoop loop;  // 展開が終わるまで待機するためのイベントループ
+    auto result = FfmpegDownloader::Result::Canceled;
+    QObject::connect(&progressDialog, &QProgressDialog::canceled, &downloader, &FfmpegDownloader::Cancel);
+    QObject::connect(&downloader, &FfmpegDownloader::finished, &loop, [&](FfmpegDownloader::Result finishResult) {
+        result = finishResult;
+        loop.quit();
+    });
+    downloader.Start(destinationDir);
+    loop.exec();
 
-    QuaZip zip(zipPath);
-    if (!zip.open(QuaZip::mdUnzip)) {
-        qDebug() << "Error opening the zip file";
-        progressDialog.setValue(100);
-        progressDialog.hide();
+    progressDialog.setValue(100);
+    progressDialog.hide();
+    if(result != FfmpegDownloader::Result::Succeeded){
+        qDebug() << "Download ffmpeg failed:" << downloader.GetErrorString();
         return false;
     }
+    return true;
+}
 
-    QString ffmpegExePath = "";
-    {
-        auto fileNameList = zip.getFileNameList();
-        for(const auto& name : fileNameList){
-            if(name.contains("ffmpeg.exe")){
-                ffmpegExePath = name;
-                break;
-            }
-        }
+
+bool MainWindow::CheckEncoder()
+{
+    //プロセス内エンコードではffmpegの実行ファイルを使わない
+    if(this->settings->IsInProcessEncode()){
+        return true;
     }
 
-    if(ffmpegExePath.isEmpty()){
-        qDebug() << "Not found ffmpeg.exe in zip";
-        progressDialog.setValue(100);
-        progressDialog.hide();
-        zip.close();
+    //確認中は出力のチェックを無効にしている 結果は確認が終わった時に反映する
+    if(this->encoderProbeWatcher->isRunning()){
         return false;
     }
-
-    progressDialog.setLabelText(QObject::tr("Extracting..."));
-    progressDialog.setValue(0);
-
-    QDir dir(destinationDir);
-    QuaZipFile fileInsideZip(zipPath, ffmpegExePath);
-
-    fileInsideZip.open(QIODevice::ReadOnly);
-    QByteArray fileData = fileInsideZip.readAll();
-    fileInsideZip.close();
-
-    QFile outputFile(dir.absoluteFilePath("ffmpeg.exe"));
-    if (outputFile.open(QIODevice::WriteOnly)) {
-        outputFile.write(fileData);
-        outputFile.close();
+    //設定のパスが変わっているか見つかっていなければ、別スレッドで調べ直す
+    if(this->probedFFmpegPath != this->settings->GetFFmpegPath() || this->encoderCapabilities.IsFound() == false){
+        this->ProbeEncoderAsync();
+        return false;
     }
-    progressDialog.setValue(100);
-    progressDialog.hide();
-
     return true;
 }
 
-
-bool MainWindow::CheckEncoder()
+bool MainWindow::RequestFFmpegDownload()
 {
-    auto CheckExistsRequiredFiles = [](){
-        bool hit = true;
-        QStringList requiredFiles = {
-            "ffmpeg.exe"
-        };
-        for(auto& url : requiredFiles){ hit &= QFile::exists(qApp->applicationDirPath()+"/"+url); }
-        return hit;
-    };
-
-    if(CheckExistsRequiredFiles()){
-        return true;
-    }
-
     QMessageBox msg(this);
     msg.setWindowTitle(tr("Not found ffmpeg"));
     msg.setTextFormat(Qt::RichText);
@@ -235,8 +147,10 @@ bool MainWindow::CheckEncoder()
     msg.setDefaultButton(QMessageBox::Yes);
     if(msg.exec() == QMessageBox::Yes)
     {
-        bool result = downloadAndExtract(QUrl("https://www.gyan.dev/ffmpeg/builds/ffmpeg-release-essentials.zip"),
-                                         QUrl("https://www.gyan.dev/ffmpeg/builds/ffmpeg-release-essentials.zip.sha256"),
+        //ダウンロード元は設定ファイルで差し替えられる(ローカルのHTTPサーバーでの確認用)
+        QSettings settingfile(ProjectDefines::settingFilePath, QSettings::IniFormat);
+        bool result = downloadAndExtract(QUrl(settingfile.value(ProjectDefines::settingFfmpegZipUrl, FfmpegDownloader::defaultZipUrl).toString()),
+                                         QUrl(settingfile.value(ProjectDefines::settingFfmpegHashUrl, FfmpegDownloader::defaultHashUrl).toString()),
                                          qApp->applicationDirPath());
 
         if(result == false)
@@ -260,33 +174,64 @@ bool MainWindow::CheckEncoder()
                 return false;
             }
         }
-
+        return true;
     }
 
-    if(CheckExistsRequiredFiles() == false){
-        //エンコードに必要なファイルが見つかりません。出力にチェックを入れたときに再度確認します。
-        QMessageBox::critical(this, tr("Not found ffmpeg"), tr("Cannot find file needed for encoding. Check again when output is checked."), QMessageBox::Ok);
-        return false;
+    //エンコードに必要なファイルが見つかりません。出力にチェックを入れたときに再度確認します。
+    QMessageBox::critical(this, tr("Not found ffmpeg"), tr("Cannot find file needed for encoding. Check again when output is checked."), QMessageBox::Ok);
+    return false;
+}
+
+void MainWindow::ShowEncoderInfo()
+{
+    //エンコーダーを正しく認識しています。
+    QString text = tr("The encoder is correctly identified.");
+    if(this->encoderCapabilities.IsFound())
+    {
+        text += "\n\n" + this->encoderCapabilities.ffmpegPath + "\n" + this->encoderCapabilities.version + "\n";
+        for(const QString name : {"aac", "libfdk_aac", "libmp3lame", "flac"}){
+            text += QString("\n%1 : %2").arg(name, this->encoderCapabilities.HasEncoder(name) ? tr("available") : tr("not available"));
+        }
     }
-    return true;
+    QMessageBox::information(this, tr("Check Encoder"), text);
 }
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , metadataTable(nullptr)
+    , undoStack(new QUndoStack(this))
+    , undoAction(nullptr)
+    , redoAction(nullptr)
     , aboutLabel(new QLabel(tr("drag&drop .wav files \n or \n jacket(.png or .jpg) file here."), this))
     , wavOutputPath("wav")
     , imageOutputPath("")
-    , processedCount(0)
     , numEncodingMusic(0)
     , numEncodingFile(0)
     , settings(new DialogAppSettings(this))
+    , encodeScheduler(new EncodeScheduler(this))
+    , wavCopyWatcher(new QFutureWatcher<FastFileCopy::Result>(this))
+    , trackIngest(new TrackIngest(this))
+    , trackAnalysis(new TrackAnalysis(this))
+    , isEncodeAfterAnalysis(false)
+    , artworkWatcher(new QFutureWatcher<QImage>(this))
+    , artworkPrepareWatcher(new QFutureWatcher<QString>(this))
+    , ingestProgress(new QProgressBar(this))
+    , ingestCancelButton(new QPushButton(tr("Cancel"), this))
+    , encodeCancelButton(new QPushButton(tr("Stop"), this))
+    , isEncodeCanceled(false)
+    , sourceWatcher(new SourceWatcher(this))
+    , encoderProbeWatcher(new QFutureWatcher<EncoderProbe::Capabilities>(this))
+    , encodeLog(nullptr)
+    , numJobsPerTrack(0)
     , widgetListDisableDuringEncode({})
     , lastLoadProject("")
     , currentWorkDirectory(QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)[0])
     , batchEntryWidget(new QWidget(this, Qt::Popup))
     , showAtFirst(true)
+    , isShowEncoderInfo(false)
+    , isProbeAfterDownload(false)
+    , multiOutputEncoder(std::make_shared<MultiOutputEncoder>())
 {
     QApplication::setStyle("fusion");
     //スタイルシートの設定
@@ -301,6 +246,18 @@ MainWindow::MainWindow(QWidget *parent)
     file.close();
 
     ui->setupUi(this);
+    this->encodeLog = new EncodeLog(this->ui->logWidget, this->ui->logChannel, this);
+    this->metadataTable = new MetadataTable(this);
+    this->ui->tableView->setModel(this->metadataTable);
+    this->ui->tableView->setItemDelegateForColumn(InfoColumn::Waveform, new WaveformDelegate(this));
+
+    //テーブルの編集の取り消し・やり直し
+    this->undoAction = this->undoStack->createUndoAction(this, tr("Undo"));
+    this->undoAction->setShortcut(QKeySequence::Undo);
+    this->redoAction = this->undoStack->createRedoAction(this, tr("Redo"));
+    this->redoAction->setShortcut(QKeySequence::Redo);
+    this->ui->menuEdit->insertActions(this->ui->actionClear_All_Items, {this->undoAction, this->redoAction});
+    this->ui->menuEdit->insertSeparator(this->ui->actionClear_All_Items);
 
     //this->ui->内のアドレスを使用するため、setUi後に行うこと。
     encoderComponents = {
@@ -315,7 +272,7 @@ MainWindow::MainWindow(QWidget *parent)
     projVer->setEnabled(false);
 
     widgetListDisableDuringEncode = {
-        this->ui->encodeButton, this->ui->tableWidget,
+        this->ui->encodeButton, this->ui->tableView,
         this->ui->outputWav,    this->ui->baseFolderWav,    this->ui->wavOutputPath,
         this->ui->includeImage, this->ui->baseFolderImage,  this->ui->imageOutputPath,
         this->ui->outputFolderPath,
@@ -329,7 +286,7 @@ MainWindow::MainWindow(QWidget *parent)
         widgetListDisableDuringEncode.emplace_back(component.outputPath);
     }
 
-    this->tableMenu = new QMenu(this->ui->tableWidget);
+    this->tableMenu = new QMenu(this->ui->tableView);
     this->artworkMenu = new QMenu(this->ui->artwork);
 
     this->aboutLabel->setAlignment(Qt::AlignCenter);
@@ -339,6 +296,149 @@ MainWindow::MainWindow(QWidget *parent)
     this->ui->tabWidget->setHidden(true);   //編集Widgetはこの時点で表示しない
     this->ui->artwork->setVisible(false);
 
+    //ドロップしたファイルの読み込み 進捗はステータスバーに出し、途中で止められる
+    this->ingestProgress->setMaximumWidth(200);
+    this->ingestProgress->setFormat("%v / %m");
+    this->ingestProgress->hide();
+    this->ingestCancelButton->hide();
+    this->ui->statusBar->addPermanentWidget(this->ingestProgress);
+    this->ui->statusBar->addPermanentWidget(this->ingestCancelButton);
+    connect(this->ingestCancelButton, &QPushButton::clicked, this->trackIngest, &TrackIngest::Cancel);
+
+    //エンコードの中止 待ち行列を破棄し、起動済みのエンコーダーが終わるのを待つ
+    this->encodeCancelButton->hide();
+    this->ui->statusBar->addPermanentWidget(this->encodeCancelButton);
+    connect(this->encodeCancelButton, &QPushButton::clicked, this, [this]()
+    {
+        this->isEncodeCanceled = true;
+        this->encodeCancelButton->setEnabled(false);
+        this->encodeScheduler->Cancel();
+        this->ui->statusBar->showMessage(tr("Stopping: waiting for running encoders to finish..."));
+        this->encodeLog->Append(tr("Stopped. Remaining tracks were not encoded.\n"));
+    });
+    connect(this->trackIngest, &TrackIngest::rowsReady, this, [this](const std::vector<MetadataTable::Row>& rows){
+        this->AppendTracks(rows);
+    });
+    connect(this->trackIngest, &TrackIngest::progressChanged, this, [this](int value, int maximum)
+    {
+        //最大値が0の間はフォルダを探している
+        this->ingestProgress->setRange(0, maximum);
+        this->ingestProgress->setValue(value);
+        this->ingestProgress->show();
+        this->ingestCancelButton->show();
+    });
+    connect(this->trackIngest, &TrackIngest::finished, this, [this](bool isCanceled)
+    {
+        this->ingestProgress->hide();
+        this->ingestCancelButton->hide();
+        if(isCanceled){
+            this->ui->statusBar->showMessage(tr("Loading canceled."), 3000);
+        }
+        this->CheckEnableEncodeButton();
+        this->StartAutoEncode();
+    });
+
+    //ラウドネス解析・クリップの検査 進捗は読み込みと同じ場所に出す
+    connect(this->ingestCancelButton, &QPushButton::clicked, this->trackAnalysis, &TrackAnalysis::Cancel);
+    connect(this->trackAnalysis, &TrackAnalysis::resultReady, this, [this](const TrackAnalysis::Result& result)
+    {
+        if(result.tasks & TrackAnalysis::Loudness){ this->metadataTable->SetLoudness(result.path, result.loudness); }
+        if(result.tasks & TrackAnalysis::Clipping){ this->metadataTable->SetClipping(result.path, result.clipping); }
+        if(result.tasks & TrackAnalysis::Waveform){ this->metadataTable->SetWaveform(result.path, result.waveform); }
+    });
+    connect(this->trackAnalysis, &TrackAnalysis::progressChanged, this, [this](int value, int maximum)
+    {
+        this->ingestProgress->setRange(0, maximum);
+        this->ingestProgress->setValue(value);
+        this->ingestProgress->show();
+        this->ingestCancelButton->show();
+    });
+    connect(this->trackAnalysis, &TrackAnalysis::finished, this, [this](bool isCanceled)
+    {
+        this->ingestProgress->hide();
+        this->ingestCancelButton->hide();
+        if(this->isEncodeAfterAnalysis == false){
+            this->ui->statusBar->showMessage(isCanceled ? tr("Analysis canceled.") : tr("Analysis finished."), 3000);
+            return;
+        }
+        if(isCanceled)
+        {
+            this->isEncodeAfterAnalysis = false;
+            this->analysisEncodeRows.clear();
+            for(auto widget : widgetListDisableDuringEncode){ widget->setEnabled(true); }
+            this->undoAction->setEnabled(this->undoStack->canUndo());
+            this->redoAction->setEnabled(this->undoStack->canRedo());
+            this->ui->actionClear_All_Items->setEnabled(true);
+            this->CheckEnableEncodeButton();
+            this->ui->statusBar->showMessage(tr("Analysis canceled."), 3000);
+            return;
+        }
+        //isEncodeAfterAnalysisを立てたまま呼び、測れなかった曲をもう一度解析しないようにする
+        this->EncodeTracks(std::move(this->analysisEncodeRows));
+        this->analysisEncodeRows.clear();
+        this->isEncodeAfterAnalysis = false;
+    });
+    connect(this->ui->actionAnalyze_Loudness, &QAction::triggered, this, [this]()
+    {
+        std::map<int, int> rowTasks;
+        for(int row=0; row<this->metadataTable->rowCount(); ++row){ rowTasks[row] = TrackAnalysis::Loudness; }
+        this->StartTrackAnalysis(rowTasks, false);
+    });
+    connect(this->ui->actionScan_Clipping, &QAction::triggered, this, [this]()
+    {
+        std::map<int, int> rowTasks;
+        for(int row=0; row<this->metadataTable->rowCount(); ++row){ rowTasks[row] = TrackAnalysis::Clipping; }
+        this->StartTrackAnalysis(rowTasks, false);
+    });
+
+    //監視モード 元wavが追加・差し替えられたら、その曲だけをエンコードする
+    connect(this->ui->actionWatch_Source_Folders, &QAction::toggled, this, [this](bool checked)
+    {
+        this->autoEncodePaths.clear();
+        if(checked == false){
+            this->sourceWatcher->Stop();
+            return;
+        }
+        this->UpdateWatchFolders();
+    });
+    connect(this->sourceWatcher, &SourceWatcher::filesChanged, this, [this](const QStringList& filePaths)
+    {
+        QHash<QString, int> rowOfPath;
+        for(int row=0; row<this->metadataTable->rowCount(); ++row){
+            rowOfPath.insert(QFileInfo(this->metadataTable->index(row, TableColumn::Title).data(Qt::UserRole).toString()).absoluteFilePath(), row);
+        }
+        QStringList newFiles;
+        for(const auto& filePath : filePaths)
+        {
+            const auto itr = rowOfPath.constFind(filePath);
+            if(itr == rowOfPath.constEnd()){
+                newFiles.append(filePath);
+            }
+            else{
+                //差し替えられたので長さなどを読み直す
+                WaveFile::Info info;
+                this->metadataTable->SetWaveInfo(itr.value(), WaveFile::ReadInfo(filePath, info) ? &info : nullptr);
+                this->StartWaveformAnalysis(itr.value(), itr.value());
+            }
+            this->autoEncodePaths.insert(filePath);
+        }
+        this->ui->statusBar->showMessage(tr("%1 source file(s) changed.").arg(filePaths.size()), 3000);
+        if(newFiles.isEmpty() == false){
+            this->ui->encodeButton->setEnabled(false);
+            this->trackIngest->Start(newFiles, this->ui->filenameDelimiter->text());
+        }
+        this->StartAutoEncode();
+    });
+    connect(this->artworkWatcher, &QFutureWatcher<QImage>::finished, this, [this]()
+    {
+        const QImage image = this->artworkWatcher->result();
+        this->ui->artwork->setPixmap(QPixmap::fromImage(image));
+        this->ui->artwork->setVisible(image.isNull() == false);
+    });
+    connect(this->artworkPrepareWatcher, &QFutureWatcher<QString>::finished, this, [this](){
+        this->StartEncodeJobs(this->artworkPrepareWatcher->result());
+    });
+
     //一括入力関係
     batchEntryWidget->hide();
     batchParameters.resize(ProjectDefines::headerItems.size());
@@ -352,7 +452,7 @@ MainWindow::MainWindow(QWidget *parent)
         }
         else{
             this->batchEntryWidget->hide();
-            this->ui->tableWidget->setFocus();
+            this->ui->tableView->setFocus();
         }
     });
 
@@ -386,12 +486,6 @@ MainWindow::MainWindow(QWidget *parent)
         this->openFiles({openfilePath});
     });
 
-    connect(this->ui->actionEncode_Settings, &QAction::triggered, this, [this]()
-    {
-        settings->show();
-        settings->raise();
-    });
-
     //出力先の取得と表示
     connect(this->ui->outputFolderPath, &QLineEdit::textChanged, this, [this](QString path)
     {
@@ -404,13 +498,28 @@ MainWindow::MainWindow(QWidget *parent)
     this->ui->outputFolderPath->setText(currentWorkDirectory+"/EncodeUtilityFolder");
 
     //メタデータが編集された
-    connect(this->ui->tableWidget, &QTableWidget::itemChanged, this, [this](QTableWidgetItem* item)
+    connect(this->metadataTable, &MetadataTable::editRequested, this, [this](const QModelIndex& index, const QString& text)
     {
-        //選択されている箇所を全て変更する
-        auto items = this->ui->tableWidget->selectedItems();
-        for(QTableWidgetItem* selectItem : items){
-            selectItem->setData(Qt::DisplayRole, item->data(Qt::DisplayRole));
+        //選択されている箇所を全て変更する 列ごとに1つのコマンドにまとめる
+        auto indexes = this->ui->tableView->selectionModel()->selectedIndexes();
+        if(indexes.contains(index) == false){
+            indexes.append(index);
+        }
+        std::map<int, std::vector<int>> rowsPerColumn;
+        for(const auto& selectIndex : indexes){
+            if(MetadataTable::IsEditableColumn(selectIndex.column()) == false){ continue; }
+            rowsPerColumn[selectIndex.column()].push_back(selectIndex.row());
+        }
+        if(rowsPerColumn.size() == 1){
+            auto& [column, rows] = *rowsPerColumn.begin();
+            this->undoStack->push(new SetTextCommand(this->metadataTable, column, std::move(rows), text));
+            return;
         }
+        this->undoStack->beginMacro(tr("Edit Cells"));
+        for(auto& [column, rows] : rowsPerColumn){
+            this->undoStack->push(new SetTextCommand(this->metadataTable, column, std::move(rows), text));
+        }
+        this->undoStack->endMacro();
     });
 
     connect(this->ui->encodeButton, &QPushButton::clicked, this, &MainWindow::Encode);
@@ -454,6 +563,12 @@ MainWindow::MainWindow(QWidget *parent)
                 component.enableCheck->setChecked(false);
                 return;
             }
+            if(checked && this->IsEncoderSupported(*component.encoder) == false){
+                //ffmpegが対応していないエンコーダーです
+                QMessageBox::warning(this, tr("Check Encoder"), tr("This ffmpeg does not support the encoder \"%1\".").arg(component.encoder->GetAudioEncoderName()));
+                component.enableCheck->setChecked(false);
+                return;
+            }
             component.encoder->SetIsEnableEncoder(checked);
             this->CheckEnableEncodeButton();
         });
@@ -515,27 +630,33 @@ MainWindow::MainWindow(QWidget *parent)
 
     //セルクリック時の右クリックメニュー
     QAction* delete_row_action = this->tableMenu->addAction(tr("Delete Row"));
-    this->ui->tableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(this->ui->tableWidget, &QTableWidget::customContextMenuRequested, this, [this, delete_row_action](const QPoint&)
+    this->ui->tableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(this->ui->tableView, &QTableView::customContextMenuRequested, this, [this, delete_row_action](const QPoint&)
     {
         //選択しているアイテムが無ければメニューを無効
-        delete_row_action->setEnabled(this->ui->tableWidget->selectedItems().size() > 0);
+        delete_row_action->setEnabled(this->ui->tableView->selectionModel()->hasSelection());
         this->tableMenu->exec(QCursor::pos());
     });
     connect(delete_row_action, &QAction::triggered, this, [this]()
     {
-        auto items = this->ui->tableWidget->selectedItems();
-        for(QTableWidgetItem* selectItem : items){
-            this->ui->tableWidget->removeRow(selectItem->row());
+        std::vector<int> rows;
+        for(const auto& index : this->ui->tableView->selectionModel()->selectedIndexes()){
+            rows.push_back(index.row());
         }
+        auto* command = new RemoveRowsCommand(this->metadataTable, std::move(rows));
+        command->setText(tr("Delete Row"));
+        this->undoStack->push(command);
     });
 
     connect(this->ui->actionClear_All_Items, &QAction::triggered, this, [this]()
     {
-        int size = this->ui->tableWidget->rowCount();
-        for(int row=0; row<size; ++row){
-            this->ui->tableWidget->removeRow(0);
-        }
+        const int size = this->metadataTable->rowCount();
+        if(size == 0){ return; }
+        std::vector<int> rows(size);
+        std::iota(rows.begin(), rows.end(), 0);
+        auto* command = new RemoveRowsCommand(this->metadataTable, std::move(rows));
+        command->setText(tr("Clear All Items"));
+        this->undoStack->push(command);
     });
 
     connect(this->ui->actionSettings, &QAction::triggered, this, [this](){
@@ -545,40 +666,153 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(this->ui->actionCheck_Encoder, &QAction::triggered, this, [this](){
         if(this->CheckEncoder()){
-            //エンコーダーを正しく認識しています。
-            QMessageBox::information(this, tr("Check Encoder"), tr("The encoder is correctly identified."));
+            this->ShowEncoderInfo();
+        }
+        else if(this->encoderProbeWatcher->isRunning()){
+            //確認が終わった時に表示する
+            this->isShowEncoderInfo = true;
+        }
+    });
+
+    //ffmpegの確認結果 最初の表示の時だけ、出力のチェックを結果に合わせる
+    connect(this->encoderProbeWatcher, &QFutureWatcher<EncoderProbe::Capabilities>::finished, this, [this]()
+    {
+        this->ApplyEncoderCapabilities(this->encoderProbeWatcher->result());
+        //エンコード中はエンコードの終了時に戻す
+        if(this->ui->tableView->isEnabled()){
+            for(auto& component : encoderComponents){ component.enableCheck->setEnabled(true); }
+        }
+
+        const bool isFound = this->settings->IsInProcessEncode() || this->encoderCapabilities.IsFound();
+        if(isFound == false)
+        {
+            //見つからなければダウンロードするか確認する ダウンロードの後にもう一度調べ、それでも無ければ諦める
+            if(this->isProbeAfterDownload == false && this->RequestFFmpegDownload()){
+                this->isProbeAfterDownload = true;
+                this->ProbeEncoderAsync();
+                return;
+            }
+            if(this->isProbeAfterDownload){
+                QMessageBox::critical(this, tr("Not found ffmpeg"), tr("Cannot find file needed for encoding. Check again when output is checked."), QMessageBox::Ok);
+            }
+        }
+        this->isProbeAfterDownload = false;
+
+        if(this->isShowEncoderInfo){
+            this->isShowEncoderInfo = false;
+            if(isFound){ this->ShowEncoderInfo(); }
+        }
+        if(this->showAtFirst == false){ return; }
+        this->showAtFirst = false;
+        for(auto& component : encoderComponents){
+            component.enableCheck->setChecked(isFound && this->IsEncoderSupported(*component.encoder));
         }
     });
 
     const auto InitEncodeProcess = [this](const auto& process)
     {
         connect(process.get(), &EncoderInterface::readStdOut, this, [this](QString arr){
-            this->ui->logWidget->insertPlainText("\n"+arr);
+            this->encodeLog->Append(arr);
         });
         connect(process.get(), &EncoderInterface::readStdError, this, [this](QString arr){
-            this->ui->logWidget->insertPlainText("\n"+arr);
-            this->ui->logWidget->verticalScrollBar()->setValue(this->ui->logWidget->verticalScrollBar()->maximum());
+            this->encodeLog->Append(arr);
         });
-
-        connect(process.get(), &EncoderInterface::encodeFinish, this, [this](const QString inputPath, const AudioMetaData&){
-            this->processedCount++;
-
-            this->ui->statusBar->showMessage(tr("Finish Encoding. %1/%2").arg(this->processedCount+1).arg(this->numEncodingMusic));
-            this->ui->logWidget->insertPlainText("\nfinish : "+inputPath+"\n");
-
-            if(this->processedCount >= this->numEncodingMusic)
-            {
-                //全部エンコードしたらエンコードボタンを有効にしてメタテーブルに表示を戻す
-                this->ui->statusBar->showMessage(tr("Complete."));
-                this->ui->logWidget->insertPlainText(tr("Complete."));
-                for(auto widget : widgetListDisableDuringEncode){ widget->setEnabled(true); }
-                this->ui->tabWidget->setCurrentIndex(0);
-            }
+        //ffmpegの出力はジョブごとのチャンネルに振り分ける
+        const EncoderInterface* encoder = process.get();
+        connect(process.get(), &EncoderInterface::readJobOutput, this, [this, encoder](int processNumber, QString arr){
+            this->encodeLog->Append(this->GetLogChannel(encoder, processNumber), arr);
         });
+        connect(process.get(), &EncoderInterface::encodeFinish, this, [this, encoder](const QString inputPath, const AudioMetaData&, int processNumber){
+            const int channel = this->GetLogChannel(encoder, processNumber);
+            this->encodeLog->FinishChannel(channel);
+            this->encodeLog->Append(channel, "finish : "+inputPath+"\n");
+        });
+        this->encodeScheduler->AddEncoder(process);
     };
     for(auto& component : encoderComponents){
         InitEncodeProcess(component.encoder);
     }
+    InitEncodeProcess(multiOutputEncoder);
+    std::vector<std::shared_ptr<EncoderInterface>> baseEncoders = {multiOutputEncoder};
+    for(auto& component : encoderComponents){
+        baseEncoders.emplace_back(component.encoder);
+    }
+    for(const auto& encoder : baseEncoders)
+    {
+        auto inProcessEncoder = std::make_shared<LibavEncoder>(encoder);
+        InitEncodeProcess(inProcessEncoder);
+        inProcessEncoders.emplace(encoder.get(), std::move(inProcessEncoder));
+    }
+
+    connect(this->encodeScheduler, &EncodeScheduler::jobStarted, this, [this](const EncodeJob& job){
+        this->encodeLog->Append(tr("start %1 encoding : %2(%3/%4)\n").arg(job.encoder->GetCodecExtention()).arg(job.metaData.title).arg(job.processNumber+1).arg(this->numEncodingMusic));
+    });
+    connect(this->encodeScheduler, &EncodeScheduler::jobSkipped, this, [this](const EncodeJob& job){
+        this->encodeLog->Append(tr("skip %1 encoding (up to date) : %2\n").arg(job.encoder->GetCodecExtention()).arg(job.metaData.title));
+    });
+    connect(this->encodeScheduler, &EncodeScheduler::jobTagUpdated, this, [this](const EncodeJob& job){
+        this->encodeLog->Append(tr("update %1 tags only : %2\n").arg(job.encoder->GetCodecExtention()).arg(job.metaData.title));
+    });
+    connect(this->encodeScheduler, &EncodeScheduler::jobFailed, this, [this](const EncodeJob& job){
+        this->encodeLog->Append(tr("failed to start %1 encoding : %2\n").arg(job.encoder->GetCodecExtention()).arg(job.metaData.title));
+    });
+    //検査で問題が見つかった曲は行ヘッダーに印を付け、エンコード後も残す
+    connect(this->encodeScheduler, &EncodeScheduler::jobVerifyFailed, this, [this](const EncodeJob& job){
+        this->encodeLog->Append(tr("verification failed %1 : %2\n").arg(job.encoder->GetCodecExtention()).arg(job.metaData.title));
+        for(const auto& message : job.verifyMessages){
+            this->encodeLog->Append("  " + message + "\n");
+        }
+        this->metadataTable->AddVerifyError(job.processNumber, job.verifyMessages.join('\n'));
+    });
+    connect(this->encodeScheduler, &EncodeScheduler::progressChanged, this, [this](int queued, int running, int finished, int total){
+        //全体の割合・処理速度(実時間の何倍か)・残り時間
+        const auto progress = this->encodeScheduler->GetOverallProgress();
+        QString message = tr("Encoding... %1% / queued %2 / running %3 / done %4/%5")
+                          .arg(int(progress.GetRatio() * 100.0)).arg(queued).arg(running).arg(finished).arg(total);
+        if(progress.speed > 0.0){
+            message += tr(" / x%1").arg(progress.speed, 0, 'f', 1);
+            const double etaSeconds = progress.GetEtaSeconds();
+            if(etaSeconds >= 0.0){
+                message += tr(" / ETA %1").arg(MetadataTable::FormatDuration(etaSeconds));
+            }
+        }
+        this->ui->statusBar->showMessage(message);
+    });
+    //曲ごとの進捗は行ヘッダーに表示する
+    connect(this->encodeScheduler, &EncodeScheduler::jobProgress, this, [this](const EncodeJob& job){
+        this->UpdateTrackProgress(job, job.progress.GetRatio());
+    });
+    for(auto signal : {&EncodeScheduler::jobFinished, &EncodeScheduler::jobSkipped, &EncodeScheduler::jobTagUpdated, &EncodeScheduler::jobFailed}){
+        connect(this->encodeScheduler, signal, this, [this](const EncodeJob& job){
+            this->UpdateTrackProgress(job, 1.0);
+        });
+    }
+    connect(this->encodeScheduler, &EncodeScheduler::allFinished, this, &MainWindow::FinishEncodeIfIdle);
+
+    //wavのコピーはワーカースレッドで行い、1ファイルごとに結果を表示する
+    connect(this->wavCopyWatcher, &QFutureWatcher<FastFileCopy::Result>::resultReadyAt, this, [this](int index){
+        const auto result = this->wavCopyWatcher->resultAt(index);
+        const auto fileName = QFileInfo(result.destination).fileName();
+        if(result.IsSucceeded()){
+            this->encodeLog->Append(tr("copy wave file : %1 (%2, %3 MB/s)\n").arg(fileName, FastFileCopy::GetMethodName(result.method))
+                                                 .arg(result.GetBytesPerSecond() / (1024.0 * 1024.0), 0, 'f', 1));
+        }
+        else{
+            this->encodeLog->Append(tr("failed to copy wave file : %1\n").arg(result.source));
+        }
+    });
+    connect(this->wavCopyWatcher, &QFutureWatcher<FastFileCopy::Result>::finished, this, [this](){
+        qint64 totalBytes = 0;
+        for(const auto& result : this->wavCopyWatcher->future().results()){
+            totalBytes += result.bytes;
+        }
+        const qint64 totalNs = this->wavCopyTimer.nsecsElapsed();
+        if(totalNs > 0){
+            this->encodeLog->Append(tr("copied wave files : %1 MB (%2 MB/s)\n").arg(totalBytes / (1024.0 * 1024.0), 0, 'f', 1)
+                                                 .arg(double(totalBytes) * 1e9 / double(totalNs) / (1024.0 * 1024.0), 0, 'f', 1));
+        }
+        this->FinishEncodeIfIdle();
+    });
 
     //設定ファイルの読み込み
     LoadSettingFile();
@@ -626,17 +860,20 @@ void MainWindow::CreateBatchEntryWidgets()
 
     connect(applyButton, &QPushButton::clicked, this, [this]()
     {
-        int row = this->ui->tableWidget->rowCount();
+        const int size = this->metadataTable->rowCount();
+        const bool hasText = std::any_of(this->batchParameters.begin(), this->batchParameters.end(), [](const QString& text){ return text.isEmpty() == false; });
+        if(size == 0 || hasText == false){ return; }
+        std::vector<int> rows(size);
+        std::iota(rows.begin(), rows.end(), 0);
+        //全ての列の書き換えを1回で取り消せるようにする
+        this->undoStack->beginMacro(tr("Batch Apply"));
         for(int i=1; i<ProjectDefines::headerItems.size(); ++i)
         {
             const auto& text = this->batchParameters[i-1];
             if(text.isEmpty()){ continue; }
-            for(int r=0; r<row; ++r)
-            {
-                auto* item = new QTableWidgetItem(text);
-                this->ui->tableWidget->setItem(r, i, item);
-            }
+            this->undoStack->push(new SetTextCommand(this->metadataTable, i, rows, text));
         }
+        this->undoStack->endMacro();
     });
 
     vLayout->addLayout(buttonLayout);
@@ -678,90 +915,54 @@ void MainWindow::openFiles(QStringList pathList)
 {
     this->aboutLabel->setHidden(true);
     this->ui->tabWidget->setHidden(false);
-    int row = this->ui->tableWidget->rowCount();
+
+    //プロジェクトファイルがあれば、読み込みは別関数に任せて他は無視する
     for(QString path : pathList)
     {
-        const QString extension = QFileInfo(path).suffix().toUpper();
-
-        if(extension == "ENCPROJ"){
+        if(QFileInfo(path).suffix().toUpper() == "ENCPROJ"){
             this->loadProjectFile(std::move(path));
-            break;  //プロジェクトファイル読み込みは別関数に任せるのでbreak
+            return;
         }
+    }
 
-        if(extension == "PNG" || extension == "JPG")
-        {
-            this->artworkPath = path;
-            QPixmap artwork = QPixmap(this->artworkPath);
-            this->ui->artwork->setVisible(true);
-            this->ui->artwork->setPixmap(artwork.scaled(128, 128, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-            continue;
+    //wavとフォルダは別スレッドで読み、読めた分から順に表に追加する
+    QStringList trackPaths;
+    for(const QString& path : pathList)
+    {
+        const QFileInfo info(path);
+        const QString extension = info.suffix().toUpper();
+        if(extension == "PNG" || extension == "JPG"){
+            this->LoadArtwork(path);
         }
-
-        if(extension != "WAV"){ continue; }
-
-        QString track_no = QString("%1").arg(row+1);    //iTunesが1開始なので準拠させる
-        QString title = path.mid(path.lastIndexOf("/")+1).section(".", 0, 0);
-        QString albumTitle = "";
-        QString artist = "";
-        QString genre = "";
-
-        //区切り文字で分けられればメタデータをファイル名から取得
-        QStringList metaDatas = title.split(this->ui->filenameDelimiter->text());
-        const int size = metaDatas.size();
-        if(size > 0)
-        {
-            //意図的なフォールスルー
-            switch(size-1)
-            {
-            case TableColumn::Genre:
-                genre = metaDatas[4];
-                [[fallthrough]];
-            case TableColumn::AlbumTitle:
-                albumTitle = metaDatas[3];
-                [[fallthrough]];
-            case TableColumn::Artist:
-                artist = metaDatas[2];
-                [[fallthrough]];
-            case TableColumn::Title:
-                title = metaDatas[1];
-                [[fallthrough]];
-            case TableColumn::TrackNo:
-            {
-                QString buf = metaDatas[0];
-                bool isOk = false;
-                int num = buf.toInt(&isOk);
-                if(isOk){
-                    track_no = QString("%1").arg(num);
-                }
-            }
-                break;
-            default:
-                break;
-            }
+        else if(info.isDir() || extension == "WAV"){
+            trackPaths.append(path);
         }
+    }
+    if(trackPaths.isEmpty()){ return; }
+    this->ui->encodeButton->setEnabled(false);
+    this->trackIngest->Start(trackPaths, this->ui->filenameDelimiter->text());
+}
 
-        //行挿入 & 列挿入 選択項目の一斉変更が効かなくなるのでアイテムは空でも必ずセットする
-        this->ui->tableWidget->insertRow(row);
-        this->ui->tableWidget->setItem(row, TableColumn::TrackNo, new QTableWidgetItem(track_no));
-        {
-            QTableWidgetItem* item = new QTableWidgetItem(title);
-            item->setData(Qt::UserRole, QVariant(path));
-            this->ui->tableWidget->setItem(row, TableColumn::Title,  item);
+void MainWindow::AppendTracks(std::vector<MetadataTable::Row> rows)
+{
+    const int firstRow = this->metadataTable->rowCount();
+    int row = firstRow;
+    for(auto& newRow : rows)
+    {
+        if(newRow.metaData.track_no.isEmpty()){
+            newRow.metaData.track_no = QString("%1").arg(row+1);    //iTunesが1開始なので準拠させる
         }
-        this->ui->tableWidget->setItem(row, TableColumn::Artist,     new QTableWidgetItem(artist));
-        this->ui->tableWidget->setItem(row, TableColumn::AlbumTitle, new QTableWidgetItem(albumTitle));
-        this->ui->tableWidget->setItem(row, TableColumn::AlbumArtist,new QTableWidgetItem());
-        this->ui->tableWidget->setItem(row, TableColumn::Group,      new QTableWidgetItem());
-        this->ui->tableWidget->setItem(row, TableColumn::Genre,      new QTableWidgetItem(genre));
-        this->ui->tableWidget->setItem(row, TableColumn::Composer,   new QTableWidgetItem());
-        this->ui->tableWidget->setItem(row, TableColumn::Year,       new QTableWidgetItem());
         row++;
     }
 
-    this->ui->tableWidget->resizeColumnsToContents();
+    //行はまとめて追加し、ビューへの通知を1回にする
+    this->metadataTable->AppendRows(std::move(rows));
+    this->ui->tableView->resizeColumnsToContents();
+    this->UpdateWatchFolders();
+    this->StartWaveformAnalysis(firstRow, this->metadataTable->rowCount() - 1);
 
     //項目があればエンコードボタンを有効
-    if(this->ui->tableWidget->rowCount() > 0){
+    if(this->metadataTable->rowCount() > 0){
         this->CheckEnableEncodeButton();
         this->ui->actionSave_as->setEnabled(true);
         this->ui->actionSave_file->setEnabled(true);
@@ -769,9 +970,61 @@ void MainWindow::openFiles(QStringList pathList)
     }
 }
 
+void MainWindow::UpdateWatchFolders()
+{
+    if(this->ui->actionWatch_Source_Folders->isChecked() == false){ return; }
+    QStringList folders;
+    for(int row=0; row<this->metadataTable->rowCount(); ++row)
+    {
+        const QString folder = QFileInfo(this->metadataTable->index(row, TableColumn::Title).data(Qt::UserRole).toString()).absolutePath();
+        if(folders.contains(folder) == false){
+            folders.append(folder);
+        }
+    }
+    this->sourceWatcher->SetFolders(folders);
+}
+
+void MainWindow::StartAutoEncode()
+{
+    //エンコードボタンが押せない間(読み込み中・エンコード中・エンコーダーが無い)は溜めておく
+    if(this->autoEncodePaths.isEmpty() || this->ui->encodeButton->isEnabled() == false){ return; }
+
+    std::vector<int> rows;
+    for(int row=0; row<this->metadataTable->rowCount(); ++row)
+    {
+        const QString sourcePath = this->metadataTable->index(row, TableColumn::Title).data(Qt::UserRole).toString();
+        if(this->autoEncodePaths.contains(QFileInfo(sourcePath).absoluteFilePath())){
+            rows.push_back(row);
+        }
+    }
+    this->autoEncodePaths.clear();
+    if(rows.empty() == false){
+        this->EncodeTracks(std::move(rows));
+    }
+}
+
+void MainWindow::LoadArtwork(const QString& path)
+{
+    this->artworkPath = path;
+    //表示用の縮小画像だけが要るので、対応している形式はデコード時に縮小する
+    this->artworkWatcher->setFuture(QtConcurrent::run([path]()
+    {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        const QSize size = reader.size();
+        if(size.isValid() && (size.width() > artworkPreviewSize * 2 || size.height() > artworkPreviewSize * 2)){
+            reader.setScaledSize(size.scaled(artworkPreviewSize * 2, artworkPreviewSize * 2, Qt::KeepAspectRatio));
+        }
+        const QImage image = reader.read();
+        if(image.isNull()){ return image; }
+        return image.scaled(artworkPreviewSize, artworkPreviewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }));
+}
+
 void MainWindow::CheckEnableEncodeButton()
 {
-    if(this->ui->tableWidget->rowCount() == 0){
+    //読み込み中は行が揃っていないのでエンコードさせない
+    if(this->metadataTable->rowCount() == 0 || this->trackIngest->IsRunning()){
         this->ui->encodeButton->setEnabled(false);
         return;
     }
@@ -788,79 +1041,137 @@ void MainWindow::showEvent(QShowEvent *e)
 {
     QMainWindow::showEvent(e);
 
-    //エンコーダーの存在チェック
-    if(showAtFirst){
-        auto enable = CheckEncoder();
-        this->ui->outputMp3->setChecked(enable);
-        this->ui->outputM4a->setChecked(enable);
-        this->ui->outputFlac->setChecked(enable);
+    //エンコーダーの存在チェック 画面を先に出すため別スレッドで行い、終わった時に出力のチェックを合わせる
+    if(showAtFirst && this->encoderProbeWatcher->isRunning() == false){
+        this->ProbeEncoderAsync();
+    }
+}
+
+void MainWindow::ProbeEncoderAsync()
+{
+    //確認が終わるまで出力のチェックを変えさせない
+    for(auto& component : encoderComponents){
+        component.enableCheck->setEnabled(false);
+    }
+    this->probedFFmpegPath = this->settings->GetFFmpegPath();
+    this->encoderProbeWatcher->setFuture(QtConcurrent::run(EncoderProbe::Probe, this->probedFFmpegPath));
+}
+
+void MainWindow::ApplyEncoderCapabilities(const EncoderProbe::Capabilities& capabilities)
+{
+    this->encoderCapabilities = capabilities;
+    //見つけたパスを使い、ジョブごとに探し直さないようにする
+    for(auto& component : encoderComponents){
+        component.encoder->SetFFmpegPath(capabilities.ffmpegPath);
+        component.enableCheck->setToolTip(this->IsEncoderSupported(*component.encoder) ? QString()
+                                          : tr("This ffmpeg does not support the encoder \"%1\".").arg(component.encoder->GetAudioEncoderName()));
+    }
+    this->multiOutputEncoder->SetFFmpegPath(capabilities.ffmpegPath);
+    if(capabilities.IsFound()){
+        this->ui->statusBar->showMessage(capabilities.version, 3000);
+    }
+}
 
-        showAtFirst = false;
+bool MainWindow::IsEncoderSupported(const EncoderInterface& encoder) const
+{
+    const QString name = encoder.GetAudioEncoderName();
+    if(name.isEmpty() || this->settings->IsInProcessEncode() || this->encoderCapabilities.encoders.isEmpty()){
+        return true;
     }
+    return this->encoderCapabilities.HasEncoder(name);
 }
 
 void MainWindow::SaveProjectFile(QString saveFilePath)
 {
-    // ### Ver.1.0.0
-    // project version
-    // output path
-    // image path
-
-    // ### Ver.1.0.1
-    // addTrackNo Flag
-    // delimiter
-    // fill digit
-
-    // ### Ver.1.0.2
-    // filenameDelimiter
-
-    // ### Common
-    // no., title, artist, albumtitle...
-    // no., title, artist, albumtitle...
     if(saveFilePath.isEmpty()){ return; }
 
-    QStringList tableList;
-    tableList.append(QString::number(ProjectDefines::projectVersionNum));
-    tableList.append(this->ui->outputFolderPath->text());
-    tableList.append(this->artworkPath);
-
-    // ### Ver.1.0.1
-    tableList.append(QVariant(this->ui->check_addTrackNo->isChecked()).toString());
-    tableList.append(this->ui->track_no_delimiter->text());
-    tableList.append(QString::number(this->ui->num_of_digit->value()));
-
-    // ### Ver.1.0.2
-    tableList.append(this->ui->filenameDelimiter->text());
+    if(ProjectFile::Save(saveFilePath, this->GetProjectMetaData()) == false){
+        this->ui->statusBar->showMessage(tr("Can't save file."), 3000);
+        return;
+    }
+    this->lastLoadProject = saveFilePath;
 
-    // ### Ver.1.0.3
-    tableList.append(QVariant(this->ui->check_addTrackNo->isChecked()).toString());
-    tableList.append(QString::number(this->ui->num_of_digit->value()));
-    tableList.append(this->ui->track_no_delimiter->text());
+    this->ui->statusBar->showMessage(tr("File saved."), 3000);
+}
 
+AudioMetaData MainWindow::GetRowMetaData(int row) const
+{
+    AudioMetaData metaData = this->metadataTable->GetMetaData(row);
+    metaData.artworkPath = this->artworkPath;
 
-    // ### Common
-    const int row = this->ui->tableWidget->rowCount();
-    const int col = this->ui->tableWidget->columnCount();
-    for(int i=0; i<row; ++i)
+    //無音の曲はゲインが決まらないので書かない
+    if(this->settings->IsWriteLoudnessTags())
     {
-        for(int j=0; j<col; ++j)
+        const auto& loudness = this->metadataTable->GetLoudness(row);
+        if(loudness.isValid && std::isfinite(loudness.integratedLufs))
         {
-            if(j == Title){
-                tableList.append(this->ui->tableWidget->item(i,j)->data(Qt::UserRole).toString());
-            }
-            else{
-                tableList.append(this->ui->tableWidget->item(i,j)->text());
-            }
+            metaData.replayGainTrackGain = LoudnessAnalyzer::FormatGain(loudness.GetGainDb());
+            metaData.replayGainTrackPeak = LoudnessAnalyzer::FormatPeak(loudness.truePeak);
+            metaData.iTunNORM = LoudnessAnalyzer::MakeITunNorm(loudness.GetGainDb(), loudness.truePeak);
+        }
+        const auto album = this->metadataTable->GetAlbumLoudness(row);
+        if(album.isValid && std::isfinite(album.integratedLufs))
+        {
+            metaData.replayGainAlbumGain = LoudnessAnalyzer::FormatGain(LoudnessAnalyzer::replayGainReferenceLufs - album.integratedLufs);
+            metaData.replayGainAlbumPeak = LoudnessAnalyzer::FormatPeak(album.truePeak);
         }
     }
+    //AAC・MP3の出力だけに掛ける FLAC・wavはそのまま
+    if(this->settings->IsLossyPreGain()){
+        metaData.lossyGainDb = this->metadataTable->GetClipping(row).GetLossyGainDb();
+    }
+    return metaData;
+}
 
-    QFile file(saveFilePath);
-    if(file.open(QFile::WriteOnly)){
-        file.write(tableList.join(',').toLocal8Bit());
+bool MainWindow::StartTrackAnalysis(const std::map<int, int>& rowTasks, bool isOnlyMissing)
+{
+    //行ごとに必要な解析が違うので、同じ組み合わせの曲をまとめて渡す
+    QMap<int, QStringList> pathsOfTasks;
+    for(auto [row, tasks] : rowTasks)
+    {
+        if(isOnlyMissing)
+        {
+            if(this->metadataTable->GetLoudness(row).isValid){ tasks &= ~TrackAnalysis::Loudness; }
+            if(this->metadataTable->GetClipping(row).isValid){ tasks &= ~TrackAnalysis::Clipping; }
+            if(this->metadataTable->GetWaveform(row).isEmpty() == false){ tasks &= ~TrackAnalysis::Waveform; }
+        }
+        if(tasks == 0){ continue; }
+        pathsOfTasks[tasks].append(this->metadataTable->index(row, TableColumn::Title).data(Qt::UserRole).toString());
     }
-    this->lastLoadProject = saveFilePath;
+    if(pathsOfTasks.isEmpty()){ return false; }
+    this->ui->statusBar->showMessage(tr("Analyzing sources..."));
+    for(auto itr = pathsOfTasks.begin(); itr != pathsOfTasks.end(); ++itr)
+    {
+        itr.value().removeDuplicates();
+        this->trackAnalysis->Start(itr.value(), itr.key());
+    }
+    return true;
+}
 
-    this->ui->statusBar->showMessage(tr("File saved."), 3000);
+void MainWindow::StartWaveformAnalysis(int firstRow, int lastRow)
+{
+    std::map<int, int> rowTasks;
+    for(int row=firstRow; row<=lastRow; ++row){ rowTasks[row] = TrackAnalysis::Waveform; }
+    this->StartTrackAnalysis(rowTasks, true);
+}
+
+ProjectMetaData MainWindow::GetProjectMetaData() const
+{
+    ProjectMetaData project;
+    project.projectPath       = this->lastLoadProject;
+    project.outputFolderPath  = this->ui->outputFolderPath->text();
+    project.artworkPath       = this->artworkPath;
+    project.isAddTrackNo      = this->ui->check_addTrackNo->isChecked();
+    project.trackNoDelimiter  = this->ui->track_no_delimiter->text();
+    project.numOfDigit        = this->ui->num_of_digit->value();
+    project.filenameDelimiter = this->ui->filenameDelimiter->text();
+
+    const int row = this->metadataTable->rowCount();
+    project.audioMetaData.reserve(row);
+    for(int i=0; i<row; ++i){
+        project.audioMetaData.emplace_back(this->GetRowMetaData(i));
+    }
+    return project;
 }
 
 void MainWindow::SaveSettingFile(QString key, QVariant value)
@@ -878,104 +1189,119 @@ void MainWindow::LoadSettingFile()
 
 void MainWindow::loadProjectFile(QString projFilePath)
 {
-    if(projFilePath.isEmpty()){ return; }
-
-    QFile file(projFilePath);
-    if(file.open(QFile::ReadOnly) == false){ return; }
+    ProjectMetaData project;
+    if(ProjectFile::Load(projFilePath, project) == false){ return; }
 
     currentWorkDirectory = QFileInfo(projFilePath).absoluteDir().absolutePath();
 
-    this->ui->tableWidget->clear();
-    this->ui->tableWidget->setRowCount(0);
-    this->ui->outputFolderPath->setText("");
-    this->artworkPath = "";
-
-    this->ui->tableWidget->setColumnCount(ALL);
-    this->ui->tableWidget->setHorizontalHeaderLabels(ProjectDefines::headerItems);
-
-    auto data = file.readAll();
-    auto strList = QString::fromLocal8Bit(data).split(",");
-    int index = 0;
-    auto projVersion = strList[index++].toInt();
-    this->ui->outputFolderPath->setText(strList[index++]);
-
-    this->artworkPath = strList[index++];
-    QPixmap artwork = QPixmap(this->artworkPath);
-    this->ui->artwork->setVisible(true);
-    this->ui->artwork->setPixmap(artwork.scaled(128, 128, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-
-    if(0x010001 <= projVersion){
-        this->ui->check_addTrackNo->setChecked(QVariant(strList[index++]).toBool());
-        this->ui->track_no_delimiter->setText(strList[index++]);
-        this->ui->num_of_digit->setValue(strList[index++].toInt());
-    }
-    if(0x010002 <= projVersion){
-        this->ui->filenameDelimiter->setText(strList[index++]);
-    }
-    if(0x010003 <= projVersion) 
-    {
-        this->ui->check_addTrackNo->setChecked(QVariant(strList[index++]).toBool());
-        this->ui->num_of_digit->setValue(strList[index++].toInt());
-        this->ui->track_no_delimiter->setText(strList[index++]);
-    }
+    this->trackIngest->Cancel();
+    this->metadataTable->Clear();
+    this->undoStack->clear();
+
+    this->ui->outputFolderPath->setText(project.outputFolderPath);
 
-    int row = 0;
-    const int size = strList.size();
-    while(index < size)
+    this->LoadArtwork(project.artworkPath);
+
+    this->ui->check_addTrackNo->setChecked(project.isAddTrackNo);
+    this->ui->num_of_digit->setValue(project.numOfDigit);
+    this->ui->track_no_delimiter->setText(project.trackNoDelimiter);
+    this->ui->filenameDelimiter->setText(project.filenameDelimiter);
+
+    std::vector<MetadataTable::Row> rows;
+    rows.reserve(project.audioMetaData.size());
+    for(const auto& metaData : project.audioMetaData)
     {
-        this->ui->tableWidget->insertRow(row);
-        for(int i=0; i<ALL; ++i)
-        {
-            QTableWidgetItem* item = nullptr;
-            if(i == Title){
-                auto path = strList[index];
-                auto title = path.mid(path.lastIndexOf("/")+1).section(".", 0, 0);
-                item = new QTableWidgetItem();
-
-                item->setText(title);
-                QStringList metaDatas = title.split('_');
-                if(metaDatas.size() > 1){
-                    item->setText(metaDatas[1]);
-                }
-                item->setData(Qt::UserRole, path);
-            }
-            else{
-                item = new QTableWidgetItem(strList[index]);
-            }
-            this->ui->tableWidget->setItem(row, i, item);
-            ++index;
-        }
-        row++;
+        MetadataTable::Row newRow;
+        newRow.metaData = metaData;
+        newRow.hasWaveInfo = WaveFile::ReadInfo(metaData.sourcePath, newRow.waveInfo);
+        rows.push_back(std::move(newRow));
     }
+    this->metadataTable->AppendRows(std::move(rows));
+    this->ui->tableView->resizeColumnsToContents();
 
     this->ui->batchInputButton->setEnabled(true);
+    this->UpdateWatchFolders();
+    this->StartWaveformAnalysis(0, this->metadataTable->rowCount() - 1);
 
     this->lastLoadProject = projFilePath;
 }
 
 void MainWindow::Encode()
 {
+    std::vector<int> rows(this->metadataTable->rowCount());
+    std::iota(rows.begin(), rows.end(), 0);
+    this->EncodeTracks(std::move(rows));
+}
+
+void MainWindow::EncodeTracks(std::vector<int> rows)
+{
+    //エンコード前に、まだ解析していない曲を先に解析する
+    const bool isLossyOutput = this->ui->outputM4a->isChecked() || this->ui->outputMp3->isChecked();
+    if(this->isEncodeAfterAnalysis == false)
+    {
+        std::map<int, int> rowTasks;
+        //ReplayGainのアルバムのゲインに使うので、同じアルバムの曲も全て測る
+        if(this->settings->IsWriteLoudnessTags())
+        {
+            QSet<QString> albums;
+            for(int row : rows){ albums.insert(this->metadataTable->GetText(row, TableColumn::AlbumTitle)); }
+            for(int row=0; row<this->metadataTable->rowCount(); ++row){
+                if(albums.contains(this->metadataTable->GetText(row, TableColumn::AlbumTitle))){ rowTasks[row] |= TrackAnalysis::Loudness; }
+            }
+        }
+        //クリップは非可逆圧縮でしか問題にならない
+        if((this->settings->IsClipScan() || this->settings->IsLossyPreGain()) && isLossyOutput){
+            for(int row : rows){ rowTasks[row] |= TrackAnalysis::Clipping; }
+        }
+        if(this->StartTrackAnalysis(rowTasks, true))
+        {
+            //解析中も行番号が変わらないよう、エンコード中と同じく編集させない
+            this->isEncodeAfterAnalysis = true;
+            this->analysisEncodeRows = std::move(rows);
+            for(auto widget : widgetListDisableDuringEncode){ widget->setEnabled(false); }
+            this->undoAction->setEnabled(false);
+            this->redoAction->setEnabled(false);
+            this->ui->actionClear_All_Items->setEnabled(false);
+            return;
+        }
+    }
+
     this->ui->statusBar->showMessage(tr("Start Encoding."));
 
-    this->processedCount = 0;
-    this->numEncodingMusic = this->ui->tableWidget->rowCount();
+    //曲数のタグには表全体の曲数を使う
+    this->numEncodingMusic = this->metadataTable->rowCount();
+    this->encodingRows = std::move(rows);
     this->numEncodingFile = [&]()
     {
+        const int numTracks = static_cast<int>(this->encodingRows.size());
         int result = 0;
         if(this->ui->outputMp3->isChecked()){
-            result += this->numEncodingMusic;
+            result += numTracks;
         }
         if(this->ui->outputM4a->isChecked()){
-            result += this->numEncodingMusic;
+            result += numTracks;
         }
         if(this->ui->outputFlac->isChecked()){
-            result += this->numEncodingMusic;
+            result += numTracks;
         }
         return result;
     }();
 
+    //ログは実行ごとにファイルへ全文を残し、画面には直近の行だけを表示する
+    this->encodeLog->Clear();
+    this->logChannels.clear();
+    const QString logFilePath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                              + "/logs/encode-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".log";
+    if(this->encodeLog->OpenFile(logFilePath)){
+        this->encodeLog->Append(tr("log file : %1\n").arg(logFilePath));
+    }
+
     //エンコード中にエンコードさせないようにするためボタンを無効
     for(auto widget : widgetListDisableDuringEncode){ widget->setEnabled(false); }
+    //エンコード中は行番号がジョブと対応しているので、行を戻したり消したりさせない
+    this->undoAction->setEnabled(false);
+    this->redoAction->setEnabled(false);
+    this->ui->actionClear_All_Items->setEnabled(false);
     this->ui->tabWidget->setCurrentIndex(1);    //ログウィジェットを表示
 
     const QString outputFolder = this->ui->outputFolderPath->text();
@@ -990,18 +1316,112 @@ void MainWindow::Encode()
         QFile::copy(this->artworkPath, outputFolder+"/"+imageOutputPath+this->artworkPath.mid(this->artworkPath.lastIndexOf("/")));
     }
 
-#if defined(Q_OS_MAC)
-    MacEncodeProcess();
-#elif defined(Q_OS_WIN)
-    WindowsEncodeProcess();
-#endif
+    EncodeProcess();
 }
 
-void MainWindow::WindowsEncodeProcess()
+int MainWindow::GetLogChannel(const EncoderInterface* encoder, int processNumber)
 {
-    const QString outputFolder = this->ui->outputFolderPath->text();
-    const int size = this->ui->tableWidget->rowCount();
+    const auto key = std::make_pair(encoder, processNumber);
+    auto itr = this->logChannels.find(key);
+    if(itr == this->logChannels.end()){
+        const auto title = QString("%1 %2").arg(encoder->GetCodecName(), this->GetRowMetaData(processNumber).title);
+        itr = this->logChannels.emplace(key, this->encodeLog->AddChannel(title)).first;
+    }
+    return itr->second;
+}
+
+void MainWindow::UpdateTrackProgress(const EncodeJob& job, double ratio)
+{
+    const int row = job.processNumber;
+    if(row < 0 || row >= this->metadataTable->rowCount()){ return; }
+
+    auto& rowRatios = this->jobRatios[row];
+    rowRatios[job.encoder.get()] = ratio;
+    double sum = 0.0;
+    for(const auto& [encoder, value] : rowRatios){
+        sum += value;
+    }
+    const double trackRatio = sum / std::max(this->numJobsPerTrack, 1);
+
+    QString toolTip;
+    if(job.progress.speed > 0.0 && ratio < 1.0){
+        toolTip = tr("%1 : x%2 / ETA %3").arg(job.encoder->GetCodecName()).arg(job.progress.speed, 0, 'f', 1)
+                  .arg(MetadataTable::FormatDuration(std::max(job.progress.GetEtaSeconds(), 0.0)));
+    }
+    this->metadataTable->SetRowProgress(row, trackRatio, toolTip);
+}
+
+void MainWindow::FinishEncodeIfIdle()
+{
+    if(this->encodeScheduler->IsRunning() || this->wavCopyWatcher->isRunning()){
+        return;
+    }
+    this->encodeCancelButton->hide();
+    //行ヘッダーを行番号に戻して隠す
+    this->metadataTable->ClearProgress();
+    this->ui->tableView->verticalHeader()->setVisible(this->metadataTable->HasVerifyErrors());
+    this->jobRatios.clear();
+    const auto progress = this->encodeScheduler->GetOverallProgress();
+    if(progress.speed > 0.0){
+        this->encodeLog->Append(tr("encoded %1 of audio at x%2\n").arg(MetadataTable::FormatDuration(progress.outTimeSeconds)).arg(progress.speed, 0, 'f', 1));
+    }
+    //ジョブごとの処理時間・CPU時間・メモリを出力先に残す
+    if(this->encodeScheduler->GetFinishedJobs().empty() == false)
+    {
+        const QString outputFolder = this->ui->outputFolderPath->text();
+        if(EncodeReport::Write(outputFolder, this->encodeScheduler->GetFinishedJobs())){
+            this->encodeLog->Append(tr("report : %1\n").arg(QDir(outputFolder).filePath(EncodeReport::csvFileName)));
+        }
+        else{
+            this->encodeLog->Append(tr("can't write encode report to %1\n").arg(outputFolder));
+        }
+    }
+    //全部エンコードしたらエンコードボタンを有効にしてメタテーブルに表示を戻す
+    if(this->isEncodeCanceled){
+        this->ui->statusBar->showMessage(tr("Stopped."));
+    }
+    else if(this->metadataTable->HasVerifyErrors()){
+        this->ui->statusBar->showMessage(tr("Complete. Some outputs failed verification."));
+    }
+    else{
+        this->ui->statusBar->showMessage(tr("Complete."));
+    }
+    this->encodeLog->Append(tr("Complete.\n"));
+    this->encodeLog->Flush();
+    this->encodeLog->CloseFile();
+    for(auto widget : widgetListDisableDuringEncode){ widget->setEnabled(true); }
+    this->undoAction->setEnabled(this->undoStack->canUndo());
+    this->redoAction->setEnabled(this->undoStack->canRedo());
+    this->ui->actionClear_All_Items->setEnabled(true);
+    this->ui->tabWidget->setCurrentIndex(0);
+
+    //エンコード中に見つけた変更があれば続けてエンコードする 中止した場合は次の変更まで待つ
+    if(this->isEncodeCanceled == false){
+        this->StartAutoEncode();
+    }
+}
 
+void MainWindow::EncodeProcess()
+{
+    //進捗は行ヘッダーに出すので、エンコード中だけ表示する
+    this->ui->tableView->verticalHeader()->setVisible(true);
+    this->metadataTable->ClearVerifyErrors();
+
+    //ジャケットは全ジョブで共通なので、ここで1回だけ埋め込み用のJPEGにしておく
+    //大きな画像のハッシュ・デコードで画面が止まらないよう、スレッドプールで行う
+    const QString sourceArtworkPath = this->artworkPath;
+    const int artworkEmbedSize = this->settings->GetArtworkEmbedSize();
+    this->ui->statusBar->showMessage(tr("Preparing artwork..."));
+    this->artworkPrepareWatcher->setFuture(QtConcurrent::run([sourceArtworkPath, artworkEmbedSize](){
+        return ArtworkPreprocessor::Prepare(sourceArtworkPath, artworkEmbedSize);
+    }));
+}
+
+void MainWindow::StartEncodeJobs(const QString& embedArtworkPath)
+{
+    const QString outputFolder = this->ui->outputFolderPath->text();
+    const bool isLossyOutput = this->ui->outputM4a->isChecked() || this->ui->outputMp3->isChecked();
+    this->ui->statusBar->clearMessage();
 
     for(const auto& component : encoderComponents){
         component.encoder->SetOutputFolderPath(outputFolder);
@@ -1010,35 +1430,63 @@ void MainWindow::WindowsEncodeProcess()
         component.encoder->SetTrackNumberDelimiter(this->ui->track_no_delimiter->text());
         component.encoder->SetNumEncodingMusic(this->numEncodingMusic);
     }
+    this->encodeScheduler->SetMaxParallelJobs(this->settings->GetMaxParallelJobs());
+    this->encodeScheduler->SetBatchEncode(this->settings->IsBatchEncode());
+    this->encodeScheduler->SetVerifyOutputs(this->settings->IsVerifyOutputs());
+
+    //前回から変更の無い出力はエンコードしない
+    std::shared_ptr<EncodeCache> cache;
+    if(this->settings->IsSkipUpToDate()){
+        cache = std::make_shared<EncodeCache>();
+        cache->Open(outputFolder);
+    }
+    this->encodeScheduler->SetCache(cache);
+
+    //複数コーデックを出力する場合、設定に応じて1曲1プロセスにまとめる
+    std::vector<std::shared_ptr<EncoderInterface>> enabledEncoders;
+    for(const auto& component : encoderComponents){
+        if(component.enableCheck->isChecked()){
+            enabledEncoders.emplace_back(component.encoder);
+        }
+    }
+    if(this->settings->IsFanOutEncode() && enabledEncoders.size() > 1){
+        this->multiOutputEncoder->SetOutputEncoders(enabledEncoders);
+        enabledEncoders = {this->multiOutputEncoder};
+    }
+    if(this->settings->IsInProcessEncode()){
+        for(auto& encoder : enabledEncoders){
+            encoder = this->inProcessEncoders.at(encoder.get());
+        }
+    }
+    this->numJobsPerTrack = static_cast<int>(enabledEncoders.size());
+    this->jobRatios.clear();
 
     const auto wavOutputFullPath = outputFolder + "/" + this->wavOutputPath;
 
-    for(int i=0; i<size; ++i)
+    QList<std::pair<QString, QString>> wavCopies;
+    for(int i : this->encodingRows)
     {
-        AudioMetaData metaData;
-        auto inputPath       = this->ui->tableWidget->item(i, TableColumn::Title)->data(Qt::UserRole).toString();
-        metaData.title       = this->ui->tableWidget->item(i, TableColumn::Title)->data(Qt::DisplayRole).toString();
-        metaData.track_no    = this->ui->tableWidget->item(i, TableColumn::TrackNo)->data(Qt::DisplayRole).toString();
-        metaData.artist      = this->ui->tableWidget->item(i, TableColumn::Artist)->data(Qt::DisplayRole).toString();
-        metaData.albumTitle  = this->ui->tableWidget->item(i, TableColumn::AlbumTitle)->data(Qt::DisplayRole).toString();
-        metaData.genre       = this->ui->tableWidget->item(i, TableColumn::Genre)->data(Qt::DisplayRole).toString();
-        metaData.albumArtist = this->ui->tableWidget->item(i, TableColumn::AlbumArtist)->data(Qt::DisplayRole).toString();
-        metaData.group       = this->ui->tableWidget->item(i, TableColumn::Group)->data(Qt::DisplayRole).toString();
-        metaData.composer    = this->ui->tableWidget->item(i, TableColumn::Composer)->data(Qt::DisplayRole).toString();
-        metaData.year        = this->ui->tableWidget->item(i, TableColumn::Year)->data(Qt::DisplayRole).toString();
-        metaData.artworkPath = this->artworkPath;
-
-
-        for(const auto& component : encoderComponents){
-            if(component.enableCheck->isChecked())
-            {
-                if(component.encoder->Encode(inputPath, metaData, i)){
-                    this->ui->logWidget->insertPlainText(tr("start %1 encoding : %2(%3/%4)\n").arg(component.encoder->GetCodecExtention()).arg(metaData.title).arg(i+1).arg(this->numEncodingMusic));
-                }
-                else{
-                    this->processedCount++;
-                }
-            }
+        AudioMetaData metaData = this->GetRowMetaData(i);
+        metaData.artworkPath = embedArtworkPath;
+        //長さは読み込み時にヘッダーから求めてある 読めていなければここで1回だけ求めておく
+        if(metaData.durationSeconds <= 0.0){
+            metaData.durationSeconds = WaveFile::GetDurationSeconds(metaData.sourcePath);
+        }
+        const auto inputPath = metaData.sourcePath;
+
+        //非可逆圧縮でクリップする恐れのある曲はログに残す
+        const auto& clipping = this->metadataTable->GetClipping(i);
+        if(isLossyOutput && clipping.IsAtRisk())
+        {
+            QString warning = tr("warning : %1 may clip after AAC/MP3 encoding (%2 dBTP, %3 clipped places)")
+                                  .arg(metaData.title).arg(clipping.GetInterSamplePeakDb(), 0, 'f', 2).arg(clipping.clippedRuns);
+            if(metaData.lossyGainDb < 0.0){ warning += tr(" / pre-gain %1 dB").arg(metaData.lossyGainDb, 0, 'f', 2); }
+            this->encodeLog->Append(warning + "\n");
+        }
+
+        //プロセスの起動はスケジューラーが同時実行数に合わせて行う
+        for(const auto& encoder : enabledEncoders){
+            this->encodeScheduler->Enqueue({encoder, inputPath, metaData, i});
         }
 
         // ======== WAV ========
@@ -1048,8 +1496,21 @@ void MainWindow::WindowsEncodeProcess()
             if(this->ui->check_addTrackNo->isChecked()){
                 outputFile = wavOutputFullPath+"/"+QString("%1%2%3").arg(i + 1, this->ui->num_of_digit->value(), 10, '0').arg(this->ui->track_no_delimiter->text()).arg(metaData.title)+".wav";
             }
-            QFile::copy(inputPath, outputFile);
-            this->ui->logWidget->insertPlainText(tr("copy wave file : %1(%2/%3)\n").arg(metaData.title).arg(i+1).arg(this->numEncodingMusic));
+            wavCopies.append({inputPath, outputFile});
         }
     }
+
+    //GUIスレッドを止めないよう、コピーはエンコードと並行して行う
+    if(wavCopies.isEmpty() == false)
+    {
+        const bool allowHardLink = this->settings->IsWavHardLink();
+        this->wavCopyTimer.start();
+        this->wavCopyWatcher->setFuture(QtConcurrent::mapped(wavCopies, [allowHardLink](const std::pair<QString, QString>& copy){
+            return FastFileCopy::Copy(copy.first, copy.second, allowHardLink);
+        }));
+    }
+    this->isEncodeCanceled = false;
+    this->encodeCancelButton->setEnabled(true);
+    this->encodeCancelButton->show();
+    this->encodeScheduler->Start();
 }
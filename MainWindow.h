@@ -23,14 +23,28 @@
 #include <QLabel>
 #include <QLineEdit>
 #include "Encoder/EncoderInterface.h"
+#include "Encoder/EncodeScheduler.h"
+#include "Encoder/MultiOutputEncoder.h"
+#include "Encoder/LibavEncoder.h"
+#include "Encoder/FastFileCopy.h"
+#include "Encoder/EncoderProbe.h"
 #include "DialogAppSettings.h"
-#include <QUndoCommand>
+#include "MetadataTable.h"
+#include <QUndoStack>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QSet>
 
 namespace Ui {
 class MainWindow;
 }
 
-class MetadataTable;
+class EncodeLog;
+class TrackIngest;
+class TrackAnalysis;
+class SourceWatcher;
+class QProgressBar;
+class QPushButton;
 
 class MainWindow : public QMainWindow
 {
@@ -43,11 +57,14 @@ public:
     void dropEvent(QDropEvent *event) override;
     void dragEnterEvent(QDragEnterEvent *event) override;
 
+    //wav・フォルダは非同期に読み込み、読めた分から表に追加する
     void openFiles(QStringList pathList);
     void loadProjectFile(QString projFilePath);
 
 public slots:
     void Encode();
+    //指定した行だけをエンコードする
+    void EncodeTracks(std::vector<int> rows);
     void SaveProjectFile(QString saveFilePath);
     void CheckEnableEncodeButton();
 
@@ -56,23 +73,81 @@ private:
 
     void SaveSettingFile(QString key, QVariant value);
     void LoadSettingFile();
+    //ffmpegを確認済みならtrue 確認していなければ別スレッドで調べ始めてfalseを返す
     bool CheckEncoder();
-    void WindowsEncodeProcess();
+    //ffmpegの確認を別スレッドで行う 終わるまで出力のチェックを無効にし、結果はencoderCapabilitiesに入る
+    void ProbeEncoderAsync();
+    //ffmpegをダウンロードするか確認する 調べ直す必要があればtrue
+    bool RequestFFmpegDownload();
+    void ShowEncoderInfo();
+    void ApplyEncoderCapabilities(const EncoderProbe::Capabilities& capabilities);
+    //ffmpegがこのエンコーダーに対応していなければfalse 確認できていない場合はtrue
+    bool IsEncoderSupported(const EncoderInterface& encoder) const;
+    //ジャケットの準備をスレッドプールで始め、終わったらStartEncodeJobsでジョブを投入する
+    void EncodeProcess();
+    void StartEncodeJobs(const QString& embedArtworkPath);
+    //エンコードとwavのコピーが両方終わっていれば完了にする
+    void FinishEncodeIfIdle();
+    //ジョブ(エンコーダー・曲番号)ごとのログチャンネル 無ければ作る
+    int GetLogChannel(const EncoderInterface* encoder, int processNumber);
+    //曲ごとの進捗(全コーデックの平均)を行ヘッダーに表示する
+    void UpdateTrackProgress(const EncodeJob& job, double ratio);
+    AudioMetaData GetRowMetaData(int row) const;
+    //行ごとにTrackAnalysis::Taskの解析を行う isOnlyMissingがtrueの場合はまだ結果が無いものだけ 解析する曲が無ければfalse
+    bool StartTrackAnalysis(const std::map<int, int>& rowTasks, bool isOnlyMissing);
+    //[firstRow, lastRow]の行の波形を作る キャッシュがあればすぐに表示される
+    void StartWaveformAnalysis(int firstRow, int lastRow);
+    //トラック番号が決まっていない行は表の行番号を振る
+    void AppendTracks(std::vector<MetadataTable::Row> rows);
+    //縮小した画像を別スレッドで読み込んで表示する
+    void LoadArtwork(const QString& path);
+    //監視モードで、表の曲があるフォルダを監視対象にする
+    void UpdateWatchFolders();
+    //監視モードで変更を見つけた曲をエンコードする 読み込み中・エンコード中は終わってから行う
+    void StartAutoEncode();
+    ProjectMetaData GetProjectMetaData() const;
 
     void CreateBatchEntryWidgets();
 
     Ui::MainWindow *ui;
     MetadataTable* metadataTable;
+    QUndoStack* undoStack;
+    QAction* undoAction;
+    QAction* redoAction;
     QString artworkPath;
     QLabel* aboutLabel;
     QMenu* tableMenu;
     QMenu* artworkMenu;
     QString wavOutputPath;
     QString imageOutputPath;
-    int processedCount;
     int numEncodingMusic;
     int numEncodingFile;
     DialogAppSettings* settings;
+    EncodeScheduler* encodeScheduler;
+    QFutureWatcher<FastFileCopy::Result>* wavCopyWatcher;
+    QElapsedTimer wavCopyTimer;
+    TrackIngest* trackIngest;
+    TrackAnalysis* trackAnalysis;
+    //エンコード前の解析が終わったらエンコードする行
+    std::vector<int> analysisEncodeRows;
+    bool isEncodeAfterAnalysis;
+    QFutureWatcher<QImage>* artworkWatcher;
+    QFutureWatcher<QString>* artworkPrepareWatcher;
+    QProgressBar* ingestProgress;
+    QPushButton* ingestCancelButton;
+    QPushButton* encodeCancelButton;
+    bool isEncodeCanceled;
+    SourceWatcher* sourceWatcher;
+    QFutureWatcher<EncoderProbe::Capabilities>* encoderProbeWatcher;
+    EncoderProbe::Capabilities encoderCapabilities;
+    QString probedFFmpegPath;   //encoderCapabilitiesを調べた時の設定のパス
+    QSet<QString> autoEncodePaths;
+    std::vector<int> encodingRows;
+    EncodeLog* encodeLog;
+    std::map<std::pair<const EncoderInterface*, int>, int> logChannels;
+    //行 → エンコーダーごとの進捗 1曲のジョブだけを足せばよいよう行で引く
+    std::map<int, std::map<const EncoderInterface*, double>> jobRatios;
+    int numJobsPerTrack;
     QList<QWidget*> widgetListDisableDuringEncode;
     QString lastLoadProject;
     QString currentWorkDirectory;
@@ -80,6 +155,8 @@ private:
     QStringList batchParameters;
 
     bool showAtFirst;
+    bool isShowEncoderInfo;     //ffmpegの確認が終わったら結果を表示する
+    bool isProbeAfterDownload;  //ダウンロードの後の確認中
 
     struct EncoderComponents{
         std::shared_ptr<EncoderInterface> encoder;
@@ -89,6 +166,9 @@ private:
     };
 
     std::vector<EncoderComponents> encoderComponents;
+    std::shared_ptr<MultiOutputEncoder> multiOutputEncoder;
+    //プロセス内エンコードを選択した場合に、元のエンコーダーの代わりに投入する
+    std::map<const EncoderInterface*, std::shared_ptr<LibavEncoder>> inProcessEncoders;
 
 
 };
@@ -0,0 +1,590 @@
+#include "MetadataTable.h"
+
+#include <QBrush>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    QString& Field(AudioMetaData& metaData, int column)
+    {
+        switch(column)
+        {
+        case TableColumn::TrackNo:      return metaData.track_no;
+        case TableColumn::Title:        return metaData.title;
+        case TableColumn::Artist:       return metaData.artist;
+        case TableColumn::AlbumTitle:   return metaData.albumTitle;
+        case TableColumn::AlbumArtist:  return metaData.albumArtist;
+        case TableColumn::Composer:     return metaData.composer;
+        case TableColumn::Group:        return metaData.group;
+        case TableColumn::Genre:        return metaData.genre;
+        default:                        return metaData.year;
+        }
+    }
+}
+
+QString MetadataTable::FormatDuration(double seconds)
+{
+    const qint64 total = qint64(seconds + 0.5);
+    if(total >= 3600){
+        return QString("%1:%2:%3").arg(total / 3600).arg((total / 60) % 60, 2, 10, QChar('0')).arg(total % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(total / 60).arg(total % 60, 2, 10, QChar('0'));
+}
+
+MetadataTable::StringPool::StringPool()
+{
+    this->Clear();
+}
+
+MetadataTable::StringId MetadataTable::StringPool::Intern(const QString& text)
+{
+    if(text.isEmpty()){ return 0; }
+    auto itr = this->ids.constFind(text);
+    if(itr != this->ids.constEnd()){
+        return itr.value();
+    }
+    const auto id = static_cast<StringId>(this->strings.size());
+    this->strings.push_back(text);
+    this->ids.insert(text, id);
+    return id;
+}
+
+void MetadataTable::StringPool::Clear()
+{
+    this->strings.assign(1, QString());
+    this->ids.clear();
+}
+
+MetadataTable::MetadataTable(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+MetadataTable::~MetadataTable(){
+}
+
+int MetadataTable::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(this->sourcePaths.size());
+}
+
+int MetadataTable::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : InfoColumn::NumColumns;
+}
+
+QVariant MetadataTable::data(const QModelIndex& index, int role) const
+{
+    if(index.isValid() == false){ return QVariant(); }
+    const int row = index.row();
+    const int column = index.column();
+
+    switch(role)
+    {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return this->GetText(row, column);
+    case Qt::UserRole:
+        //タイトル列は元ファイル、長さの列は秒数、波形の列は縮小した波形
+        if(column == TableColumn::Title){ return this->sourcePaths[row]; }
+        if(column == InfoColumn::Duration){ return this->durations[row]; }
+        if(column == InfoColumn::Waveform){ return this->waveforms[row]; }
+        break;
+    case Qt::ToolTipRole:
+        if(column == InfoColumn::Format){ return this->pool.Get(this->formatToolTips[row]); }
+        if(column == InfoColumn::Loudness || column == InfoColumn::TruePeak)
+        {
+            const auto album = this->GetAlbumLoudness(row);
+            if(album.isValid == false){ break; }
+            return tr("Album : %1 LUFS / %2 dBTP").arg(album.integratedLufs, 0, 'f', 1).arg(20.0 * std::log10(album.truePeak), 0, 'f', 1);
+        }
+        if(column == InfoColumn::Clipping && this->clipping[row].isValid)
+        {
+            const auto& result = this->clipping[row];
+            QString text = tr("Sample peak : %1 dBFS\nInter-sample peak (estimated) : %2 dBTP\nClipped : %3 samples in %4 places")
+                               .arg(result.GetSamplePeakDb(), 0, 'f', 2).arg(result.GetInterSamplePeakDb(), 0, 'f', 2)
+                               .arg(result.clippedSamples).arg(result.clippedRuns);
+            if(result.IsAtRisk()){
+                text += tr("\nMay clip after AAC/MP3 encoding (%1 dB to reach %2 dBTP)").arg(result.GetLossyGainDb(), 0, 'f', 2).arg(ClipScanner::lossyPeakLimitDb, 0, 'f', 1);
+            }
+            return text;
+        }
+        break;
+    case Qt::ForegroundRole:
+        //非可逆圧縮でクリップする恐れのある曲は目立たせる
+        if(column == InfoColumn::Clipping && this->clipping[row].IsAtRisk()){ return QBrush(Qt::red); }
+        break;
+    case Qt::TextAlignmentRole:
+        if(IsEditableColumn(column) == false){ return int(Qt::AlignRight | Qt::AlignVCenter); }
+        break;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+bool MetadataTable::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if(index.isValid() == false || role != Qt::EditRole || IsEditableColumn(index.column()) == false){
+        return false;
+    }
+    emit this->editRequested(index, value.toString());
+    return true;
+}
+
+Qt::ItemFlags MetadataTable::flags(const QModelIndex& index) const
+{
+    if(index.isValid() == false){ return Qt::NoItemFlags; }
+    Qt::ItemFlags result = Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+    if(IsEditableColumn(index.column())){
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+QVariant MetadataTable::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal)
+    {
+        if(role != Qt::DisplayRole){ return QVariant(); }
+        if(IsEditableColumn(section)){ return ProjectDefines::headerItems.value(section); }
+        return ProjectDefines::infoHeaderItems.value(section - TableColumn::ALL);
+    }
+
+    if(section < 0 || section >= this->rowCount()){ return QVariant(); }
+    const float ratio = this->progressRatios[section];
+    const QString& verifyError = this->verifyErrors[section];
+    if(role == Qt::DisplayRole){
+        if(ratio >= 0.0f){ return QString("%1%").arg(int(ratio * 100.0f)); }
+        return verifyError.isEmpty() ? QString::number(section + 1) : QString("%1 !").arg(section + 1);
+    }
+    if(role == Qt::ToolTipRole){
+        const QString toolTip = this->progressToolTips.value(section);
+        if(verifyError.isEmpty()){ return toolTip; }
+        return toolTip.isEmpty() ? verifyError : toolTip + "\n" + verifyError;
+    }
+    if(role == Qt::ForegroundRole && verifyError.isEmpty() == false){
+        return QBrush(Qt::red);
+    }
+    return QVariant();
+}
+
+void MetadataTable::AppendRows(std::vector<Row> rows)
+{
+    if(rows.empty()){ return; }
+    const int first = this->rowCount();
+    const int last = first + static_cast<int>(rows.size()) - 1;
+
+    this->beginInsertRows(QModelIndex(), first, last);
+    for(auto& column : this->columns){
+        column.reserve(column.size() + rows.size());
+    }
+    for(auto& row : rows)
+    {
+        for(int column=0; column<TableColumn::ALL; ++column){
+            this->columns[column].push_back(this->pool.Intern(Field(row.metaData, column)));
+        }
+        this->sourcePaths.push_back(std::move(row.metaData.sourcePath));
+
+        this->durations.push_back(row.metaData.durationSeconds);
+        this->sampleRates.push_back(0);
+        this->numChannels.push_back(0);
+        this->formats.push_back(0);
+        this->formatToolTips.push_back(0);
+        this->loudness.emplace_back();
+        this->clipping.emplace_back();
+        this->waveforms.emplace_back();
+        this->progressRatios.push_back(-1.0f);
+        this->verifyErrors.emplace_back();
+        if(row.hasWaveInfo){
+            this->StoreWaveInfo(static_cast<int>(this->sourcePaths.size()) - 1, row.waveInfo);
+        }
+    }
+    this->ResetAlbumLoudness();
+    this->endInsertRows();
+}
+
+void MetadataTable::SetWaveInfo(int row, const WaveFile::Info* info)
+{
+    if(row < 0 || row >= this->rowCount()){ return; }
+    if(info != nullptr){
+        this->StoreWaveInfo(row, *info);
+    }
+    else{
+        this->sampleRates[row] = 0;
+        this->numChannels[row] = 0;
+        this->formats[row] = 0;
+        this->formatToolTips[row] = 0;
+    }
+    //中身が変わっているかもしれないので測り直す
+    this->loudness[row] = LoudnessAnalyzer::Result();
+    this->clipping[row] = ClipScanner::Result();
+    this->waveforms[row] = QByteArray();
+    this->ResetAlbumLoudness();
+    emit this->dataChanged(this->index(row, InfoColumn::Duration), this->index(row, InfoColumn::NumColumns - 1));
+}
+
+void MetadataTable::StoreWaveInfo(int row, const WaveFile::Info& info)
+{
+    this->durations[row] = info.GetDurationSeconds();
+    this->sampleRates[row] = info.sampleRate;
+    this->numChannels[row] = quint16(info.numChannels);
+    this->formats[row] = this->pool.Intern(info.GetFormatText() + (info.isRf64 ? " (RF64)" : ""));
+
+    //Broadcast Waveの情報はツールチップで確認できるようにする
+    QStringList bext;
+    if(info.bextDescription.isEmpty() == false){ bext << tr("Description : %1").arg(info.bextDescription); }
+    if(info.bextOriginator.isEmpty() == false){ bext << tr("Originator : %1").arg(info.bextOriginator); }
+    if(info.bextOriginationDate.isEmpty() == false){ bext << tr("Date : %1").arg(info.bextOriginationDate); }
+    this->formatToolTips[row] = this->pool.Intern(bext.join('\n'));
+}
+
+std::vector<MetadataTable::RowRange> MetadataTable::ToRanges(std::vector<int> rows)
+{
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    std::vector<RowRange> ranges;
+    for(int row : rows)
+    {
+        if(ranges.empty() == false && ranges.back().last + 1 == row){
+            ranges.back().last = row;
+        }
+        else{
+            ranges.push_back({row, row});
+        }
+    }
+    return ranges;
+}
+
+MetadataTable::RowBlock MetadataTable::TakeRows(std::vector<int> rows)
+{
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [this](int row){ return row < 0 || row >= this->rowCount(); }), rows.end());
+    const auto ranges = ToRanges(std::move(rows));
+
+    RowBlock block;
+    for(const auto& range : ranges)
+    {
+        for(int row=range.first; row<=range.last; ++row)
+        {
+            block.rows.push_back(row);
+            for(int column=0; column<TableColumn::ALL; ++column){
+                block.columns[column].push_back(this->pool.Get(this->columns[column][row]));
+            }
+            block.sourcePaths.push_back(this->sourcePaths[row]);
+            block.durations.push_back(this->durations[row]);
+            block.sampleRates.push_back(this->sampleRates[row]);
+            block.numChannels.push_back(this->numChannels[row]);
+            block.formats.push_back(this->pool.Get(this->formats[row]));
+            block.formatToolTips.push_back(this->pool.Get(this->formatToolTips[row]));
+            block.loudness.push_back(this->loudness[row]);
+            block.clipping.push_back(this->clipping[row]);
+            block.waveforms.push_back(this->waveforms[row]);
+        }
+    }
+
+    //後ろの範囲から消せば、前の行番号はずれない
+    auto Erase = [](auto& vector, const RowRange& range){
+        vector.erase(vector.begin() + range.first, vector.begin() + range.last + 1);
+    };
+    for(auto itr = ranges.rbegin(); itr != ranges.rend(); ++itr)
+    {
+        this->beginRemoveRows(QModelIndex(), itr->first, itr->last);
+        for(auto& column : this->columns){ Erase(column, *itr); }
+        Erase(this->sourcePaths, *itr);
+        Erase(this->durations, *itr);
+        Erase(this->sampleRates, *itr);
+        Erase(this->numChannels, *itr);
+        Erase(this->formats, *itr);
+        Erase(this->formatToolTips, *itr);
+        Erase(this->loudness, *itr);
+        Erase(this->clipping, *itr);
+        Erase(this->waveforms, *itr);
+        Erase(this->progressRatios, *itr);
+        Erase(this->verifyErrors, *itr);
+        this->endRemoveRows();
+    }
+    this->progressToolTips.clear();
+    this->ResetAlbumLoudness();
+    return block;
+}
+
+void MetadataTable::InsertRows(const RowBlock& block)
+{
+    //元の行番号の昇順に差し込めば、取り出す前と同じ並びになる
+    const auto ranges = ToRanges(block.rows);
+    int source = 0;
+    for(const auto& range : ranges)
+    {
+        const int count = range.last - range.first + 1;
+        auto Insert = [&](auto& vector, auto&& values){
+            vector.insert(vector.begin() + range.first, values.begin() + source, values.begin() + source + count);
+        };
+        this->beginInsertRows(QModelIndex(), range.first, range.last);
+        for(int column=0; column<TableColumn::ALL; ++column)
+        {
+            std::vector<StringId> ids;
+            ids.reserve(count);
+            for(int i=0; i<count; ++i){ ids.push_back(this->pool.Intern(block.columns[column][source + i])); }
+            this->columns[column].insert(this->columns[column].begin() + range.first, ids.begin(), ids.end());
+        }
+        Insert(this->sourcePaths, block.sourcePaths);
+        Insert(this->durations, block.durations);
+        Insert(this->sampleRates, block.sampleRates);
+        Insert(this->numChannels, block.numChannels);
+        std::vector<StringId> formatIds;
+        std::vector<StringId> toolTipIds;
+        for(int i=0; i<count; ++i)
+        {
+            formatIds.push_back(this->pool.Intern(block.formats[source + i]));
+            toolTipIds.push_back(this->pool.Intern(block.formatToolTips[source + i]));
+        }
+        Insert(this->formats, formatIds);
+        Insert(this->formatToolTips, toolTipIds);
+        Insert(this->loudness, block.loudness);
+        Insert(this->clipping, block.clipping);
+        Insert(this->waveforms, block.waveforms);
+        this->progressRatios.insert(this->progressRatios.begin() + range.first, count, -1.0f);
+        this->verifyErrors.insert(this->verifyErrors.begin() + range.first, count, QString());
+        this->endInsertRows();
+        source += count;
+    }
+    this->ResetAlbumLoudness();
+}
+
+void MetadataTable::Clear()
+{
+    this->beginResetModel();
+    for(auto& column : this->columns){ column.clear(); }
+    this->sourcePaths.clear();
+    this->durations.clear();
+    this->sampleRates.clear();
+    this->numChannels.clear();
+    this->formats.clear();
+    this->formatToolTips.clear();
+    this->loudness.clear();
+    this->clipping.clear();
+    this->waveforms.clear();
+    this->albumLoudness.clear();
+    this->progressRatios.clear();
+    this->progressToolTips.clear();
+    this->verifyErrors.clear();
+    this->pool.Clear();
+    this->endResetModel();
+}
+
+AudioMetaData MetadataTable::GetMetaData(int row) const
+{
+    AudioMetaData metaData;
+    if(row < 0 || row >= this->rowCount()){ return metaData; }
+    for(int column=0; column<TableColumn::ALL; ++column){
+        Field(metaData, column) = this->pool.Get(this->columns[column][row]);
+    }
+    metaData.sourcePath = this->sourcePaths[row];
+    metaData.durationSeconds = this->durations[row];
+    return metaData;
+}
+
+QString MetadataTable::GetText(int row, int column) const
+{
+    if(row < 0 || row >= this->rowCount()){ return QString(); }
+    if(IsEditableColumn(column)){
+        return this->pool.Get(this->columns[column][row]);
+    }
+    return this->GetInfoText(row, column);
+}
+
+QString MetadataTable::GetInfoText(int row, int column) const
+{
+    if(this->sampleRates[row] <= 0){ return "-"; }
+    switch(column)
+    {
+    case InfoColumn::Duration:      return FormatDuration(this->durations[row]);
+    case InfoColumn::SampleRate:    return QString::number(this->sampleRates[row]);
+    case InfoColumn::Format:        return this->pool.Get(this->formats[row]);
+    case InfoColumn::Channels:      return QString::number(this->numChannels[row]);
+    case InfoColumn::Loudness:
+    case InfoColumn::LoudnessRange:
+    case InfoColumn::TruePeak:      return this->GetLoudnessText(row, column);
+    //クリップした箇所の数
+    case InfoColumn::Clipping:      return this->clipping[row].isValid ? QString::number(this->clipping[row].clippedRuns) : QString("-");
+    //波形はデリゲートが描くので、文字は作るまでの"-"だけ
+    case InfoColumn::Waveform:      return this->waveforms[row].isEmpty() ? QString("-") : QString();
+    default:                        return QString();
+    }
+}
+
+QString MetadataTable::GetLoudnessText(int row, int column) const
+{
+    const auto& result = this->loudness[row];
+    if(result.isValid == false){ return "-"; }
+    //無音の曲は-inf
+    auto Format = [](double value){ return std::isfinite(value) ? QString::number(value, 'f', 1) : QString("-inf"); };
+    switch(column)
+    {
+    case InfoColumn::Loudness:      return Format(result.integratedLufs);
+    case InfoColumn::LoudnessRange: return Format(result.loudnessRange);
+    case InfoColumn::TruePeak:      return Format(result.GetTruePeakDb());
+    default:                        return QString();
+    }
+}
+
+void MetadataTable::SetLoudness(const QString& sourcePath, const LoudnessAnalyzer::Result& result)
+{
+    for(int row=0; row<this->rowCount(); ++row)
+    {
+        if(this->sourcePaths[row] != sourcePath){ continue; }
+        this->loudness[row] = result;
+        emit this->dataChanged(this->index(row, InfoColumn::Loudness), this->index(row, InfoColumn::TruePeak));
+    }
+    this->ResetAlbumLoudness();
+}
+
+void MetadataTable::SetClipping(const QString& sourcePath, const ClipScanner::Result& result)
+{
+    for(int row=0; row<this->rowCount(); ++row)
+    {
+        if(this->sourcePaths[row] != sourcePath){ continue; }
+        this->clipping[row] = result;
+        emit this->dataChanged(this->index(row, InfoColumn::Clipping), this->index(row, InfoColumn::Clipping));
+    }
+}
+
+void MetadataTable::SetWaveform(const QString& sourcePath, const QByteArray& peaks)
+{
+    for(int row=0; row<this->rowCount(); ++row)
+    {
+        if(this->sourcePaths[row] != sourcePath){ continue; }
+        this->waveforms[row] = peaks;
+        emit this->dataChanged(this->index(row, InfoColumn::Waveform), this->index(row, InfoColumn::Waveform));
+    }
+}
+
+MetadataTable::AlbumLoudness MetadataTable::GetAlbumLoudness(int row) const
+{
+    if(row < 0 || row >= this->rowCount()){ return {}; }
+    const StringId album = this->columns[TableColumn::AlbumTitle][row];
+    auto itr = this->albumLoudness.constFind(album);
+    if(itr != this->albumLoudness.constEnd()){ return *itr; }
+
+    AlbumLoudness result;
+    result.isValid = true;
+    std::vector<const std::vector<float>*> blockLists;
+    const auto& albumIds = this->columns[TableColumn::AlbumTitle];
+    for(int i=0; i<this->rowCount(); ++i)
+    {
+        if(albumIds[i] != album){ continue; }
+        if(this->loudness[i].isValid == false){
+            result.isValid = false;
+            break;
+        }
+        blockLists.push_back(&this->loudness[i].blockEnergies);
+        result.truePeak = std::max(result.truePeak, this->loudness[i].truePeak);
+    }
+    if(result.isValid){
+        result.integratedLufs = LoudnessAnalyzer::GetGatedLoudness(blockLists);
+    }
+    this->albumLoudness.insert(album, result);
+    return result;
+}
+
+void MetadataTable::ResetAlbumLoudness()
+{
+    this->albumLoudness.clear();
+}
+
+MetadataTable::TextRuns MetadataTable::GetTexts(int column, const std::vector<RowRange>& ranges) const
+{
+    TextRuns runs;
+    if(IsEditableColumn(column) == false){ return runs; }
+    const auto& values = this->columns[column];
+    int offset = 0;
+    StringId current = 0;
+    for(const auto& range : ranges)
+    {
+        for(int row=range.first; row<=range.last; ++row, ++offset)
+        {
+            if(runs.empty() || values[row] != current)
+            {
+                current = values[row];
+                runs.emplace_back(offset, this->pool.Get(current));
+            }
+        }
+    }
+    return runs;
+}
+
+void MetadataTable::SetTexts(int column, const std::vector<RowRange>& ranges, const QString& text)
+{
+    this->SetTexts(column, ranges, TextRuns{{0, text}});
+}
+
+void MetadataTable::SetTexts(int column, const std::vector<RowRange>& ranges, const TextRuns& runs)
+{
+    if(IsEditableColumn(column) == false || ranges.empty() || runs.empty()){ return; }
+    auto& values = this->columns[column];
+    int top = this->rowCount();
+    int bottom = -1;
+    int offset = 0;
+    std::size_t run = 0;
+    StringId id = this->pool.Intern(runs[0].second);
+    for(const auto& range : ranges)
+    {
+        for(int row=range.first; row<=range.last; ++row, ++offset)
+        {
+            if(row < 0 || row >= this->rowCount()){ continue; }
+            while(run + 1 < runs.size() && runs[run + 1].first <= offset){
+                id = this->pool.Intern(runs[++run].second);
+            }
+            values[row] = id;
+            top = std::min(top, row);
+            bottom = std::max(bottom, row);
+        }
+    }
+    if(bottom < 0){ return; }
+    if(column == TableColumn::AlbumTitle){ this->ResetAlbumLoudness(); }
+    emit this->dataChanged(this->index(top, column), this->index(bottom, column), {Qt::DisplayRole, Qt::EditRole});
+}
+
+void MetadataTable::SetRowProgress(int row, double ratio, const QString& toolTip)
+{
+    if(row < 0 || row >= this->rowCount()){ return; }
+    this->progressRatios[row] = float(ratio);
+    if(toolTip.isEmpty()){
+        this->progressToolTips.remove(row);
+    }
+    else{
+        this->progressToolTips.insert(row, toolTip);
+    }
+    emit this->headerDataChanged(Qt::Vertical, row, row);
+}
+
+void MetadataTable::ClearProgress()
+{
+    if(this->rowCount() == 0){ return; }
+    std::fill(this->progressRatios.begin(), this->progressRatios.end(), -1.0f);
+    this->progressToolTips.clear();
+    emit this->headerDataChanged(Qt::Vertical, 0, this->rowCount() - 1);
+}
+
+void MetadataTable::AddVerifyError(int row, const QString& message)
+{
+    if(row < 0 || row >= this->rowCount() || message.isEmpty()){ return; }
+    QString& error = this->verifyErrors[row];
+    error = error.isEmpty() ? message : error + "\n" + message;
+    emit this->headerDataChanged(Qt::Vertical, row, row);
+}
+
+void MetadataTable::ClearVerifyErrors()
+{
+    if(this->HasVerifyErrors() == false){ return; }
+    std::fill(this->verifyErrors.begin(), this->verifyErrors.end(), QString());
+    emit this->headerDataChanged(Qt::Vertical, 0, this->rowCount() - 1);
+}
+
+bool MetadataTable::HasVerifyErrors() const
+{
+    return std::any_of(this->verifyErrors.begin(), this->verifyErrors.end(), [](const QString& error){ return error.isEmpty() == false; });
+}
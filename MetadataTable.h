@@ -0,0 +1,165 @@
+#ifndef METADATATABLE_H
+#define METADATATABLE_H
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "AudioMetaData.hpp"
+#include "ProjectDefines.hpp"
+#include "Encoder/WaveFile.h"
+#include "Encoder/LoudnessAnalyzer.h"
+#include "Encoder/ClipScanner.h"
+
+//曲のメタデータを表示・編集するテーブルのモデル
+//数千曲のプロジェクトでも軽く扱えるよう、列ごとの配列に文字列のIDを持ち、
+//アーティスト名やアルバム名のように同じ値が並ぶ文字列は1つだけ保持する
+class MetadataTable : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    //1行分 追加時にまとめて渡す
+    struct Row
+    {
+        AudioMetaData metaData;
+        bool hasWaveInfo = false;
+        WaveFile::Info waveInfo;
+    };
+
+    //連続した行の範囲 [first, last]
+    struct RowRange
+    {
+        int first = 0;
+        int last = 0;
+    };
+    //範囲内の文字列を、値が変わる位置(範囲を先頭から数えた行数)と値の組だけで表したもの
+    //同じ値が続く列なら要素は1つで済む
+    using TextRuns = std::vector<std::pair<int, QString>>;
+
+    //TakeRowsで取り出した行 InsertRowsで元の位置に戻せる
+    class RowBlock
+    {
+        friend class MetadataTable;
+        std::vector<int> rows;  //昇順
+        std::array<std::vector<QString>, TableColumn::ALL> columns;
+        std::vector<QString> sourcePaths;
+        std::vector<double> durations;
+        std::vector<int> sampleRates;
+        std::vector<quint16> numChannels;
+        std::vector<QString> formats;
+        std::vector<QString> formatToolTips;
+        std::vector<LoudnessAnalyzer::Result> loudness;
+        std::vector<ClipScanner::Result> clipping;
+        std::vector<QByteArray> waveforms;
+    };
+
+    //同じアルバム名の曲をまとめて測った値 未解析の曲が含まれる場合はisValidがfalse
+    struct AlbumLoudness
+    {
+        bool isValid = false;
+        double integratedLufs = 0.0;
+        double truePeak = 0.0;
+    };
+
+    explicit MetadataTable(QObject* parent = nullptr);
+    ~MetadataTable() override;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    //ビューでの編集は書き換えずにeditRequestedで通知する
+    //選択範囲への一括反映は受け取った側がSetTextsで行う
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void AppendRows(std::vector<Row> rows);
+    //rowsは順不同・重複可 連続した行ごとにまとめて削除する
+    RowBlock TakeRows(std::vector<int> rows);
+    void InsertRows(const RowBlock& block);
+    void Clear();
+
+    AudioMetaData GetMetaData(int row) const;
+    //元のwavが差し替えられた時に読み直した値を入れる 読めなかった場合はinfoにnullptr
+    void SetWaveInfo(int row, const WaveFile::Info* info);
+    QString GetText(int row, int column) const;
+
+    //sourcePathが一致する全ての行に解析結果を入れる 元のwavが差し替えられた場合はSetWaveInfoで消える
+    void SetLoudness(const QString& sourcePath, const LoudnessAnalyzer::Result& result);
+    const LoudnessAnalyzer::Result& GetLoudness(int row) const { return this->loudness[row]; }
+    AlbumLoudness GetAlbumLoudness(int row) const;
+    void SetClipping(const QString& sourcePath, const ClipScanner::Result& result);
+    const ClipScanner::Result& GetClipping(int row) const { return this->clipping[row]; }
+    //WaveformPeaksの形式 波形の列のQt::UserRoleでも取り出せる
+    void SetWaveform(const QString& sourcePath, const QByteArray& peaks);
+    const QByteArray& GetWaveform(int row) const { return this->waveforms[row]; }
+    static bool IsEditableColumn(int column) { return 0 <= column && column < TableColumn::ALL; }
+    //長さ・残り時間の表示用 "m:ss" または "h:mm:ss"
+    static QString FormatDuration(double seconds);
+
+    //rowsは順不同・重複可
+    static std::vector<RowRange> ToRanges(std::vector<int> rows);
+    TextRuns GetTexts(int column, const std::vector<RowRange>& ranges) const;
+    //指定した列の範囲をまとめて書き換え、dataChangedは全体を囲む範囲で1回だけ発行する
+    //編集できない列は無視する
+    void SetTexts(int column, const std::vector<RowRange>& ranges, const QString& text);
+    void SetTexts(int column, const std::vector<RowRange>& ranges, const TextRuns& runs);
+
+    //エンコード中の進捗を行ヘッダーに表示する ratioが負の場合は行番号に戻す
+    void SetRowProgress(int row, double ratio, const QString& toolTip = QString());
+    void ClearProgress();
+    //出力の検査で問題が見つかった行は行ヘッダーを赤くし、ツールチップに内容を出す 同じ行に何度か呼ぶと追記する
+    void AddVerifyError(int row, const QString& message);
+    void ClearVerifyErrors();
+    bool HasVerifyErrors() const;
+
+signals:
+    void editRequested(const QModelIndex& index, const QString& text);
+
+private:
+    using StringId = quint32;
+
+    //同じ文字列を1つにまとめる ID 0は空文字列
+    class StringPool
+    {
+    public:
+        StringPool();
+        StringId Intern(const QString& text);
+        const QString& Get(StringId id) const { return strings[id]; }
+        void Clear();
+    private:
+        std::vector<QString> strings;
+        QHash<QString, StringId> ids;
+    };
+
+    QString GetInfoText(int row, int column) const;
+    void StoreWaveInfo(int row, const WaveFile::Info& info);
+    QString GetLoudnessText(int row, int column) const;
+    void ResetAlbumLoudness();
+
+    StringPool pool;
+    std::array<std::vector<StringId>, TableColumn::ALL> columns;
+    std::vector<QString> sourcePaths;
+    //wavのヘッダーから読んだ値 読めなかった行はsampleRateが0
+    std::vector<double> durations;
+    std::vector<int> sampleRates;
+    std::vector<quint16> numChannels;
+    std::vector<StringId> formats;
+    std::vector<StringId> formatToolTips;
+    std::vector<LoudnessAnalyzer::Result> loudness;
+    std::vector<ClipScanner::Result> clipping;
+    std::vector<QByteArray> waveforms;
+    //アルバム名のIDごとに、必要になった時に計算して取っておく 行・アルバム名・解析結果が変わったら消す
+    mutable QHash<StringId, AlbumLoudness> albumLoudness;
+    //エンコード中の進捗 -1は表示しない
+    std::vector<float> progressRatios;
+    QHash<int, QString> progressToolTips;
+    //出力の検査で見つかった問題 問題の無い行は空
+    std::vector<QString> verifyErrors;
+};
+
+#endif // METADATATABLE_H
@@ -12,8 +12,59 @@ namespace ProjectDefines
 
     static constexpr char settingOutputFolder[]     = "OutputFolder";
     static const QStringList headerItems = {"No.", "Title", "Artist", "AlbumTitle", "AlbumArtist", "Composer", "Group", "Genre", "Year"};
+    static const QStringList infoHeaderItems = {"Duration", "SampleRate", "Format", "Ch", "LUFS", "LRA", "dBTP", "Clip", "Waveform"};
 
-    static QString settingFilePath;
+    static constexpr char settingMaxParallelJobs[]  = "maxParallelJobs";
+    static constexpr char settingFanOutEncode[]     = "fanOutEncode";
+    static constexpr char settingBatchEncode[]      = "batchEncode";
+    static constexpr char settingSkipUpToDate[]     = "skipUpToDate";
+    static constexpr char settingArtworkEmbedSize[] = "artworkEmbedSize";
+    static constexpr char settingInProcessEncode[]  = "inProcessEncode";
+    static constexpr char settingWavHardLink[]      = "wavHardLink";
+    static constexpr char settingEncodeCostFactors[] = "encodeCostFactors";
+    static constexpr char settingFfmpegZipUrl[]     = "ffmpegZipUrl";
+    static constexpr char settingFfmpegHashUrl[]    = "ffmpegHashUrl";
+    static constexpr char settingEncoderProbe[]     = "encoderProbe";
+    static constexpr char settingWriteLoudnessTags[] = "writeLoudnessTags";
+    static constexpr char settingClipScan[]         = "clipScan";
+    static constexpr char settingLossyPreGain[]     = "lossyPreGain";
+    static constexpr char settingVerifyOutputs[]    = "verifyOutputs";
+
+    //翻訳単位ごとに別の変数にならないようinlineにする
+    inline QString settingFilePath;
+};
+
+//テーブルの列 プロジェクトファイルもこの順で保存する
+enum TableColumn
+{
+    TrackNo = 0,
+    Title,
+    Artist,
+    AlbumTitle,
+    AlbumArtist,
+    Composer,
+    Group,
+    Genre,
+    Year,
+    ALL
+};
+
+//wavのヘッダーから読み取って表示する列 編集できず、プロジェクトファイルにも保存しない
+enum InfoColumn
+{
+    Duration = TableColumn::ALL,
+    SampleRate,
+    Format,
+    Channels,
+    //ラウドネス解析の結果 解析するまでは"-"
+    Loudness,
+    LoudnessRange,
+    TruePeak,
+    //クリップの検査結果 検査するまでは"-"
+    Clipping,
+    //波形 WaveformDelegateで描く
+    Waveform,
+    NumColumns
 };
 
 #endif // PROJECTDEFINES_HPP
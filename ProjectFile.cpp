@@ -0,0 +1,139 @@
+#include "ProjectFile.h"
+#include "ProjectDefines.hpp"
+
+#include <QFile>
+#include <QStringList>
+#include <QVariant>
+
+namespace ProjectFile
+{
+
+bool Load(const QString& projFilePath, ProjectMetaData& project)
+{
+    if(projFilePath.isEmpty()){ return false; }
+
+    QFile file(projFilePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+
+    auto data = file.readAll();
+    auto strList = QString::fromLocal8Bit(data).split(",");
+    //バージョン・出力先・アートワークは必須
+    if(strList.size() < 3){ return false; }
+
+    project = ProjectMetaData();
+    project.projectPath = projFilePath;
+
+    int index = 0;
+    auto projVersion = strList[index++].toInt();
+    project.outputFolderPath = strList[index++];
+    project.artworkPath = strList[index++];
+
+    auto Next = [&](){ return index < strList.size() ? strList[index++] : QString(); };
+    if(0x010001 <= projVersion){
+        project.isAddTrackNo = QVariant(Next()).toBool();
+        project.trackNoDelimiter = Next();
+        project.numOfDigit = Next().toInt();
+    }
+    if(0x010002 <= projVersion){
+        project.filenameDelimiter = Next();
+    }
+    if(0x010003 <= projVersion)
+    {
+        project.isAddTrackNo = QVariant(Next()).toBool();
+        project.numOfDigit = Next().toInt();
+        project.trackNoDelimiter = Next();
+    }
+
+    const int size = strList.size();
+    while(index + ALL <= size)
+    {
+        AudioMetaData metaData;
+        metaData.track_no    = strList[index + TableColumn::TrackNo];
+        metaData.artist      = strList[index + TableColumn::Artist];
+        metaData.albumTitle  = strList[index + TableColumn::AlbumTitle];
+        metaData.albumArtist = strList[index + TableColumn::AlbumArtist];
+        metaData.composer    = strList[index + TableColumn::Composer];
+        metaData.group       = strList[index + TableColumn::Group];
+        metaData.genre       = strList[index + TableColumn::Genre];
+        metaData.year        = strList[index + TableColumn::Year];
+        metaData.artworkPath = project.artworkPath;
+
+        //タイトル列には元ファイルのパスが保存されている
+        auto path = strList[index + TableColumn::Title];
+        auto title = path.mid(path.lastIndexOf("/")+1).section(".", 0, 0);
+        QStringList metaDatas = title.split('_');
+        if(metaDatas.size() > 1){
+            title = metaDatas[1];
+        }
+        metaData.title = title;
+        metaData.sourcePath = path;
+
+        project.audioMetaData.emplace_back(std::move(metaData));
+        index += ALL;
+    }
+
+    return true;
+}
+
+bool Save(const QString& saveFilePath, const ProjectMetaData& project)
+{
+    // ### Ver.1.0.0
+    // project version
+    // output path
+    // image path
+
+    // ### Ver.1.0.1
+    // addTrackNo Flag
+    // delimiter
+    // fill digit
+
+    // ### Ver.1.0.2
+    // filenameDelimiter
+
+    // ### Common
+    // no., title, artist, albumtitle...
+    // no., title, artist, albumtitle...
+    if(saveFilePath.isEmpty()){ return false; }
+
+    QStringList tableList;
+    tableList.append(QString::number(ProjectDefines::projectVersionNum));
+    tableList.append(project.outputFolderPath);
+    tableList.append(project.artworkPath);
+
+    // ### Ver.1.0.1
+    tableList.append(QVariant(project.isAddTrackNo).toString());
+    tableList.append(project.trackNoDelimiter);
+    tableList.append(QString::number(project.numOfDigit));
+
+    // ### Ver.1.0.2
+    tableList.append(project.filenameDelimiter);
+
+    // ### Ver.1.0.3
+    tableList.append(QVariant(project.isAddTrackNo).toString());
+    tableList.append(QString::number(project.numOfDigit));
+    tableList.append(project.trackNoDelimiter);
+
+    // ### Common
+    for(const auto& metaData : project.audioMetaData)
+    {
+        QStringList row;
+        row.resize(ALL);
+        row[TableColumn::TrackNo]     = metaData.track_no;
+        row[TableColumn::Title]       = metaData.sourcePath;
+        row[TableColumn::Artist]      = metaData.artist;
+        row[TableColumn::AlbumTitle]  = metaData.albumTitle;
+        row[TableColumn::AlbumArtist] = metaData.albumArtist;
+        row[TableColumn::Composer]    = metaData.composer;
+        row[TableColumn::Group]       = metaData.group;
+        row[TableColumn::Genre]       = metaData.genre;
+        row[TableColumn::Year]        = metaData.year;
+        tableList.append(row);
+    }
+
+    QFile file(saveFilePath);
+    if(file.open(QFile::WriteOnly) == false){ return false; }
+    file.write(tableList.join(',').toLocal8Bit());
+    return true;
+}
+
+}
@@ -0,0 +1,14 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QString>
+#include "AudioMetaData.hpp"
+
+//.encprojの読み書き ウィジェットに依存しないため、GUI無しのバッチ処理からも使用する
+namespace ProjectFile
+{
+    bool Load(const QString& projFilePath, ProjectMetaData& project);
+    bool Save(const QString& saveFilePath, const ProjectMetaData& project);
+}
+
+#endif // PROJECTFILE_H
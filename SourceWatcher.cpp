@@ -0,0 +1,152 @@
+#include "SourceWatcher.h"
+#include "Encoder/WaveFile.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+SourceWatcher::SourceWatcher(QObject* parent)
+    : QObject(parent)
+{
+    this->debounceTimer.setSingleShot(true);
+    this->debounceTimer.setInterval(debounceMs);
+    connect(&this->debounceTimer, &QTimer::timeout, this, &SourceWatcher::CheckPendingFiles);
+
+    //ファイルを別名で書いてから置き換えるDAWもあるので、フォルダとファイルの両方を監視する
+    connect(&this->watcher, &QFileSystemWatcher::directoryChanged, this, &SourceWatcher::ScanFolder);
+    connect(&this->watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString& filePath){
+        this->ScanFolder(QFileInfo(filePath).absolutePath());
+    });
+}
+
+void SourceWatcher::SetFolders(const QStringList& folders)
+{
+    //監視をやり直すと待っている変更を失うので、増えた・減ったフォルダだけを付け外しする
+    const QStringList currentFolders = this->watcher.directories();
+    for(const auto& folder : currentFolders)
+    {
+        if(folders.contains(folder)){ continue; }
+        this->watcher.removePath(folder);
+        auto IsInFolder = [&folder](const QString& file){ return QFileInfo(file).absolutePath() == folder; };
+        for(const auto& file : this->watcher.files()){
+            if(IsInFolder(file)){ this->watcher.removePath(file); }
+        }
+        auto IsEntryInFolder = [&](const std::pair<const QString&, FileState&>& entry){ return IsInFolder(entry.first); };
+        this->knownFiles.removeIf(IsEntryInFolder);
+        this->pendingFiles.removeIf(IsEntryInFolder);
+    }
+    for(const auto& folder : folders)
+    {
+        if(currentFolders.contains(folder) || QFileInfo(folder).isDir() == false){ continue; }
+        this->watcher.addPath(folder);
+        const auto files = GetWavFiles(folder);
+        for(const auto& file : files){
+            this->knownFiles.insert(file, GetState(file));
+        }
+        if(files.isEmpty() == false){
+            this->watcher.addPaths(files);
+        }
+    }
+}
+
+void SourceWatcher::Stop()
+{
+    this->debounceTimer.stop();
+    if(this->watcher.files().isEmpty() == false){ this->watcher.removePaths(this->watcher.files()); }
+    if(this->watcher.directories().isEmpty() == false){ this->watcher.removePaths(this->watcher.directories()); }
+    this->knownFiles.clear();
+    this->pendingFiles.clear();
+}
+
+SourceWatcher::FileState SourceWatcher::GetState(const QString& filePath)
+{
+    const QFileInfo info(filePath);
+    FileState state;
+    if(info.exists()){
+        state.size = info.size();
+        state.lastModified = info.lastModified().toMSecsSinceEpoch();
+    }
+    return state;
+}
+
+QStringList SourceWatcher::GetWavFiles(const QString& folder)
+{
+    QDir dir(folder);
+    QStringList files;
+    for(const auto& name : dir.entryList({"*.wav"}, QDir::Files)){
+        files.append(dir.filePath(name));
+    }
+    return files;
+}
+
+bool SourceWatcher::IsWriteFinished(const QString& filePath)
+{
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+    const QByteArray header = file.read(12);
+    if(header.size() < 12){ return false; }
+    //多くのDAWはRIFFのサイズを書き終わった時に埋めるので、ファイルより大きい・0のままなら書き込み中
+    //RF64はサイズがds64にあるので、チャンクが読めるかだけで判断する
+    if(header.startsWith("RIFF"))
+    {
+        const quint32 riffSize = qFromLittleEndian<quint32>(header.constData() + 4);
+        if(riffSize == 0 || qint64(riffSize) + 8 > file.size()){ return false; }
+    }
+    file.close();
+    WaveFile::Info info;
+    return WaveFile::ReadInfo(filePath, info);
+}
+
+void SourceWatcher::ScanFolder(const QString& folder)
+{
+    for(const auto& file : GetWavFiles(folder))
+    {
+        const FileState state = GetState(file);
+        if(state == this->knownFiles.value(file)){ continue; }
+        this->pendingFiles.insert(file, state);
+    }
+    //書き込みが続いている間は待ち時間を延ばし続ける
+    if(this->pendingFiles.isEmpty() == false){
+        this->debounceTimer.start();
+    }
+}
+
+void SourceWatcher::CheckPendingFiles()
+{
+    QStringList changedFiles;
+    for(auto itr = this->pendingFiles.begin(); itr != this->pendingFiles.end();)
+    {
+        const QString& file = itr.key();
+        const FileState state = GetState(file);
+        if(state.size < 0){
+            //待っている間に消えた
+            this->knownFiles.remove(file);
+            itr = this->pendingFiles.erase(itr);
+            continue;
+        }
+        if(state != itr.value() || IsWriteFinished(file) == false){
+            //まだ書き込み中なので次の確認まで待つ
+            itr.value() = state;
+            ++itr;
+            continue;
+        }
+        this->knownFiles.insert(file, state);
+        //置き換えられたファイルは監視が外れているので付け直す
+        if(this->watcher.files().contains(file) == false){
+            this->watcher.addPath(file);
+        }
+        changedFiles.append(file);
+        itr = this->pendingFiles.erase(itr);
+    }
+
+    if(this->pendingFiles.isEmpty() == false){
+        this->debounceTimer.start();
+    }
+    if(changedFiles.isEmpty() == false)
+    {
+        changedFiles.sort();
+        emit this->filesChanged(changedFiles);
+    }
+}
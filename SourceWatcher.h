@@ -0,0 +1,50 @@
+#ifndef SOURCEWATCHER_H
+#define SOURCEWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+
+//元wavのフォルダを監視し、書き込みの終わった新しいwav・差し替えられたwavを知らせる
+//DAWのバウンスは同じファイルに何度も書き込むので、サイズと更新日時が一定時間変わらなくなってから知らせる
+class SourceWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int debounceMs = 2000;
+
+    explicit SourceWatcher(QObject* parent = nullptr);
+
+    //監視するフォルダ(絶対パス) 新しく加わったフォルダにある今のwavは、変更前の状態として覚える
+    void SetFolders(const QStringList& folders);
+    void Stop();
+    bool IsWatching() const { return watcher.directories().isEmpty() == false; }
+
+signals:
+    void filesChanged(const QStringList& filePaths);
+
+private:
+    struct FileState
+    {
+        qint64 size = -1;
+        qint64 lastModified = 0;
+        bool operator==(const FileState& other) const { return size == other.size && lastModified == other.lastModified; }
+        bool operator!=(const FileState& other) const { return (*this == other) == false; }
+    };
+    static FileState GetState(const QString& filePath);
+    static QStringList GetWavFiles(const QString& folder);
+    //書き込み中のファイルは他のプロセスから開けないか、ヘッダーのサイズが揃っていない
+    static bool IsWriteFinished(const QString& filePath);
+
+    void ScanFolder(const QString& folder);
+    void CheckPendingFiles();
+
+    QFileSystemWatcher watcher;
+    QTimer debounceTimer;
+    QHash<QString, FileState> knownFiles;   //最後に知らせた(または監視を始めた)時点の状態
+    QHash<QString, FileState> pendingFiles; //変化を見つけて、書き込みが終わるのを待っているファイル
+};
+
+#endif // SOURCEWATCHER_H
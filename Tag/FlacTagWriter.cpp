@@ -0,0 +1,214 @@
+#include "TagWriter.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QSet>
+
+namespace
+{
+    enum BlockType
+    {
+        StreamInfo    = 0,
+        Padding       = 1,
+        VorbisComment = 4,
+        Picture       = 6,
+    };
+    constexpr int defaultPadding = 4096;
+    constexpr int maxBlockSize = (1 << 24) - 1;
+
+    struct MetadataBlock
+    {
+        int type;
+        QByteArray data;
+    };
+
+    void AppendLittleEndian(QByteArray& out, quint32 value){
+        out.append(char(value));
+        out.append(char(value >> 8));
+        out.append(char(value >> 16));
+        out.append(char(value >> 24));
+    }
+    void AppendBigEndian(QByteArray& out, quint32 value){
+        out.append(char(value >> 24));
+        out.append(char(value >> 16));
+        out.append(char(value >> 8));
+        out.append(char(value));
+    }
+    quint32 ReadLittleEndian(const char* p){
+        return quint32(quint8(p[0])) | (quint32(quint8(p[1])) << 8) | (quint32(quint8(p[2])) << 16) | (quint32(quint8(p[3])) << 24);
+    }
+
+    void AppendBlockHeader(QByteArray& out, int type, int size, bool isLast){
+        out.append(char((isLast ? 0x80 : 0x00) | type));
+        out.append(char(size >> 16));
+        out.append(char(size >> 8));
+        out.append(char(size));
+    }
+
+    //既存のVORBIS_COMMENTからベンダー文字列と、書き換えないコメントを取り出す
+    void ParseVorbisComment(const QByteArray& data, QByteArray& vendor, QList<QByteArray>& keepComments)
+    {
+        static const QSet<QByteArray> replaceKeys = {
+            "TITLE", "ARTIST", "ALBUM", "ALBUMARTIST", "ALBUM_ARTIST", "ALBUM ARTIST", "COMPOSER",
+            "GENRE", "DATE", "YEAR", "TRACKNUMBER", "TRACKTOTAL", "TOTALTRACKS", "DISCNUMBER", "DISCTOTAL", "TOTALDISCS",
+            "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK", "REPLAYGAIN_ALBUM_GAIN", "REPLAYGAIN_ALBUM_PEAK", "ITUNNORM"
+        };
+        if(data.size() < 8){ return; }
+        qint64 pos = 0;
+        const quint32 vendorLength = ReadLittleEndian(data.constData());
+        pos += 4;
+        if(pos + vendorLength + 4 > quint64(data.size())){ return; }
+        vendor = data.mid(pos, vendorLength);
+        pos += vendorLength;
+        const quint32 count = ReadLittleEndian(data.constData() + pos);
+        pos += 4;
+        for(quint32 i=0; i<count && pos + 4 <= data.size(); ++i)
+        {
+            const quint32 length = ReadLittleEndian(data.constData() + pos);
+            pos += 4;
+            if(pos + length > quint64(data.size())){ return; }
+            const QByteArray comment = data.mid(pos, length);
+            pos += length;
+            const QByteArray key = comment.left(comment.indexOf('=')).toUpper();
+            if(replaceKeys.contains(key) == false){
+                keepComments.append(comment);
+            }
+        }
+    }
+}
+
+namespace TagWriter
+{
+
+bool WriteFlac(const QString& filePath, const Tags& tags)
+{
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+    if(file.read(4) != "fLaC"){ return false; }
+
+    //メタデータブロックの読み込み
+    QList<MetadataBlock> blocks;
+    bool isLast = false;
+    while(isLast == false)
+    {
+        const QByteArray header = file.read(4);
+        if(header.size() != 4){ return false; }
+        isLast = (quint8(header[0]) & 0x80) != 0;
+        const int type = quint8(header[0]) & 0x7F;
+        const int size = (quint8(header[1]) << 16) | (quint8(header[2]) << 8) | quint8(header[3]);
+        //パディングは読み飛ばす
+        if(type == Padding){
+            if(file.seek(file.pos() + size) == false){ return false; }
+            continue;
+        }
+        const QByteArray data = file.read(size);
+        if(data.size() != size){ return false; }
+        blocks.append({type, data});
+    }
+    const qint64 oldMetadataSize = file.pos() - 4;
+    file.close();
+    if(blocks.isEmpty() || blocks.first().type != StreamInfo){ return false; }
+
+    QByteArray vendor = "EncodeUtility";
+    QList<QByteArray> comments;
+    for(const auto& block : blocks){
+        if(block.type == VorbisComment){
+            ParseVorbisComment(block.data, vendor, comments);
+        }
+    }
+
+    const auto& fields = tags.fields;
+    auto AddComment = [&](const char* name, const char* key){
+        const auto value = fields.value(key);
+        if(value.isEmpty() == false){ comments.append(QByteArray(name) + "=" + value.toUtf8()); }
+    };
+    AddComment("TITLE", "title");
+    AddComment("ARTIST", "artist");
+    AddComment("ALBUM", "album");
+    AddComment("ALBUMARTIST", "album_artist");
+    AddComment("COMPOSER", "composer");
+    AddComment("GENRE", "genre");
+    AddComment("DATE", "date");
+    AddComment("TRACKNUMBER", "track");
+    AddComment("DISCNUMBER", "disc");
+    //FLACのプレイヤーはReplayGainを読むので、iTunNORMは書かない
+    for(const auto& key : replayGainKeys){
+        const auto keyName = key.toLatin1();
+        AddComment(keyName.constData(), keyName.constData());
+    }
+
+    QByteArray vorbisComment;
+    AppendLittleEndian(vorbisComment, vendor.size());
+    vorbisComment.append(vendor);
+    AppendLittleEndian(vorbisComment, comments.size());
+    for(const auto& comment : comments){
+        AppendLittleEndian(vorbisComment, comment.size());
+        vorbisComment.append(comment);
+    }
+
+    //STREAMINFO・その他(SEEKTABLEなど)・VORBIS_COMMENT・PICTUREの順に並べる
+    QList<MetadataBlock> newBlocks;
+    for(const auto& block : blocks){
+        if(block.type != VorbisComment && block.type != Picture){
+            newBlocks.append(block);
+        }
+    }
+    newBlocks.append({VorbisComment, vorbisComment});
+
+    if(tags.picture.isEmpty() == false)
+    {
+        QBuffer buffer;
+        buffer.setData(tags.picture);
+        QImageReader reader(&buffer);
+        const QSize size = reader.size();
+
+        const QByteArray mime = tags.pictureMimeType.toLatin1();
+        const QByteArray description = tags.pictureDescription.toUtf8();
+        QByteArray picture;
+        AppendBigEndian(picture, 3);    //front cover
+        AppendBigEndian(picture, mime.size());
+        picture.append(mime);
+        AppendBigEndian(picture, description.size());
+        picture.append(description);
+        AppendBigEndian(picture, std::max(size.width(), 0));
+        AppendBigEndian(picture, std::max(size.height(), 0));
+        AppendBigEndian(picture, 24);
+        AppendBigEndian(picture, 0);
+        AppendBigEndian(picture, tags.picture.size());
+        picture.append(tags.picture);
+        newBlocks.append({Picture, picture});
+    }
+
+    qint64 newMetadataSize = 0;
+    for(const auto& block : newBlocks){
+        if(block.data.size() > maxBlockSize){ return false; }
+        newMetadataSize += 4 + block.data.size();
+    }
+
+    //既存のメタデータ領域に収まればパディングで埋めて、音声フレームの位置を変えない
+    qint64 padding = defaultPadding;
+    if(newMetadataSize == oldMetadataSize){
+        padding = -1;
+    }
+    else if(newMetadataSize + 4 <= oldMetadataSize){
+        padding = oldMetadataSize - newMetadataSize - 4;
+    }
+    if(padding > maxBlockSize){ return false; }
+
+    QByteArray metadata;
+    for(int i=0; i<newBlocks.size(); ++i)
+    {
+        const bool last = (padding < 0) && (i == newBlocks.size()-1);
+        AppendBlockHeader(metadata, newBlocks[i].type, newBlocks[i].data.size(), last);
+        metadata.append(newBlocks[i].data);
+    }
+    if(padding >= 0){
+        AppendBlockHeader(metadata, Padding, int(padding), true);
+        metadata.append(int(padding), '\0');
+    }
+
+    return ReplaceFileRange(filePath, 4, oldMetadataSize, metadata);
+}
+
+}
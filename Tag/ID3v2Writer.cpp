@@ -0,0 +1,245 @@
+#include "TagWriter.h"
+
+#include <QFile>
+#include <QSet>
+
+namespace
+{
+    constexpr qint64 headerSize = 10;
+    constexpr int    defaultPadding = 1024;
+
+    quint32 ReadSyncSafe(const char* p){
+        return (quint32(quint8(p[0]) & 0x7F) << 21) | (quint32(quint8(p[1]) & 0x7F) << 14) |
+               (quint32(quint8(p[2]) & 0x7F) << 7)  |  quint32(quint8(p[3]) & 0x7F);
+    }
+    quint32 ReadBigEndian(const char* p){
+        return (quint32(quint8(p[0])) << 24) | (quint32(quint8(p[1])) << 16) | (quint32(quint8(p[2])) << 8) | quint32(quint8(p[3]));
+    }
+    void AppendSyncSafe(QByteArray& out, quint32 value){
+        out.append(char((value >> 21) & 0x7F));
+        out.append(char((value >> 14) & 0x7F));
+        out.append(char((value >> 7) & 0x7F));
+        out.append(char(value & 0x7F));
+    }
+    void AppendBigEndian(QByteArray& out, quint32 value){
+        out.append(char(value >> 24));
+        out.append(char(value >> 16));
+        out.append(char(value >> 8));
+        out.append(char(value));
+    }
+
+    bool IsLatin1(const QString& text){
+        for(const auto c : text){
+            if(c.unicode() > 0xFF){ return false; }
+        }
+        return true;
+    }
+
+    //v2.3はLatin-1かBOM付きUTF-16、v2.4はUTF-8 (ffmpegと同じ選び方)
+    QByteArray EncodeText(const QString& text, int version, char& encoding)
+    {
+        if(version >= 4){
+            encoding = 3;
+            return text.toUtf8();
+        }
+        if(IsLatin1(text)){
+            encoding = 0;
+            return text.toLatin1();
+        }
+        encoding = 1;
+        QByteArray result("\xFF\xFE", 2);
+        for(const auto c : text){
+            result.append(char(c.unicode() & 0xFF));
+            result.append(char(c.unicode() >> 8));
+        }
+        return result;
+    }
+
+    QByteArray MakeFrame(const char* id, const QByteArray& body, int version)
+    {
+        QByteArray frame(id, 4);
+        if(version >= 4){ AppendSyncSafe(frame, body.size()); }
+        else            { AppendBigEndian(frame, body.size()); }
+        frame.append(2, '\0');  //flags
+        frame.append(body);
+        return frame;
+    }
+
+    QByteArray MakeTextFrame(const char* id, const QString& text, int version)
+    {
+        char encoding = 0;
+        QByteArray encoded = EncodeText(text, version, encoding);
+        QByteArray body;
+        body.append(encoding);
+        body.append(encoded);
+        return MakeFrame(id, body, version);
+    }
+
+    //説明文付きのフレーム(TXXX・COMM) キーも値もASCIIなのでLatin-1で書く COMMは言語コードを付ける
+    QByteArray MakeDescribedFrame(const char* id, const QByteArray& language, const QString& description, const QString& text, int version)
+    {
+        QByteArray body;
+        body.append('\0');
+        body.append(language);
+        body.append(description.toLatin1());
+        body.append('\0');
+        body.append(text.toLatin1());
+        return MakeFrame(id, body, version);
+    }
+
+    //TXXX・COMMの説明文 COMMは言語コードの3バイト分を飛ばす
+    QString ReadDescription(const QByteArray& body, int skip)
+    {
+        if(body.size() < 1 + skip){ return {}; }
+        const char encoding = body[0];
+        const QByteArray text = body.mid(1 + skip);
+        if(encoding == 1 || encoding == 2)
+        {
+            QString description;
+            const bool isBigEndian = (encoding == 2) || text.startsWith("\xFE\xFF");
+            const int begin = (encoding == 1 && text.size() >= 2) ? 2 : 0;    //BOM
+            for(int i=begin; i+1<text.size(); i+=2){
+                const ushort c = isBigEndian ? (ushort(quint8(text[i])) << 8 | quint8(text[i+1]))
+                                             : (ushort(quint8(text[i+1])) << 8 | quint8(text[i]));
+                if(c == 0){ break; }
+                description.append(QChar(c));
+            }
+            return description;
+        }
+        const QByteArray part = text.left(text.indexOf('\0'));
+        return (encoding == 3) ? QString::fromUtf8(part) : QString::fromLatin1(part);
+    }
+
+    //ラウドネスのタグは書き直すたびに置き換える(ffmpegはiTunNORMもTXXXで書く)
+    bool IsLoudnessFrame(const QByteArray& id, const QByteArray& body)
+    {
+        if(id == "TXXX"){
+            const auto description = ReadDescription(body, 0);
+            return TagWriter::replayGainKeys.contains(description, Qt::CaseInsensitive) ||
+                   description.compare(TagWriter::iTunNormKey, Qt::CaseInsensitive) == 0;
+        }
+        if(id == "COMM"){
+            return ReadDescription(body, 3).compare(TagWriter::iTunNormKey, Qt::CaseInsensitive) == 0;
+        }
+        return false;
+    }
+}
+
+namespace TagWriter
+{
+
+bool WriteID3v2(const QString& filePath, const Tags& tags)
+{
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+
+    //既存タグの解析
+    int version = 3;
+    qint64 oldTagTotal = 0;     //ヘッダー・フッター込みの既存タグサイズ
+    quint32 oldTagSize = 0;     //ヘッダーのサイズ欄(フレーム+パディング)
+    QList<QByteArray> keepFrames;
+    const QByteArray header = file.read(headerSize);
+    if(header.size() == headerSize && header.startsWith("ID3"))
+    {
+        version = quint8(header[3]);
+        const quint8 flags = quint8(header[5]);
+        //非同期化・拡張ヘッダー付きのタグは扱わない
+        if((version != 3 && version != 4) || (flags & 0xC0) != 0){ return false; }
+
+        oldTagSize = ReadSyncSafe(header.constData() + 6);
+        oldTagTotal = headerSize + oldTagSize + ((flags & 0x10) ? headerSize : 0);
+        const QByteArray body = file.read(oldTagSize);
+        if(body.size() != qint64(oldTagSize)){ return false; }
+
+        //書き換えないフレーム(エンコーダー名など)は残す
+        static const QSet<QByteArray> replaceFrames = {
+            "TIT2", "TPE1", "TALB", "TPE2", "TCOM", "TCON", "TYER", "TDAT", "TDRC", "TRCK", "TPOS", "APIC"
+        };
+        qint64 pos = 0;
+        while(pos + headerSize <= body.size())
+        {
+            const char* p = body.constData() + pos;
+            if(p[0] == '\0'){ break; }  //パディング
+            const quint32 frameSize = (version >= 4) ? ReadSyncSafe(p + 4) : ReadBigEndian(p + 4);
+            if(pos + headerSize + frameSize > body.size()){ return false; }
+            const QByteArray id(p, 4);
+            if(replaceFrames.contains(id) == false && IsLoudnessFrame(id, body.mid(pos + headerSize, frameSize)) == false){
+                keepFrames.append(body.mid(pos, headerSize + frameSize));
+            }
+            pos += headerSize + frameSize;
+        }
+    }
+    file.close();
+
+    //新しいフレーム
+    QByteArray frames;
+    for(const auto& frame : keepFrames){ frames.append(frame); }
+
+    const auto& fields = tags.fields;
+    auto AddText = [&](const char* id, const char* key){
+        const auto value = fields.value(key);
+        if(value.isEmpty() == false){ frames.append(MakeTextFrame(id, value, version)); }
+    };
+    AddText("TIT2", "title");
+    AddText("TPE1", "artist");
+    AddText("TALB", "album");
+    AddText("TPE2", "album_artist");
+    AddText("TCOM", "composer");
+    AddText("TCON", "genre");
+    if(version >= 4){
+        AddText("TDRC", "date");
+    }
+    else if(fields.value("date").size() >= 4){
+        frames.append(MakeTextFrame("TYER", fields.value("date").left(4), version));
+    }
+    AddText("TRCK", "track");
+    AddText("TPOS", "disc");
+    //ReplayGainはTXXX、iTunes用のiTunNORMはCOMMに入れる
+    for(const auto& key : replayGainKeys){
+        const auto value = fields.value(key);
+        if(value.isEmpty() == false){ frames.append(MakeDescribedFrame("TXXX", QByteArray(), key, value, version)); }
+    }
+    if(fields.value(iTunNormKey).isEmpty() == false){
+        frames.append(MakeDescribedFrame("COMM", "eng", iTunNormKey, fields.value(iTunNormKey), version));
+    }
+
+    if(tags.picture.isEmpty() == false)
+    {
+        char encoding = 0;
+        const QByteArray description = EncodeText(tags.pictureDescription, version, encoding);
+        QByteArray body;
+        body.append(encoding);
+        body.append(tags.pictureMimeType.toLatin1());
+        body.append('\0');
+        body.append(char(3));   //front cover
+        body.append(description);
+        body.append((encoding == 1) ? 2 : 1, '\0');
+        body.append(tags.picture);
+        frames.append(MakeFrame("APIC", body, version));
+    }
+
+    //パディングに収まる場合は既存のタグサイズのまま書き込み、音声部分に触れない
+    quint32 newTagSize = 0;
+    qint64 replaceSize = 0;
+    if(oldTagTotal > 0 && frames.size() <= qint64(oldTagSize) && oldTagTotal == headerSize + oldTagSize){
+        newTagSize = oldTagSize;
+        replaceSize = oldTagTotal;
+    }
+    else{
+        newTagSize = frames.size() + defaultPadding;
+        replaceSize = oldTagTotal;
+    }
+    if(newTagSize >= (1u << 28)){ return false; }
+
+    QByteArray tag("ID3", 3);
+    tag.append(char(version));
+    tag.append('\0');   //revision
+    tag.append('\0');   //flags
+    AppendSyncSafe(tag, newTagSize);
+    tag.append(frames);
+    tag.append(int(newTagSize - frames.size()), '\0');
+
+    return ReplaceFileRange(filePath, 0, replaceSize, tag);
+}
+
+}
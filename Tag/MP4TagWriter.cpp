@@ -0,0 +1,353 @@
+#include "TagWriter.h"
+
+#include <QFile>
+#include <QSet>
+
+namespace
+{
+    constexpr int defaultPadding = 1024;
+
+    struct Box
+    {
+        QByteArray type;
+        qint64 offset = 0;      //ボックス先頭(ヘッダー含む)
+        qint64 size = 0;        //ヘッダー込みのサイズ
+        int headerSize = 8;
+    };
+
+    quint32 ReadU32(const char* p){
+        return (quint32(quint8(p[0])) << 24) | (quint32(quint8(p[1])) << 16) | (quint32(quint8(p[2])) << 8) | quint32(quint8(p[3]));
+    }
+    quint64 ReadU64(const char* p){
+        return (quint64(ReadU32(p)) << 32) | ReadU32(p + 4);
+    }
+    void WriteU32(char* p, quint32 value){
+        p[0] = char(value >> 24); p[1] = char(value >> 16); p[2] = char(value >> 8); p[3] = char(value);
+    }
+    void WriteU64(char* p, quint64 value){
+        WriteU32(p, quint32(value >> 32));
+        WriteU32(p + 4, quint32(value));
+    }
+    void AppendU32(QByteArray& out, quint32 value){
+        char buffer[4];
+        WriteU32(buffer, value);
+        out.append(buffer, 4);
+    }
+    void AppendU16(QByteArray& out, quint16 value){
+        out.append(char(value >> 8));
+        out.append(char(value));
+    }
+
+    QByteArray MakeBox(const QByteArray& type, const QByteArray& payload){
+        QByteArray box;
+        AppendU32(box, quint32(8 + payload.size()));
+        box.append(type);
+        box.append(payload);
+        return box;
+    }
+
+    //メモリ上のデータを子ボックスに分割する
+    bool ParseChildren(const QByteArray& data, qint64 begin, qint64 end, QList<Box>& children)
+    {
+        qint64 pos = begin;
+        while(pos + 8 <= end)
+        {
+            Box box;
+            box.offset = pos;
+            box.size = ReadU32(data.constData() + pos);
+            box.type = data.mid(pos + 4, 4);
+            if(box.size == 1){
+                if(pos + 16 > end){ return false; }
+                box.size = qint64(ReadU64(data.constData() + pos + 8));
+                box.headerSize = 16;
+            }
+            else if(box.size == 0){
+                box.size = end - pos;
+            }
+            if(box.size < box.headerSize || pos + box.size > end){ return false; }
+            children.append(box);
+            pos += box.size;
+        }
+        return pos == end;
+    }
+
+    //ilstの1項目 dataTypeは1=UTF-8, 0=バイナリ, 13=JPEG, 14=PNG
+    QByteArray MakeItem(const QByteArray& type, quint32 dataType, const QByteArray& value){
+        QByteArray data;
+        AppendU32(data, dataType);
+        AppendU32(data, 0);     //locale
+        data.append(value);
+        return MakeBox(type, MakeBox("data", data));
+    }
+
+    //iTunes形式の自由項目(----) mean・name・dataの3つの子を持つ
+    QByteArray MakeFreeformItem(const QString& name, const QString& value){
+        QByteArray mean(4, '\0');  //version/flags
+        mean.append("com.apple.iTunes");
+        QByteArray nameData(4, '\0');
+        nameData.append(name.toUtf8());
+        QByteArray data;
+        AppendU32(data, 1);
+        AppendU32(data, 0);
+        data.append(value.toUtf8());
+        return MakeBox("----", MakeBox("mean", mean) + MakeBox("name", nameData) + MakeBox("data", data));
+    }
+
+    //----項目のname 読めない場合は空
+    QString ReadFreeformName(const QByteArray& data, const Box& item)
+    {
+        QList<Box> children;
+        if(ParseChildren(data, item.offset + item.headerSize, item.offset + item.size, children) == false){ return {}; }
+        for(const auto& child : children){
+            if(child.type == "name" && child.size >= child.headerSize + 4){
+                return QString::fromUtf8(data.mid(child.offset + child.headerSize + 4, child.size - child.headerSize - 4));
+            }
+        }
+        return {};
+    }
+
+    //ラウドネスのタグは書き直すたびに置き換える
+    bool IsLoudnessItem(const QByteArray& data, const Box& item)
+    {
+        if(item.type != "----"){ return false; }
+        const auto name = ReadFreeformName(data, item);
+        return name.compare(TagWriter::iTunNormKey, Qt::CaseInsensitive) == 0 ||
+               TagWriter::replayGainKeys.contains(name, Qt::CaseInsensitive);
+    }
+
+    QByteArray MakeNumberPair(const QString& value, bool isTrack){
+        //"n/total"形式
+        const auto parts = value.split('/');
+        QByteArray data;
+        AppendU16(data, 0);
+        AppendU16(data, quint16(parts.value(0).toUInt()));
+        AppendU16(data, quint16(parts.value(1).toUInt()));
+        if(isTrack){ AppendU16(data, 0); }
+        return data;
+    }
+
+    //stco/co64のチャンクオフセットをdeltaだけずらす
+    bool ShiftChunkOffsets(QByteArray& data, qint64 begin, qint64 end, qint64 delta)
+    {
+        static const QSet<QByteArray> containers = {"moov", "trak", "mdia", "minf", "stbl"};
+        QList<Box> children;
+        if(ParseChildren(data, begin, end, children) == false){ return false; }
+        for(const auto& box : children)
+        {
+            const qint64 payload = box.offset + box.headerSize;
+            if(containers.contains(box.type)){
+                if(ShiftChunkOffsets(data, payload, box.offset + box.size, delta) == false){ return false; }
+            }
+            else if(box.type == "stco" || box.type == "co64")
+            {
+                const bool is64 = (box.type == "co64");
+                const int entrySize = is64 ? 8 : 4;
+                if(payload + 8 > box.offset + box.size){ return false; }
+                const quint32 count = ReadU32(data.constData() + payload + 4);
+                if(payload + 8 + qint64(count) * entrySize > box.offset + box.size){ return false; }
+                char* entry = data.data() + payload + 8;
+                for(quint32 i=0; i<count; ++i, entry += entrySize)
+                {
+                    if(is64){
+                        WriteU64(entry, ReadU64(entry) + delta);
+                    }
+                    else{
+                        const qint64 value = qint64(ReadU32(entry)) + delta;
+                        if(value < 0 || value > 0xFFFFFFFFll){ return false; }
+                        WriteU32(entry, quint32(value));
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
+
+namespace TagWriter
+{
+
+bool WriteMP4(const QString& filePath, const Tags& tags)
+{
+    QFile file(filePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+    const qint64 fileSize = file.size();
+
+    //トップレベルのボックス
+    QList<Box> topBoxes;
+    for(qint64 pos = 0; pos + 8 <= fileSize; )
+    {
+        if(file.seek(pos) == false){ return false; }
+        const QByteArray header = file.read(16);
+        if(header.size() < 8){ return false; }
+        Box box;
+        box.offset = pos;
+        box.size = ReadU32(header.constData());
+        box.type = header.mid(4, 4);
+        if(box.size == 1){
+            if(header.size() < 16){ return false; }
+            box.size = qint64(ReadU64(header.constData() + 8));
+            box.headerSize = 16;
+        }
+        else if(box.size == 0){
+            box.size = fileSize - pos;
+        }
+        if(box.size < box.headerSize || pos + box.size > fileSize){ return false; }
+        topBoxes.append(box);
+        pos += box.size;
+    }
+
+    int moovIndex = -1;
+    for(int i=0; i<topBoxes.size(); ++i){
+        if(topBoxes[i].type == "moov"){ moovIndex = i; break; }
+    }
+    if(moovIndex < 0 || topBoxes[moovIndex].headerSize != 8){ return false; }
+    const Box moov = topBoxes[moovIndex];
+    bool isMoovBeforeMdat = false;
+    for(int i=moovIndex+1; i<topBoxes.size(); ++i){
+        if(topBoxes[i].type == "mdat"){ isMoovBeforeMdat = true; }
+    }
+
+    if(file.seek(moov.offset) == false){ return false; }
+    QByteArray moovData = file.read(moov.size);
+    if(moovData.size() != moov.size){ return false; }
+
+    //moov > udta > meta > ilst を探す
+    QList<Box> moovChildren;
+    if(ParseChildren(moovData, 8, moovData.size(), moovChildren) == false){ return false; }
+
+    QByteArray udtaPayload;     //meta以外の子
+    QByteArray metaHeader = QByteArray(4, '\0');    //version/flags
+    QByteArray metaPayload;     //ilst・free以外の子
+    QByteArray keepItems;       //書き換えないilstの項目
+    int udtaIndex = -1;
+    for(int i=0; i<moovChildren.size(); ++i)
+    {
+        if(moovChildren[i].type != "udta"){ continue; }
+        udtaIndex = i;
+        const Box& udta = moovChildren[i];
+        QList<Box> udtaChildren;
+        if(ParseChildren(moovData, udta.offset + udta.headerSize, udta.offset + udta.size, udtaChildren) == false){ return false; }
+        for(const auto& child : udtaChildren)
+        {
+            if(child.type != "meta"){
+                udtaPayload.append(moovData.mid(child.offset, child.size));
+                continue;
+            }
+            const qint64 metaBegin = child.offset + child.headerSize;
+            metaHeader = moovData.mid(metaBegin, 4);
+            QList<Box> metaChildren;
+            if(ParseChildren(moovData, metaBegin + 4, child.offset + child.size, metaChildren) == false){ return false; }
+            for(const auto& metaChild : metaChildren)
+            {
+                if(metaChild.type == "free"){ continue; }
+                if(metaChild.type != "ilst"){
+                    metaPayload.append(moovData.mid(metaChild.offset, metaChild.size));
+                    continue;
+                }
+                static const QSet<QByteArray> replaceItems = {
+                    "\xA9nam", "\xA9""ART", "\xA9""alb", "aART", "\xA9wrt", "\xA9gen", "gnre", "\xA9""day", "trkn", "disk", "covr"
+                };
+                QList<Box> items;
+                if(ParseChildren(moovData, metaChild.offset + metaChild.headerSize, metaChild.offset + metaChild.size, items) == false){ return false; }
+                for(const auto& item : items){
+                    if(replaceItems.contains(item.type) == false && IsLoudnessItem(moovData, item) == false){
+                        keepItems.append(moovData.mid(item.offset, item.size));
+                    }
+                }
+            }
+        }
+        break;
+    }
+
+    //hdlrが無いmetaはiTunesに読まれないので作る
+    if(metaPayload.contains("hdlr") == false)
+    {
+        QByteArray hdlr(4, '\0');   //version/flags
+        AppendU32(hdlr, 0);
+        hdlr.append("mdir");
+        hdlr.append("appl");
+        hdlr.append(8, '\0');
+        hdlr.append('\0');
+        metaPayload.prepend(MakeBox("hdlr", hdlr));
+    }
+
+    //新しいilst
+    QByteArray ilst = keepItems;
+    const auto& fields = tags.fields;
+    auto AddText = [&](const QByteArray& type, const char* key){
+        const auto value = fields.value(key);
+        if(value.isEmpty() == false){ ilst.append(MakeItem(type, 1, value.toUtf8())); }
+    };
+    AddText("\xA9nam", "title");
+    AddText("\xA9""ART", "artist");
+    AddText("\xA9""alb", "album");
+    AddText("aART", "album_artist");
+    AddText("\xA9wrt", "composer");
+    AddText("\xA9gen", "genre");
+    AddText("\xA9""day", "date");
+    if(fields.value("track").isEmpty() == false){ ilst.append(MakeItem("trkn", 0, MakeNumberPair(fields.value("track"), true))); }
+    if(fields.value("disc").isEmpty() == false){ ilst.append(MakeItem("disk", 0, MakeNumberPair(fields.value("disc"), false))); }
+    if(tags.picture.isEmpty() == false){
+        ilst.append(MakeItem("covr", (tags.pictureMimeType == "image/png") ? 14 : 13, tags.picture));
+    }
+    //m4aのReplayGainは小文字のキーで書くのが一般的
+    for(const auto& key : replayGainKeys){
+        const auto value = fields.value(key);
+        if(value.isEmpty() == false){ ilst.append(MakeFreeformItem(key.toLower(), value)); }
+    }
+    if(fields.value(iTunNormKey).isEmpty() == false){
+        ilst.append(MakeFreeformItem(iTunNormKey, fields.value(iTunNormKey)));
+    }
+
+    const QByteArray newUdta = MakeBox("udta", udtaPayload + MakeBox("meta", metaHeader + metaPayload + MakeBox("ilst", ilst)));
+
+    QByteArray newMoovPayload;
+    for(int i=0; i<moovChildren.size(); ++i)
+    {
+        if(i == udtaIndex){
+            newMoovPayload.append(newUdta);
+        }
+        else{
+            newMoovPayload.append(moovData.mid(moovChildren[i].offset, moovChildren[i].size));
+        }
+    }
+    if(udtaIndex < 0){ newMoovPayload.append(newUdta); }
+    QByteArray newMoov = MakeBox("moov", newMoovPayload);
+    file.close();
+
+    qint64 available = moov.size;
+    for(int i=moovIndex+1; i<topBoxes.size() && (topBoxes[i].type == "free" || topBoxes[i].type == "skip"); ++i){
+        available += topBoxes[i].size;
+    }
+
+    //moovがmdatより後ろにあれば音声の位置は変わらないので、moovだけを置き換える
+    if(isMoovBeforeMdat == false)
+    {
+        //moov(と後ろのfree)がファイルの最後なら、ファイル全体をコピーせずに上書きして長さを合わせる
+        if(moov.offset + available == fileSize)
+        {
+            QFile output(filePath);
+            if(output.open(QFile::ReadWrite) == false || output.seek(moov.offset) == false){ return false; }
+            if(output.write(newMoov) != newMoov.size()){ return false; }
+            return output.resize(moov.offset + newMoov.size());
+        }
+        return ReplaceFileRange(filePath, moov.offset, moov.size, newMoov);
+    }
+
+    //moovの直後のfreeを含めた領域に収まれば、freeで埋めてその場で書き換える
+    const qint64 remain = available - newMoov.size();
+    if(remain == 0 || remain >= 8){
+        QByteArray region = newMoov;
+        if(remain >= 8){ region.append(MakeBox("free", QByteArray(int(remain - 8), '\0'))); }
+        return ReplaceFileRange(filePath, moov.offset, available, region);
+    }
+
+    //収まらない場合はmdatがずれるので、チャンクオフセットを直して作り直す
+    const qint64 delta = newMoov.size() + defaultPadding - available;
+    if(ShiftChunkOffsets(newMoov, 8, newMoov.size(), delta) == false){ return false; }
+    QByteArray region = newMoov;
+    region.append(MakeBox("free", QByteArray(defaultPadding - 8, '\0')));
+    return ReplaceFileRange(filePath, moov.offset, available, region);
+}
+
+}
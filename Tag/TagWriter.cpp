@@ -0,0 +1,105 @@
+#include "TagWriter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace TagWriter
+{
+
+Tags Tags::FromArguments(const QStringList& arguments, const QStringList& outputPaths, int outputIndex)
+{
+    //ffmpegのオプションは直後の出力ファイルに掛かるので、出力パスを区切りとして読む
+    Tags tags;
+    const QString& target = outputPaths.value(outputIndex);
+    for(int i=0; i<arguments.size(); ++i)
+    {
+        const auto& arg = arguments[i];
+        if(arg == target){ break; }
+        if(outputPaths.contains(arg)){
+            tags = Tags();
+            continue;
+        }
+        if(i+1 >= arguments.size()){ break; }
+
+        if(arg == "-metadata"){
+            const auto& value = arguments[++i];
+            const int pos = value.indexOf('=');
+            if(pos > 0){
+                tags.fields.insert(value.left(pos), value.mid(pos+1));
+            }
+        }
+        else if(arg == "-metadata:s:v"){
+            const auto& value = arguments[++i];
+            if(value.startsWith("title=")){
+                tags.pictureDescription = value.mid(6);
+            }
+        }
+    }
+    return tags;
+}
+
+bool Tags::LoadPicture(const QString& picturePath)
+{
+    this->picture.clear();
+    if(picturePath.isEmpty()){ return true; }
+
+    QFile file(picturePath);
+    if(file.open(QFile::ReadOnly) == false){ return false; }
+    this->picture = file.readAll();
+
+    const auto suffix = QFileInfo(picturePath).suffix().toLower();
+    this->pictureMimeType = (suffix == "png") ? "image/png" : "image/jpeg";
+    return true;
+}
+
+bool Write(const QString& filePath, const Tags& tags)
+{
+    const auto suffix = QFileInfo(filePath).suffix().toLower();
+    if(suffix == "mp3"){ return WriteID3v2(filePath, tags); }
+    if(suffix == "m4a" || suffix == "mp4"){ return WriteMP4(filePath, tags); }
+    if(suffix == "flac"){ return WriteFlac(filePath, tags); }
+    return false;
+}
+
+bool ReplaceFileRange(const QString& filePath, qint64 offset, qint64 oldSize, const QByteArray& newData)
+{
+    QFile input(filePath);
+    if(input.open(QFile::ReadOnly) == false){ return false; }
+    if(offset < 0 || oldSize < 0 || offset + oldSize > input.size()){ return false; }
+
+    //サイズが変わらなければその場で上書きする
+    if(oldSize == newData.size())
+    {
+        input.close();
+        QFile output(filePath);
+        if(output.open(QFile::ReadWrite) == false || output.seek(offset) == false){ return false; }
+        return output.write(newData) == newData.size();
+    }
+
+    //サイズが変わる場合は一時ファイルに書き出して置き換える
+    QSaveFile output(filePath);
+    if(output.open(QFile::WriteOnly) == false){ return false; }
+
+    auto CopyRange = [&](qint64 begin, qint64 end)
+    {
+        constexpr qint64 bufferSize = 1 << 20;
+        if(input.seek(begin) == false){ return false; }
+        qint64 remain = end - begin;
+        while(remain > 0)
+        {
+            const QByteArray buffer = input.read(std::min(bufferSize, remain));
+            if(buffer.isEmpty() || output.write(buffer) != buffer.size()){ return false; }
+            remain -= buffer.size();
+        }
+        return true;
+    };
+
+    if(CopyRange(0, offset) == false){ return false; }
+    if(output.write(newData) != newData.size()){ return false; }
+    if(CopyRange(offset + oldSize, input.size()) == false){ return false; }
+    input.close();
+    return output.commit();
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef TAGWRITER_H
+#define TAGWRITER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+//エンコード済みファイルのタグ領域だけを書き換える
+//パディングに収まる場合は音声部分を一切書き換えない
+namespace TagWriter
+{
+    //ラウドネス解析の結果を入れるキー(-metadataと同じ) 形式ごとに決まった書き方で書く
+    inline const QStringList replayGainKeys = {
+        "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK", "REPLAYGAIN_ALBUM_GAIN", "REPLAYGAIN_ALBUM_PEAK"
+    };
+    inline const QString iTunNormKey = "iTunNORM";
+
+    struct Tags
+    {
+        //ffmpegの-metadataと同じキー(title, artist, album, album_artist, composer, genre, date, track, disc)
+        //とreplayGainKeys・iTunNormKey
+        QMap<QString, QString> fields;
+        QByteArray picture;
+        QString pictureMimeType;
+        QString pictureDescription;
+
+        //ffmpegの引数から、outputPaths[outputIndex]に対する-metadataを取り出す
+        static Tags FromArguments(const QStringList& arguments, const QStringList& outputPaths, int outputIndex);
+        bool LoadPicture(const QString& picturePath);
+    };
+
+    //拡張子から形式を判断して書き込む 対応していない構造の場合はfalse(再エンコードで対応する)
+    bool Write(const QString& filePath, const Tags& tags);
+
+    bool WriteID3v2(const QString& filePath, const Tags& tags);
+    bool WriteMP4(const QString& filePath, const Tags& tags);
+    bool WriteFlac(const QString& filePath, const Tags& tags);
+
+    //offsetからoldSizeバイトをnewDataに置き換える サイズが同じ場合はその場で上書きする
+    bool ReplaceFileRange(const QString& filePath, qint64 offset, qint64 oldSize, const QByteArray& newData);
+}
+
+#endif // TAGWRITER_H
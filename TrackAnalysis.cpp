@@ -0,0 +1,94 @@
+#include "TrackAnalysis.h"
+
+#include <QtConcurrent>
+
+TrackAnalysis::TrackAnalysis(QObject* parent)
+    : QObject(parent)
+    , watcher(new QFutureWatcher<Result>(this))
+    , isCanceled(std::make_shared<std::atomic_bool>(false))
+    , isRunning(false)
+{
+    connect(this->watcher, &QFutureWatcher<Result>::resultReadyAt, this, [this](int index){
+        if(*this->isCanceled){ return; }
+        emit this->resultReady(this->watcher->resultAt(index));
+    });
+    connect(this->watcher, &QFutureWatcher<Result>::progressValueChanged, this, [this](int value){
+        emit this->progressChanged(value, this->watcher->progressMaximum());
+    });
+    connect(this->watcher, &QFutureWatcher<Result>::finished, this, [this](){
+        this->Finish(*this->isCanceled || this->watcher->isCanceled());
+    });
+}
+
+TrackAnalysis::~TrackAnalysis()
+{
+    this->pending.clear();
+    *this->isCanceled = true;
+    this->watcher->cancel();
+    this->watcher->waitForFinished();
+}
+
+void TrackAnalysis::Start(const QStringList& paths, int tasks)
+{
+    this->pending.emplace_back(paths, tasks);
+    if(this->isRunning == false){
+        this->StartNext();
+    }
+}
+
+void TrackAnalysis::Cancel()
+{
+    if(this->isRunning == false){ return; }
+    this->pending.clear();
+    *this->isCanceled = true;
+    this->watcher->cancel();
+}
+
+bool TrackAnalysis::IsRunning() const
+{
+    return this->isRunning;
+}
+
+void TrackAnalysis::StartNext()
+{
+    QStringList paths = std::move(this->pending.front().first);
+    const int tasks = this->pending.front().second;
+    this->pending.erase(this->pending.begin());
+
+    this->isRunning = true;
+    this->isCanceled = std::make_shared<std::atomic_bool>(false);
+    if(paths.isEmpty()){
+        this->Finish(false);
+        return;
+    }
+    emit this->progressChanged(0, int(paths.size()));
+    this->watcher->setFuture(QtConcurrent::mapped(std::move(paths), [tasks, isCanceled = this->isCanceled](const QString& path){
+        return Analyze(path, tasks, isCanceled.get());
+    }));
+}
+
+void TrackAnalysis::Finish(bool isCanceled)
+{
+    if(isCanceled == false && this->pending.empty() == false){
+        this->StartNext();
+        return;
+    }
+    this->isRunning = false;
+    emit this->finished(isCanceled);
+    //中止の後、終了通知より先に追加された分はここから始める
+    if(this->isRunning == false && this->pending.empty() == false){
+        this->StartNext();
+    }
+}
+
+TrackAnalysis::Result TrackAnalysis::Analyze(const QString& path, int tasks, const std::atomic_bool* isCanceled)
+{
+    //両方行う場合も別々に読む 2回目はOSのキャッシュから読まれる
+    Result result;
+    result.path = path;
+    result.tasks = tasks;
+    if(tasks & Loudness){ result.loudness = LoudnessAnalyzer::Analyze(path, isCanceled); }
+    if(tasks & Clipping){ result.clipping = ClipScanner::Scan(path, isCanceled); }
+    if(tasks & Waveform){ result.waveform = WaveformPeaks::Get(path, isCanceled); }
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef TRACKANALYSIS_H
+#define TRACKANALYSIS_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Encoder/LoudnessAnalyzer.h"
+#include "Encoder/ClipScanner.h"
+#include "Encoder/WaveformPeaks.h"
+
+//元のwavの解析(ラウドネス・クリップ・波形)をスレッドプールで並列に行う
+//1曲終わるごとにresultReadyで渡す 順番はテーブルの順とは限らない
+class TrackAnalysis : public QObject
+{
+    Q_OBJECT
+public:
+    enum Task
+    {
+        Loudness = 0x1,
+        Clipping = 0x2,
+        //表示用の波形 キャッシュがあれば読むだけ
+        Waveform = 0x4,
+    };
+
+    struct Result
+    {
+        QString path;
+        int tasks = 0;      //行った解析(Taskの組み合わせ)
+        LoudnessAnalyzer::Result loudness;
+        ClipScanner::Result clipping;
+        QByteArray waveform;
+    };
+
+    explicit TrackAnalysis(QObject* parent = nullptr);
+    ~TrackAnalysis() override;
+
+    //実行中に呼ばれた場合は、今の解析が終わってから続けて解析する
+    //tasksはTaskの組み合わせ
+    void Start(const QStringList& paths, int tasks);
+    //待っている分も含めて中止する 解析中の曲もブロックの区切りで止める
+    void Cancel();
+    bool IsRunning() const;
+
+    static Result Analyze(const QString& path, int tasks, const std::atomic_bool* isCanceled = nullptr);
+
+signals:
+    void resultReady(const TrackAnalysis::Result& result);
+    void progressChanged(int value, int maximum);
+    void finished(bool isCanceled);
+
+private:
+    void StartNext();
+    void Finish(bool isCanceled);
+
+    QFutureWatcher<Result>* watcher;
+    std::vector<std::pair<QStringList, int>> pending;
+    //解析中のスレッドから参照するので、実行ごとに作り直して共有する
+    std::shared_ptr<std::atomic_bool> isCanceled;
+    bool isRunning;
+};
+
+#endif // TRACKANALYSIS_H
@@ -0,0 +1,261 @@
+#include "TrackIngest.h"
+
+#include <QCollator>
+#include <QDir>
+#include <QFileInfo>
+#include <QPromise>
+#include <QtConcurrent>
+
+namespace
+{
+    //フォルダ内はファイル名の数字を数値として並べる("2"の後に"10")
+    void ScanFolder(QPromise<QStringList>& promise, const QString& folderPath, const QCollator& collator, QStringList& wavPaths)
+    {
+        QDir dir(folderPath);
+        //名前のフィルターは大文字・小文字を区別しない
+        auto files = dir.entryList({"*.wav"}, QDir::Files | QDir::Readable);
+        std::sort(files.begin(), files.end(), collator);
+        for(const auto& file : files){
+            wavPaths.append(dir.filePath(file));
+        }
+
+        auto folders = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+        std::sort(folders.begin(), folders.end(), collator);
+        for(const auto& folder : folders)
+        {
+            if(promise.isCanceled()){ return; }
+            ScanFolder(promise, dir.filePath(folder), collator, wavPaths);
+        }
+    }
+
+    void ScanPaths(QPromise<QStringList>& promise, const QStringList& paths)
+    {
+        QCollator collator;
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+        QStringList wavPaths;
+        for(const auto& path : paths)
+        {
+            if(promise.isCanceled()){ return; }
+            const QFileInfo info(path);
+            if(info.isDir()){
+                ScanFolder(promise, path, collator, wavPaths);
+            }
+            else if(info.suffix().toUpper() == "WAV"){
+                wavPaths.append(path);
+            }
+        }
+        promise.addResult(wavPaths);
+    }
+}
+
+TrackIngest::TrackIngest(QObject* parent)
+    : QObject(parent)
+    , scanWatcher(new QFutureWatcher<QStringList>(this))
+    , readWatcher(new QFutureWatcher<MetadataTable::Row>(this))
+    , nextIndex(0)
+    , isRunning(false)
+    , isCanceled(false)
+{
+    this->flushTimer.setInterval(flushIntervalMs);
+    connect(&this->flushTimer, &QTimer::timeout, this, &TrackIngest::Flush);
+
+    connect(this->scanWatcher, &QFutureWatcher<QStringList>::finished, this, [this]()
+    {
+        if(this->isCanceled || this->scanWatcher->isCanceled() || this->scanWatcher->future().resultCount() == 0){
+            this->Finish(true);
+            return;
+        }
+        this->StartRead(this->scanWatcher->result());
+    });
+
+    connect(this->readWatcher, &QFutureWatcher<MetadataTable::Row>::resultReadyAt, this, [this](int index){
+        if(this->isCanceled){ return; }
+        this->readyRows.emplace(index, this->readWatcher->resultAt(index));
+    });
+    connect(this->readWatcher, &QFutureWatcher<MetadataTable::Row>::progressValueChanged, this, [this](int value){
+        emit this->progressChanged(value, this->readWatcher->progressMaximum());
+    });
+    connect(this->readWatcher, &QFutureWatcher<MetadataTable::Row>::finished, this, [this]()
+    {
+        this->Flush();
+        this->Finish(this->isCanceled || this->readWatcher->isCanceled());
+    });
+}
+
+TrackIngest::~TrackIngest()
+{
+    this->pending.clear();
+    this->scanWatcher->cancel();
+    this->readWatcher->cancel();
+    this->scanWatcher->waitForFinished();
+    this->readWatcher->waitForFinished();
+}
+
+void TrackIngest::Start(const QStringList& paths, const QString& filenameDelimiter)
+{
+    this->pending.emplace_back(paths, filenameDelimiter);
+    if(this->isRunning == false){
+        this->StartNext();
+    }
+}
+
+void TrackIngest::Cancel()
+{
+    if(this->isRunning == false){ return; }
+    //まだ渡していない行は捨てる
+    this->isCanceled = true;
+    this->readyRows.clear();
+    this->pending.clear();
+    this->scanWatcher->cancel();
+    this->readWatcher->cancel();
+}
+
+bool TrackIngest::IsRunning() const
+{
+    return this->isRunning;
+}
+
+void TrackIngest::StartNext()
+{
+    auto [paths, delimiter] = std::move(this->pending.front());
+    this->pending.erase(this->pending.begin());
+
+    this->isRunning = true;
+    this->isCanceled = false;
+    this->filenameDelimiter = delimiter;
+    emit this->progressChanged(0, 0);
+    this->scanWatcher->setFuture(QtConcurrent::run(ScanPaths, paths));
+}
+
+void TrackIngest::StartRead(QStringList wavPaths)
+{
+    this->readyRows.clear();
+    this->nextIndex = 0;
+    if(wavPaths.isEmpty()){
+        this->Finish(false);
+        return;
+    }
+    emit this->progressChanged(0, int(wavPaths.size()));
+    this->flushTimer.start();
+    const QString delimiter = this->filenameDelimiter;
+    this->readWatcher->setFuture(QtConcurrent::mapped(std::move(wavPaths), [delimiter](const QString& path){
+        return ReadTrack(path, delimiter);
+    }));
+}
+
+void TrackIngest::Flush()
+{
+    if(this->isCanceled){ return; }
+    //先頭から続けて揃っている分だけを渡す
+    std::vector<MetadataTable::Row> rows;
+    for(auto itr = this->readyRows.begin(); itr != this->readyRows.end() && itr->first == this->nextIndex; itr = this->readyRows.erase(itr))
+    {
+        rows.push_back(std::move(itr->second));
+        this->nextIndex++;
+    }
+    if(rows.empty() == false){
+        emit this->rowsReady(rows);
+    }
+}
+
+void TrackIngest::Finish(bool isCanceled)
+{
+    this->flushTimer.stop();
+    this->readyRows.clear();
+    if(isCanceled == false && this->pending.empty() == false){
+        this->StartNext();
+        return;
+    }
+    this->isRunning = false;
+    emit this->finished(isCanceled);
+    //中止の後、終了通知より先に追加された分はここから始める
+    if(this->isRunning == false && this->pending.empty() == false){
+        this->StartNext();
+    }
+}
+
+MetadataTable::Row TrackIngest::ReadTrack(const QString& path, const QString& filenameDelimiter)
+{
+    QString track_no = "";
+    QString title = path.mid(path.lastIndexOf("/")+1).section(".", 0, 0);
+    QString albumTitle = "";
+    QString artist = "";
+    QString genre = "";
+    QString albumArtist = "";
+    QString composer = "";
+    QString group = "";
+    QString year = "";
+
+    //区切り文字で分けられればメタデータをファイル名から取得
+    QStringList metaDatas = title.split(filenameDelimiter);
+    const int size = metaDatas.size();
+    if(size > 0)
+    {
+        //意図的なフォールスルー
+        switch(size-1)
+        {
+        case TableColumn::Genre:
+            genre = metaDatas[4];
+            [[fallthrough]];
+        case TableColumn::AlbumTitle:
+            albumTitle = metaDatas[3];
+            [[fallthrough]];
+        case TableColumn::Artist:
+            artist = metaDatas[2];
+            [[fallthrough]];
+        case TableColumn::Title:
+            title = metaDatas[1];
+            [[fallthrough]];
+        case TableColumn::TrackNo:
+        {
+            QString buf = metaDatas[0];
+            bool isOk = false;
+            int num = buf.toInt(&isOk);
+            if(isOk){
+                track_no = QString("%1").arg(num);
+            }
+        }
+            break;
+        default:
+            break;
+        }
+    }
+
+    //wavに埋め込まれたタグで、ファイル名から決まらなかった項目を埋める
+    MetadataTable::Row newRow;
+    newRow.hasWaveInfo = WaveFile::ReadInfo(path, newRow.waveInfo);
+    if(newRow.hasWaveInfo)
+    {
+        const auto& tags = newRow.waveInfo.tags;
+        auto Fill = [](QString& value, const QString& tag){ if(value.isEmpty()){ value = tag; } };
+        if(size <= 1)
+        {
+            if(tags.title.isEmpty() == false){ title = tags.title; }
+            bool isOk = false;
+            const int num = tags.trackNo.toInt(&isOk);
+            if(isOk){ track_no = QString::number(num); }
+        }
+        Fill(artist, tags.artist);
+        Fill(albumTitle, tags.albumTitle);
+        Fill(genre, tags.genre);
+        Fill(albumArtist, tags.albumArtist);
+        Fill(composer, tags.composer);
+        Fill(group, tags.group);
+        Fill(year, tags.year);
+    }
+
+    auto& metaData = newRow.metaData;
+    metaData.track_no    = track_no;
+    metaData.title       = title;
+    metaData.artist      = artist;
+    metaData.albumTitle  = albumTitle;
+    metaData.albumArtist = albumArtist;
+    metaData.group       = group;
+    metaData.genre       = genre;
+    metaData.composer    = composer;
+    metaData.year        = year;
+    metaData.sourcePath  = path;
+    return newRow;
+}
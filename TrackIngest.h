@@ -0,0 +1,59 @@
+#ifndef TRACKINGEST_H
+#define TRACKINGEST_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QTimer>
+#include <map>
+#include <vector>
+
+#include "MetadataTable.h"
+
+//ドロップされたwavとフォルダの読み込み
+//フォルダは別スレッドで再帰的に探し、見つけたwavのヘッダーはスレッドプールで並列に読む
+//読めた行はドロップした順のまま、一定間隔でまとめてrowsReadyで渡す
+class TrackIngest : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int flushIntervalMs = 100;
+
+    explicit TrackIngest(QObject* parent = nullptr);
+    ~TrackIngest() override;
+
+    //実行中に呼ばれた場合は、今の読み込みが終わってから続けて読む
+    void Start(const QStringList& paths, const QString& filenameDelimiter);
+    //待っている分も含めて中止する すでにrowsReadyで渡した行はそのまま、まだ渡していない行は捨てる
+    void Cancel();
+    bool IsRunning() const;
+
+    //ファイル名とwavに埋め込まれたタグから1曲分の行を作る
+    //ファイル名からトラック番号が決まらなかった場合、track_noは空
+    static MetadataTable::Row ReadTrack(const QString& path, const QString& filenameDelimiter);
+
+signals:
+    void rowsReady(const std::vector<MetadataTable::Row>& rows);
+    //フォルダを探している間はmaximumが0
+    void progressChanged(int value, int maximum);
+    void finished(bool isCanceled);
+
+private:
+    void StartNext();
+    void StartRead(QStringList wavPaths);
+    void Flush();
+    void Finish(bool isCanceled);
+
+    QFutureWatcher<QStringList>* scanWatcher;
+    QFutureWatcher<MetadataTable::Row>* readWatcher;
+    QTimer flushTimer;
+    std::vector<std::pair<QStringList, QString>> pending;
+    QString filenameDelimiter;
+    //順番どおりに渡すため、先に読み終わった行は前の行が揃うまで取っておく
+    std::map<int, MetadataTable::Row> readyRows;
+    int nextIndex;
+    bool isRunning;
+    bool isCanceled;
+};
+
+#endif // TRACKINGEST_H
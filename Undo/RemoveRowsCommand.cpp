@@ -0,0 +1,19 @@
+﻿#include "RemoveRowsCommand.h"
+
+RemoveRowsCommand::RemoveRowsCommand(MetadataTable* table, std::vector<int> rows, QUndoCommand* parent)
+    : QUndoCommand(parent)
+    , table(table)
+    , rows(std::move(rows))
+{
+}
+
+void RemoveRowsCommand::undo()
+{
+    this->table->InsertRows(this->removedRows);
+    this->removedRows = MetadataTable::RowBlock();
+}
+
+void RemoveRowsCommand::redo()
+{
+    this->removedRows = this->table->TakeRows(this->rows);
+}
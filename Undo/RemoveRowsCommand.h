@@ -0,0 +1,22 @@
+﻿#ifndef REMOVEROWSCOMMAND_H
+#define REMOVEROWSCOMMAND_H
+
+#include <QUndoCommand>
+#include "MetadataTable.h"
+
+//行の削除 消した行の内容を持っておき、元の位置に戻す
+class RemoveRowsCommand : public QUndoCommand
+{
+public:
+    RemoveRowsCommand(MetadataTable* table, std::vector<int> rows, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    MetadataTable* table;
+    std::vector<int> rows;
+    MetadataTable::RowBlock removedRows;
+};
+
+#endif // REMOVEROWSCOMMAND_H
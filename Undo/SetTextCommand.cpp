@@ -1,16 +1,32 @@
-﻿#include "SetTextCommand.h"
-
-SetTextCommand::SetTextCommand()
-{
-
-}
-
-void SetTextCommand::undo()
-{
-
-}
-
-void SetTextCommand::redo()
-{
-
-}
+﻿#include "SetTextCommand.h"
+
+#include "ProjectDefines.hpp"
+
+#include <QObject>
+
+#include <algorithm>
+
+SetTextCommand::SetTextCommand(MetadataTable* table, int column, std::vector<int> rows, const QString& text, QUndoCommand* parent)
+    : QUndoCommand(parent)
+    , table(table)
+    , column(column)
+    , ranges(MetadataTable::ToRanges(std::move(rows)))
+    , text(text)
+    , previousTexts(table->GetTexts(column, this->ranges))
+{
+    this->setText(QObject::tr("Edit %1").arg(ProjectDefines::headerItems.value(column)));
+    //元と同じ文字列を確定しただけなら、履歴に残さない
+    const bool isUnchanged = std::all_of(this->previousTexts.begin(), this->previousTexts.end(),
+                                         [&text](const auto& run){ return run.second == text; });
+    this->setObsolete(isUnchanged);
+}
+
+void SetTextCommand::undo()
+{
+    this->table->SetTexts(this->column, this->ranges, this->previousTexts);
+}
+
+void SetTextCommand::redo()
+{
+    this->table->SetTexts(this->column, this->ranges, this->text);
+}
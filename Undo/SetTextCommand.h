@@ -1,15 +1,25 @@
-﻿#ifndef SETTEXTCOMMAND_H
-#define SETTEXTCOMMAND_H
-
-#include <QUndoCommand>
-
-class SetTextCommand : public QUndoCommand
-{
-public:
-    SetTextCommand();
-
-    void undo() override;
-    void redo() override;
-};
-
-#endif // SETTEXTCOMMAND_H
+﻿#ifndef SETTEXTCOMMAND_H
+#define SETTEXTCOMMAND_H
+
+#include <QUndoCommand>
+#include "MetadataTable.h"
+
+//1つの列の複数行を同じ文字列にする
+//行は連続した範囲、元の値は値が変わる位置だけを持つので、数千行を書き換えても1コマンドで軽い
+class SetTextCommand : public QUndoCommand
+{
+public:
+    SetTextCommand(MetadataTable* table, int column, std::vector<int> rows, const QString& text, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    MetadataTable* table;
+    int column;
+    std::vector<MetadataTable::RowRange> ranges;
+    QString text;
+    MetadataTable::TextRuns previousTexts;
+};
+
+#endif // SETTEXTCOMMAND_H
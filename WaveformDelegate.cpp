@@ -0,0 +1,58 @@
+#include "WaveformDelegate.h"
+
+#include <QLineF>
+#include <QPainter>
+#include <QVector>
+
+#include <algorithm>
+
+WaveformDelegate::WaveformDelegate(QObject* parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+WaveformDelegate::~WaveformDelegate(){
+}
+
+void WaveformDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    //背景・選択状態は普通のセルと同じに描く
+    QStyledItemDelegate::paint(painter, option, index);
+
+    const QByteArray peaks = index.data(Qt::UserRole).toByteArray();
+    const int numBins = int(peaks.size() / 2);
+    const QRect rect = option.rect.adjusted(2, 2, -2, -2);
+    if(numBins == 0 || rect.width() <= 0 || rect.height() <= 0){ return; }
+
+    //1ピクセルに入るビンの最小・最大をまとめて1本の縦線にする
+    const double center = rect.top() + rect.height() / 2.0;
+    const double scale = rect.height() / 2.0 / 127.0;
+    QVector<QLineF> lines;
+    lines.reserve(rect.width());
+    for(int x=0; x<rect.width(); ++x)
+    {
+        const int first = x * numBins / rect.width();
+        const int last = std::max(first + 1, (x + 1) * numBins / rect.width());
+        int low = 0;
+        int high = 0;
+        for(int bin=first; bin<last; ++bin)
+        {
+            low = std::min(low, int(qint8(peaks[bin * 2])));
+            high = std::max(high, int(qint8(peaks[bin * 2 + 1])));
+        }
+        const double left = rect.left() + x + 0.5;
+        lines.append(QLineF(left, center - high * scale, left, center - low * scale));
+    }
+
+    painter->save();
+    painter->setPen(option.state & QStyle::State_Selected ? option.palette.highlightedText().color() : option.palette.text().color());
+    painter->drawLines(lines);
+    painter->restore();
+}
+
+QSize WaveformDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    size.setWidth(std::max(size.width(), preferredWidth));
+    return size;
+}
@@ -0,0 +1,21 @@
+#ifndef WAVEFORMDELEGATE_H
+#define WAVEFORMDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+//波形の列を描く Qt::UserRoleのQByteArray(WaveformPeaksの形式)を1ピクセルごとの縦線にする
+//データが無い行は普通のセルとして文字を描く
+class WaveformDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    static constexpr int preferredWidth = 120;
+
+    explicit WaveformDelegate(QObject* parent = nullptr);
+    ~WaveformDelegate() override;
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+};
+
+#endif // WAVEFORMDELEGATE_H
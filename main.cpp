@@ -17,12 +17,29 @@
 * ===================================================== */
 
 #include "MainWindow.h"
+#include "CommandLineEncoder.h"
+#include "EncodeBenchmark.h"
 #include "ProjectDefines.hpp"
 #include <QApplication>
 #include <QTranslator>
 
 int main(int argc, char *argv[])
 {
+    //ベンチマーク指定時も同様にウィジェットを作らない
+    if(EncodeBenchmark::IsBenchmarkMode(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+        ProjectDefines::settingFilePath = QCoreApplication::applicationDirPath()+"/setting.ini";
+        return EncodeBenchmark::Run(a.arguments());
+    }
+    //プロジェクトが指定されていればウィジェットを作らずにエンコードだけ行う
+    if(CommandLineEncoder::IsCommandLineMode(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+        ProjectDefines::settingFilePath = QCoreApplication::applicationDirPath()+"/setting.ini";
+        return CommandLineEncoder::Run(a.arguments());
+    }
+
     QApplication a(argc, argv);
 
     ProjectDefines::settingFilePath = qApp->applicationDirPath()+"/setting.ini";
@@ -0,0 +1,34 @@
+# FfmpegDownloaderのテスト
+# ローカルのHTTPサーバーに向けて、Rangeでの続き・416・ハッシュの不一致を確かめる
+
+QT       += core network concurrent testlib
+QT       -= gui
+
+TARGET = FfmpegDownloaderTest
+TEMPLATE = app
+CONFIG += c++2a console testcase
+CONFIG -= app_bundle
+msvc: QMAKE_CXXFLAGS += /std:c++20
+
+ROOT_DIR = $$PWD/../..
+
+# Link QuaZip library
+win32 {
+    CONFIG(debug, debug|release){
+        LIBS += -L$$ROOT_DIR/lib -lquazip1-qt6d -lzlibstatic
+    } else {
+        LIBS += -L$$ROOT_DIR/lib -lquazip1-qt6 -lzlibstatic
+    }
+} else {
+    LIBS += -lquazip1-qt6 -lz
+}
+INCLUDEPATH += $$ROOT_DIR
+INCLUDEPATH += $$ROOT_DIR/quazip
+INCLUDEPATH += $$ROOT_DIR/zlib
+
+SOURCES += \
+    $$ROOT_DIR/FfmpegDownloader.cpp \
+    tst_FfmpegDownloader.cpp
+
+HEADERS += \
+    $$ROOT_DIR/FfmpegDownloader.h
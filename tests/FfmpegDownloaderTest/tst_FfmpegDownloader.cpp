@@ -0,0 +1,292 @@
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QHostAddress>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <memory>
+
+#include "FfmpegDownloader.h"
+#include "quazip/quazip.h"
+#include "quazip/quazipfile.h"
+
+//テスト用の小さなHTTPサーバー GETだけに応え、Rangeは"bytes=N-"の形だけを扱う
+class LocalHttpServer : public QObject
+{
+public:
+    QHash<QByteArray, QByteArray> files;            //パス -> 内容
+    bool isRangeSupported = true;
+    QList<QPair<QByteArray, QByteArray>> requests;  //受け取った要求のパスとRangeヘッダー
+
+    bool Listen()
+    {
+        connect(&this->server, &QTcpServer::newConnection, this, &LocalHttpServer::OnNewConnection);
+        return this->server.listen(QHostAddress::LocalHost);
+    }
+    QUrl GetUrl(const QByteArray& path) const
+    {
+        return QUrl(QString("http://127.0.0.1:%1%2").arg(this->server.serverPort()).arg(QString::fromLatin1(path)));
+    }
+
+private:
+    void OnNewConnection()
+    {
+        while(auto* socket = this->server.nextPendingConnection())
+        {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket](){
+                this->OnReadyRead(socket);
+            });
+        }
+    }
+
+    void OnReadyRead(QTcpSocket* socket)
+    {
+        //ヘッダーが揃うまで溜める
+        const QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+        socket->setProperty("request", request);
+        const auto headerEnd = request.indexOf("\r\n\r\n");
+        if(headerEnd < 0){ return; }
+
+        const auto lines = request.left(headerEnd).split('\n');
+        const QByteArray path = lines.first().split(' ').value(1);
+        QByteArray range;
+        for(const auto& line : lines)
+        {
+            if(line.toLower().startsWith("range:")){
+                range = line.mid(6).trimmed();
+            }
+        }
+        this->requests.append({path, range});
+
+        auto Respond = [socket](const QByteArray& status, const QByteArray& headers, const QByteArray& body){
+            socket->write("HTTP/1.1 " + status + "\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n" + headers + "\r\n" + body);
+            socket->disconnectFromHost();
+        };
+        if(this->files.contains(path) == false){
+            Respond("404 Not Found", "", "");
+            return;
+        }
+        const QByteArray& body = this->files[path];
+        static const QRegularExpression rangePattern("^bytes=(\\d+)-$");
+        const auto match = rangePattern.match(QString::fromLatin1(range));
+        if(this->isRangeSupported == false || match.hasMatch() == false){
+            Respond("200 OK", "", body);
+            return;
+        }
+        const qint64 offset = match.captured(1).toLongLong();
+        if(offset >= body.size()){
+            Respond("416 Range Not Satisfiable", "Content-Range: bytes */" + QByteArray::number(body.size()) + "\r\n", "");
+            return;
+        }
+        Respond("206 Partial Content",
+                "Content-Range: bytes " + QByteArray::number(offset) + "-" + QByteArray::number(body.size() - 1) + "/" + QByteArray::number(body.size()) + "\r\n",
+                body.mid(offset));
+    }
+
+    QTcpServer server;
+};
+
+class FfmpegDownloaderTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void resumeWithRange();
+    void restartWhenRangeIgnored();
+    void completePartReturns416();
+    void verifiedZipIsReused();
+    void hashMismatch();
+    void corruptedPartIsDiscarded();
+
+private:
+    std::unique_ptr<FfmpegDownloader> MakeDownloader();
+    bool Run(FfmpegDownloader& downloader, FfmpegDownloader::Result* result);
+    void WritePart(const QByteArray& data);
+    QByteArray ReadExecutable() const;
+
+    QByteArray executableData;
+    QByteArray zipData;
+    std::unique_ptr<QTemporaryDir> workDir;
+    std::unique_ptr<LocalHttpServer> server;
+};
+
+void FfmpegDownloaderTest::initTestCase()
+{
+    qRegisterMetaType<FfmpegDownloader::Result>();
+
+    //圧縮されないよう乱数で埋め、チャンクを何回かに分けて受け取る大きさにする
+    this->executableData.resize(3 * FfmpegDownloader::chunkSize + 123);
+    QRandomGenerator random(1);
+    for(auto& c : this->executableData){
+        c = char(random.bounded(256));
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString zipPath = dir.filePath("ffmpeg.zip");
+    {
+        QuaZip zip(zipPath);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("ffmpeg-release-essentials/bin/ffmpeg.exe")));
+        QCOMPARE(file.write(this->executableData), qint64(this->executableData.size()));
+        file.close();
+        zip.close();
+    }
+    QFile zipFile(zipPath);
+    QVERIFY(zipFile.open(QFile::ReadOnly));
+    this->zipData = zipFile.readAll();
+}
+
+void FfmpegDownloaderTest::init()
+{
+    this->workDir = std::make_unique<QTemporaryDir>();
+    QVERIFY(this->workDir->isValid());
+    this->server = std::make_unique<LocalHttpServer>();
+    QVERIFY(this->server->Listen());
+    this->server->files["/ffmpeg.zip"] = this->zipData;
+    this->server->files["/ffmpeg.zip.sha256"] = QCryptographicHash::hash(this->zipData, QCryptographicHash::Sha256).toHex() + " *ffmpeg.zip\n";
+}
+
+void FfmpegDownloaderTest::cleanup()
+{
+    this->server.reset();
+    this->workDir.reset();
+}
+
+std::unique_ptr<FfmpegDownloader> FfmpegDownloaderTest::MakeDownloader()
+{
+    auto downloader = std::make_unique<FfmpegDownloader>(this->server->GetUrl("/ffmpeg.zip"), this->server->GetUrl("/ffmpeg.zip.sha256"));
+    downloader->SetZipPath(this->workDir->filePath("ffmpeg.zip"));
+    return downloader;
+}
+
+bool FfmpegDownloaderTest::Run(FfmpegDownloader& downloader, FfmpegDownloader::Result* result)
+{
+    QSignalSpy spy(&downloader, &FfmpegDownloader::finished);
+    downloader.Start(this->workDir->path());
+    if(spy.wait(10000) == false){ return false; }
+    *result = spy.first().first().value<FfmpegDownloader::Result>();
+    return true;
+}
+
+void FfmpegDownloaderTest::WritePart(const QByteArray& data)
+{
+    QFile file(this->workDir->filePath("ffmpeg.zip.part"));
+    QVERIFY(file.open(QFile::WriteOnly));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+QByteArray FfmpegDownloaderTest::ReadExecutable() const
+{
+    QFile file(this->workDir->filePath(FfmpegDownloader::executableName));
+    if(file.open(QFile::ReadOnly) == false){ return QByteArray(); }
+    return file.readAll();
+}
+
+void FfmpegDownloaderTest::resumeWithRange()
+{
+    const qint64 offset = this->zipData.size() / 2;
+    this->WritePart(this->zipData.left(offset));
+
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::Succeeded);
+
+    //受け取り済みの続きから要求している
+    QCOMPARE(this->server->requests.last().first, QByteArray("/ffmpeg.zip"));
+    QCOMPARE(this->server->requests.last().second, "bytes=" + QByteArray::number(offset) + "-");
+    QVERIFY(this->ReadExecutable() == this->executableData);
+    QVERIFY(QFile::exists(this->workDir->filePath("ffmpeg.zip.part")) == false);
+}
+
+void FfmpegDownloaderTest::restartWhenRangeIgnored()
+{
+    this->WritePart(this->zipData.left(this->zipData.size() / 2));
+    this->server->isRangeSupported = false;
+
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::Succeeded);
+    QVERIFY(this->ReadExecutable() == this->executableData);
+}
+
+void FfmpegDownloaderTest::completePartReturns416()
+{
+    this->WritePart(this->zipData);
+
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::Succeeded);
+    QCOMPARE(this->server->requests.last().second, "bytes=" + QByteArray::number(this->zipData.size()) + "-");
+    QVERIFY(this->ReadExecutable() == this->executableData);
+}
+
+void FfmpegDownloaderTest::verifiedZipIsReused()
+{
+    QFile zipFile(this->workDir->filePath("ffmpeg.zip"));
+    QVERIFY(zipFile.open(QFile::WriteOnly));
+    zipFile.write(this->zipData);
+    zipFile.close();
+
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::Succeeded);
+    //ハッシュ値だけを受け取り、zipは要求しない
+    QCOMPARE(this->server->requests.size(), qsizetype(1));
+    QCOMPARE(this->server->requests.first().first, QByteArray("/ffmpeg.zip.sha256"));
+    QVERIFY(this->ReadExecutable() == this->executableData);
+}
+
+void FfmpegDownloaderTest::hashMismatch()
+{
+    this->server->files["/ffmpeg.zip.sha256"] = QByteArray(64, '0');
+
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::HashMismatch);
+    QVERIFY(downloader->GetErrorString().isEmpty() == false);
+    //壊れたzipは続きに使わず、展開もしない
+    QVERIFY(QFile::exists(this->workDir->filePath("ffmpeg.zip.part")) == false);
+    QVERIFY(QFile::exists(this->workDir->filePath("ffmpeg.zip")) == false);
+    QVERIFY(QFile::exists(this->workDir->filePath(FfmpegDownloader::executableName)) == false);
+}
+
+void FfmpegDownloaderTest::corruptedPartIsDiscarded()
+{
+    QByteArray part = this->zipData.left(this->zipData.size() / 2);
+    part[part.size() / 2] = char(part[part.size() / 2] ^ 0xff);
+    this->WritePart(part);
+
+    {
+        auto downloader = this->MakeDownloader();
+        FfmpegDownloader::Result result;
+        QVERIFY(this->Run(*downloader, &result));
+        QCOMPARE(result, FfmpegDownloader::Result::HashMismatch);
+        QVERIFY(QFile::exists(this->workDir->filePath("ffmpeg.zip.part")) == false);
+    }
+    //次は最初から受け取り直して成功する
+    auto downloader = this->MakeDownloader();
+    FfmpegDownloader::Result result;
+    QVERIFY(this->Run(*downloader, &result));
+    QCOMPARE(result, FfmpegDownloader::Result::Succeeded);
+    QVERIFY(this->server->requests.last().second.isEmpty());
+    QVERIFY(this->ReadExecutable() == this->executableData);
+}
+
+QTEST_GUILESS_MAIN(FfmpegDownloaderTest)
+
+#include "tst_FfmpegDownloader.moc"